@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-size set of small integers, stored as 64-bit words. Used by the
+// dataflow analyses where std::set would allocate a node per element.
+class BitVector {
+public:
+  BitVector() : bitCount(0) {}
+  explicit BitVector(size_t size)
+      : bitCount(size), words((size + 63) / 64, 0) {}
+
+  size_t size() const { return bitCount; }
+
+  inline void set(size_t i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+  inline void reset(size_t i) { words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+  inline bool test(size_t i) const {
+    return (words[i / 64] >> (i % 64)) & 1;
+  }
+
+  void clear() {
+    for (auto &w : words) {
+      w = 0;
+    }
+  }
+
+  // this |= other. Returns true if a bit was added.
+  bool unionWith(const BitVector &other) {
+    bool changed = false;
+    for (size_t i = 0; i < words.size(); i++) {
+      uint64_t merged = words[i] | other.words[i];
+      changed |= merged != words[i];
+      words[i] = merged;
+    }
+    return changed;
+  }
+
+  // this &= ~other
+  void subtract(const BitVector &other) {
+    for (size_t i = 0; i < words.size(); i++) {
+      words[i] &= ~other.words[i];
+    }
+  }
+
+  bool any() const {
+    for (auto w : words) {
+      if (w) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t count() const {
+    size_t n = 0;
+    for (auto w : words) {
+      n += __builtin_popcountll(w);
+    }
+    return n;
+  }
+
+  // Calls f(i) for every set bit, in increasing order.
+  template <typename F> void forEach(F f) const {
+    for (size_t i = 0; i < words.size(); i++) {
+      uint64_t w = words[i];
+      while (w) {
+        f(i * 64 + __builtin_ctzll(w));
+        w &= w - 1;
+      }
+    }
+  }
+
+  bool operator==(const BitVector &other) const {
+    return words == other.words;
+  }
+  bool operator!=(const BitVector &other) const { return !(*this == other); }
+
+private:
+  size_t bitCount;
+  std::vector<uint64_t> words;
+};
@@ -0,0 +1,101 @@
+#include "BlockLayout.h"
+#include "Dominators.h"
+
+#include <algorithm>
+
+namespace {
+// Probabilities of the taken successor, for the heuristics that apply
+const double backEdgeProbability = 0.88;
+const double loopExitProbability = 0.12;
+const double returnProbability = 0.28;
+} // namespace
+
+BlockLayout::BlockLayout(CFG *cfg) : cfg(cfg) {}
+
+std::vector<BlockLayout::Edge>
+BlockLayout::weighEdges(const std::vector<BasicBlock *> &rpo,
+                        const LoopInfo &loops) const {
+  std::unordered_map<BasicBlock *, int> index;
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    index[rpo[i]] = i;
+  }
+  auto returns = [](BasicBlock *bb) {
+    return bb->exit_true == nullptr ||
+           (!bb->instrs.empty() &&
+            bb->instrs.back().getOperation() == IRInstr::ret);
+  };
+
+  std::vector<Edge> edges;
+  for (BasicBlock *bb : rpo) {
+    double frequency = 1;
+    for (int d = std::min(loops.depth(bb), 8); d > 0; d--) {
+      frequency *= 10;
+    }
+    if (bb->exit_true == nullptr) {
+      continue;
+    }
+    if (bb->exit_false == nullptr) {
+      edges.push_back({bb, bb->exit_true, frequency});
+      continue;
+    }
+
+    // Probability of exit_true
+    BasicBlock *taken = bb->exit_true;
+    BasicBlock *other = bb->exit_false;
+    bool takenBack = index[taken] <= index[bb];
+    bool otherBack = index[other] <= index[bb];
+    bool takenExits = loops.depth(taken) < loops.depth(bb);
+    bool otherExits = loops.depth(other) < loops.depth(bb);
+    double probability = 0.5;
+    if (takenBack != otherBack) {
+      probability = takenBack ? backEdgeProbability : 1 - backEdgeProbability;
+    } else if (takenExits != otherExits) {
+      probability = takenExits ? loopExitProbability : 1 - loopExitProbability;
+    } else if (returns(taken) != returns(other)) {
+      probability = returns(taken) ? returnProbability : 1 - returnProbability;
+    }
+    edges.push_back({bb, taken, frequency * probability});
+    edges.push_back({bb, other, frequency * (1 - probability)});
+  }
+  return edges;
+}
+
+std::vector<BasicBlock *> BlockLayout::run() {
+  Dominators dominators(cfg);
+  const std::vector<BasicBlock *> &rpo = dominators.getReversePostOrder();
+  LoopInfo loops(rpo);
+  std::vector<Edge> edges = weighEdges(rpo, loops);
+  std::stable_sort(edges.begin(), edges.end(),
+                   [](const Edge &a, const Edge &b) {
+                     return a.weight > b.weight;
+                   });
+
+  // Each block starts as a chain of its own, numbered by its index in rpo
+  std::unordered_map<BasicBlock *, int> chainOf;
+  std::vector<std::vector<BasicBlock *>> chains;
+  for (BasicBlock *bb : rpo) {
+    chainOf[bb] = chains.size();
+    chains.push_back({bb});
+  }
+  BasicBlock *entry = rpo.front();
+  for (const Edge &edge : edges) {
+    int from = chainOf[edge.from];
+    int to = chainOf[edge.to];
+    if (from == to || chains[from].back() != edge.from ||
+        chains[to].front() != edge.to || edge.to == entry) {
+      continue;
+    }
+    for (BasicBlock *bb : chains[to]) {
+      chainOf[bb] = from;
+      chains[from].push_back(bb);
+    }
+    chains[to].clear();
+  }
+
+  std::vector<BasicBlock *> order;
+  order.reserve(rpo.size());
+  for (const std::vector<BasicBlock *> &chain : chains) {
+    order.insert(order.end(), chain.begin(), chain.end());
+  }
+  return order;
+}
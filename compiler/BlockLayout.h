@@ -0,0 +1,41 @@
+#pragma once
+#include "LoopInfo.h"
+#include "ir.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Order in which the blocks of a function are emitted, chosen so that the
+// most frequent edges fall through.
+//
+// Each edge gets a weight: the frequency of its source, 10^(loop depth) as
+// for the spill costs, times the probability of the branch taking it. The
+// probabilities come from static heuristics (Ball and Larus): a back edge is
+// likely, leaving a loop is not, and neither is going to a block that
+// returns. Going through the edges by decreasing weight, the chain ending
+// with the source is joined with the chain starting with the target (Pettis
+// and Hansen). The chain of the entry block comes first, then the others in
+// reverse post-order of their first block.
+//
+// This rotates the loops built by the visitor: the latch falls through to
+// the header testing the condition, which branches back to the body, so an
+// iteration runs a single conditional jump.
+class BlockLayout {
+public:
+  explicit BlockLayout(CFG *cfg);
+
+  // Returns the reachable blocks, in the order they are to be emitted
+  std::vector<BasicBlock *> run();
+
+private:
+  struct Edge {
+    BasicBlock *from;
+    BasicBlock *to;
+    double weight;
+  };
+
+  CFG *cfg;
+
+  std::vector<Edge> weighEdges(const std::vector<BasicBlock *> &rpo,
+                               const LoopInfo &loops) const;
+};
@@ -0,0 +1,146 @@
+#include "CFGSimplification.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+// The value a block branches on, if it ends with the cmpNZ built by the
+// visitor
+SymbolId branchValue(const BasicBlock *bb) {
+  if (bb->exit_false == nullptr || bb->instrs.empty() ||
+      bb->instrs.back().getOperation() != IRInstr::cmpNZ ||
+      bb->falseCondition != "e") {
+    return invalidSymbol;
+  }
+  return bb->instrs.back().getSymbolParam(0);
+}
+} // namespace
+
+CFGSimplification::CFGSimplification(CFG *cfg) : cfg(cfg), threaded(0) {}
+
+int CFGSimplification::run() {
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (BasicBlock *bb : cfg->getBlocks()) {
+      changed |= redirectEdges(bb);
+    }
+    std::unordered_map<BasicBlock *, int> predecessors = countPredecessors();
+    for (BasicBlock *bb : cfg->getBlocks()) {
+      changed |= mergeSuccessor(bb, predecessors);
+    }
+  }
+  return removeUnreachableBlocks();
+}
+
+BasicBlock *CFGSimplification::followEdge(BasicBlock *bb, BasicBlock *target,
+                                          bool taken) {
+  BasicBlock *entry = cfg->getBlocks()[0];
+  SymbolId value = branchValue(bb);
+  std::unordered_set<BasicBlock *> seen;
+  while (target != entry && seen.insert(target).second) {
+    if (target->instrs.empty() && target->exit_true != nullptr &&
+        target->exit_false == nullptr) {
+      target = target->exit_true;
+    } else if (value != invalidSymbol && target->instrs.size() == 1 &&
+               branchValue(target) == value) {
+      // cmpNZ v jumps to exit_false when v is 0, as it did in bb
+      target = taken ? target->exit_true : target->exit_false;
+      threaded++;
+    } else {
+      break;
+    }
+  }
+  return target;
+}
+
+bool CFGSimplification::redirectEdges(BasicBlock *bb) {
+  bool changed = false;
+  if (bb->exit_true != nullptr) {
+    BasicBlock *target = followEdge(bb, bb->exit_true, true);
+    changed |= target != bb->exit_true;
+    bb->exit_true = target;
+  }
+  if (bb->exit_false != nullptr) {
+    BasicBlock *target = followEdge(bb, bb->exit_false, false);
+    changed |= target != bb->exit_false;
+    bb->exit_false = target;
+  }
+  if (bb->exit_false != nullptr && bb->exit_false == bb->exit_true) {
+    if (!bb->instrs.empty() &&
+        bb->instrs.back().getOperation() == IRInstr::cmpNZ) {
+      bb->instrs.pop_back();
+    }
+    bb->exit_false = nullptr;
+    changed = true;
+  }
+  return changed;
+}
+
+bool CFGSimplification::mergeSuccessor(
+    BasicBlock *bb, const std::unordered_map<BasicBlock *, int> &predecessors) {
+  BasicBlock *succ = bb->exit_true;
+  if (succ == nullptr || bb->exit_false != nullptr || succ == bb ||
+      succ == cfg->getBlocks()[0] || predecessors.at(succ) != 1) {
+    return false;
+  }
+  for (const IRInstr &instr : succ->instrs) {
+    bb->instrs.emplace_back(bb, instr.getOperation(), instr.getType(),
+                            instr.getParams());
+  }
+  succ->instrs.clear();
+  bb->exit_true = succ->exit_true;
+  bb->exit_false = succ->exit_false;
+  bb->test_var_name = succ->test_var_name;
+  bb->falseCondition = succ->falseCondition;
+  // Unreachable from now on: it must not absorb its old successor as well
+  succ->exit_true = nullptr;
+  succ->exit_false = nullptr;
+  return true;
+}
+
+std::unordered_map<BasicBlock *, int>
+CFGSimplification::countPredecessors() const {
+  std::unordered_map<BasicBlock *, int> predecessors;
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    predecessors[bb];
+    for (BasicBlock *succ : {bb->exit_true, bb->exit_false}) {
+      if (succ != nullptr) {
+        predecessors[succ]++;
+      }
+    }
+  }
+  return predecessors;
+}
+
+int CFGSimplification::removeUnreachableBlocks() {
+  std::vector<BasicBlock *> &blocks = cfg->getBlocks();
+  std::unordered_set<BasicBlock *> reachable = {blocks[0]};
+  std::vector<BasicBlock *> stack = {blocks[0]};
+  while (!stack.empty()) {
+    BasicBlock *bb = stack.back();
+    stack.pop_back();
+    for (BasicBlock *succ : {bb->exit_true, bb->exit_false}) {
+      if (succ != nullptr && reachable.insert(succ).second) {
+        stack.push_back(succ);
+      }
+    }
+  }
+  // Instructions moved by earlier passes may still point to the block they
+  // came from, which is about to go
+  for (BasicBlock *bb : reachable) {
+    for (IRInstr &instr : bb->instrs) {
+      instr.setBlock(bb);
+    }
+  }
+  auto end = std::remove_if(blocks.begin(), blocks.end(), [&](BasicBlock *bb) {
+    if (reachable.count(bb)) {
+      return false;
+    }
+    delete bb;
+    return true;
+  });
+  int removed = blocks.end() - end;
+  blocks.erase(end, blocks.end());
+  return removed;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "ir.h"
+
+#include <unordered_map>
+
+// Simplification of the control flow graph, before SSA construction and
+// after SSA destruction (there are no phis to update).
+//
+// The visitor leaves many empty blocks, such as the end block of an if
+// jumping to the end block of the enclosing one. Until nothing changes:
+// - an edge to an empty block goes to its successor instead;
+// - a branch on a value to a block only branching on the same value again
+//   goes straight to the successor the value selects there;
+// - a conditional branch whose two successors are the same block becomes a
+//   jump;
+// - a block whose only successor has no other predecessor absorbs it.
+// The blocks no longer reachable are then deleted.
+class CFGSimplification {
+public:
+  explicit CFGSimplification(CFG *cfg);
+
+  // Returns the number of blocks removed
+  int run();
+
+  // Number of branches threaded by the last run
+  int getThreadedCount() const { return threaded; }
+
+private:
+  CFG *cfg;
+  int threaded;
+
+  // Block the edge from bb to target ends up in, once the empty blocks are
+  // skipped and the branch known from bb is threaded
+  BasicBlock *followEdge(BasicBlock *bb, BasicBlock *target, bool taken);
+  bool redirectEdges(BasicBlock *bb);
+  bool mergeSuccessor(BasicBlock *bb,
+                      const std::unordered_map<BasicBlock *, int> &predecessors);
+  std::unordered_map<BasicBlock *, int> countPredecessors() const;
+  int removeUnreachableBlocks();
+};
@@ -1,22 +1,66 @@
 #include "CodeGenVisitor.h"
+#include "MachineCode.h"
 #include "Type.h"
 #include "VisitorErrorListener.h"
 #include "ir.h"
 #include "support/Any.h"
 
+#include <cstdlib>
 #include <memory>
 #include <string>
 
 using namespace std;
 
+namespace {
+
+Type baseType(const std::string &name) {
+  if (name == "char") {
+    return Type::CHAR;
+  }
+  if (name == "void") {
+    return Type::VOID;
+  }
+  return Type::INT;
+}
+
+ifccParser::ExprContext *stripParentheses(ifccParser::ExprContext *ctx) {
+  while (auto par = dynamic_cast<ifccParser::ParContext *>(ctx)) {
+    ctx = par->expr();
+  }
+  return ctx;
+}
+
+// Names of the variables whose address is taken with & in the tree
+void findAddressTaken(antlr4::tree::ParseTree *tree,
+                      std::set<std::string> &names) {
+  auto unary = dynamic_cast<ifccParser::UnaryOpContext *>(tree);
+  if (unary != nullptr && unary->op->getText() == "&") {
+    auto val =
+        dynamic_cast<ifccParser::ValContext *>(stripParentheses(unary->expr()));
+    if (val != nullptr && val->ID() != nullptr) {
+      names.insert(val->ID()->toString());
+    }
+  }
+  for (antlr4::tree::ParseTree *child : tree->children) {
+    findAddressTaken(child, names);
+  }
+}
+
+bool isFirstElement(const Parameter &index) {
+  return std::holds_alternative<std::string>(index) &&
+         std::get<std::string>(index) == "0";
+}
+
+} // namespace
+
 CodeGenVisitor::CodeGenVisitor() {
   std::shared_ptr<CFG> getchar =
-      std::make_shared<CFG>(Type::INT, "getchar", 0, this);
+      std::make_shared<CFG>(Type::INT, "getchar", this);
 
   std::shared_ptr<CFG> putchar =
-      std::make_shared<CFG>(Type::INT, "putchar", 0, this);
-  auto symbol = putchar->add_parameter("c", Type::INT, 0);
-  symbol->used = true;
+      std::make_shared<CFG>(Type::INT, "putchar", this);
+  SymbolId symbol = putchar->add_parameter("c", Type::INT, 0);
+  putchar->getSymbol(symbol).used = true;
 
   cfgList.push_back(getchar);
   functions["getchar"] = getchar;
@@ -29,18 +73,20 @@ antlrcpp::Any CodeGenVisitor::visitAxiom(ifccParser::AxiomContext *ctx) {
 }
 
 antlrcpp::Any CodeGenVisitor::visitProg(ifccParser::ProgContext *ctx) {
-  for (ifccParser::FuncContext *func : ctx->func()) {
-    Type type;
-    if (func->TYPE(0)->toString() == "int") {
-      type = Type::INT;
-    } else if (func->TYPE(0)->toString() == "char") {
-      type = Type::CHAR;
-    } else if (func->TYPE(0)->toString() == "void") {
-      type = Type::VOID;
+  // In the order of the source, a function seeing the globals declared
+  // before it
+  for (antlr4::tree::ParseTree *child : ctx->children) {
+    auto declaration = dynamic_cast<ifccParser::Var_decl_stmtContext *>(child);
+    if (declaration != nullptr) {
+      visitGlobals(declaration);
+      continue;
+    }
+    auto func = dynamic_cast<ifccParser::FuncContext *>(child);
+    if (func == nullptr) {
+      continue;
     }
-    int argCount = func->ID().size() - 1;
-    curCfg =
-        std::make_shared<CFG>(type, func->ID(0)->toString(), argCount, this);
+    Type type = getType(func->type(0));
+    curCfg = std::make_shared<CFG>(type, func->ID(0)->toString(), this);
     cfgList.push_back(curCfg);
     functions[func->ID(0)->toString()] = curCfg;
     visit(func);
@@ -51,47 +97,97 @@ antlrcpp::Any CodeGenVisitor::visitProg(ifccParser::ProgContext *ctx) {
     exit(1);
   }
 
+  if (!globals.empty()) {
+    assembly << ".text\n";
+  }
   cout << assembly.str();
 
   return 0;
 }
 
 antlrcpp::Any CodeGenVisitor::visitFunc(ifccParser::FuncContext *ctx) {
+  addressTaken.clear();
+  addressTakenNames.clear();
+  findAddressTaken(ctx->block(), addressTakenNames);
+
+  std::vector<SymbolId> inMemory;
   for (int i = 1; i < ctx->ID().size(); i++) {
-    Type type = (ctx->TYPE(i)->toString() == "int" ? Type::INT : Type::CHAR);
+    Type type = getType(ctx->type(i));
+    if (type == Type::VOID) {
+      VisitorErrorListener::addError(ctx,
+                                     "Can't create a variable of type void");
+      type = Type::INT;
+    }
     auto symbol = curCfg->add_parameter(ctx->ID(i)->toString(), type,
                                         ctx->getStart()->getLine());
     curCfg->current_bb->add_IRInstr(IRInstr::param_decl, type, {symbol});
+    if (addressTakenNames.count(ctx->ID(i)->toString())) {
+      inMemory.push_back(symbol);
+    }
+  }
+
+  // A parameter whose address is taken is copied to memory, its name
+  // referring to the copy in the body
+  if (!inMemory.empty()) {
+    curCfg->push_table();
+  }
+  for (SymbolId parameter : inMemory) {
+    Symbol &symbol = curCfg->getSymbol(parameter);
+    symbol.used = true;
+    Type type = symbol.type;
+    std::string name = symbol.lexeme;
+    addSymbol(ctx, name, Type::arrayOf(type, 1));
+    SymbolId object = curCfg->get_symbol(name);
+    addressTaken.insert(object);
+    curCfg->current_bb->add_IRInstr(IRInstr::store, type,
+                                    {object, std::string("0"), parameter});
   }
 
   for (ifccParser::StmtContext *stmt : ctx->block()->stmt()) {
     visit(stmt);
   }
+  if (!inMemory.empty()) {
+    curCfg->pop_table();
+  }
+
+  // Reaching the end of the function returns, with 0 unless it is void (the
+  // value main returns then, and an unspecified one for other functions)
+  Type returnType = curCfg->get_return_type();
+  if (returnType == Type::VOID) {
+    curCfg->current_bb->add_IRInstr(IRInstr::ret, returnType, {});
+  } else {
+    SymbolId zero =
+        curCfg->current_bb->add_IRInstr(IRInstr::ldconst, returnType,
+                                        {std::string("0")});
+    curCfg->current_bb->add_IRInstr(IRInstr::ret, returnType, {zero});
+  }
 
   return 0;
 }
 
 antlrcpp::Any
 CodeGenVisitor::visitVar_decl_stmt(ifccParser::Var_decl_stmtContext *ctx) {
-  Type type;
-  if (ctx->TYPE()->toString() == "int") {
-    type = Type::INT;
-  } else if (ctx->TYPE()->toString() == "char") {
-    type = Type::CHAR;
-  } else if (ctx->TYPE()->toString() == "void") {
-    VisitorErrorListener::addError(ctx, "Can't create a variable of type void");
-  }
   // Iterate over each var_decl_member
   for (auto &memberCtx : ctx->var_decl_member()) {
     std::string varName = memberCtx->ID()->toString();
-    addSymbol(memberCtx, varName, type); // Declare the variable
+    Type type = getDeclaredType(ctx->TYPE(), memberCtx);
+    if (!type.isArray() && addressTakenNames.count(varName)) {
+      // Kept in memory, as an array of one element
+      addSymbol(memberCtx, varName, Type::arrayOf(type, 1));
+      addressTaken.insert(curCfg->get_symbol(varName));
+    } else {
+      addSymbol(memberCtx, varName, type); // Declare the variable
+    }
 
     if (memberCtx->expr()) { // Check for initialization
-      std::shared_ptr<Symbol> symbol = getSymbol(memberCtx, varName);
-      std::shared_ptr<Symbol> source =
-          visit(memberCtx->expr()).as<std::shared_ptr<Symbol>>();
-      curCfg->current_bb->add_IRInstr(IRInstr::var_assign, Type::INT,
-                                      {symbol, source});
+      if (type.isArray()) {
+        VisitorErrorListener::addError(memberCtx,
+                                       "An array can't be initialized");
+        continue;
+      }
+      LValue target = getVariable(memberCtx, varName);
+      SymbolId source = visit(memberCtx->expr()).as<SymbolId>();
+      store(memberCtx, target, source);
     }
   }
 
@@ -100,23 +196,33 @@ CodeGenVisitor::visitVar_decl_stmt(ifccParser::Var_decl_stmtContext *ctx) {
 
 antlrcpp::Any
 CodeGenVisitor::visitVar_assign_stmt(ifccParser::Var_assign_stmtContext *ctx) {
-  std::shared_ptr<Symbol> symbol = getSymbol(ctx, ctx->ID()->toString());
+  LValue target = getVariable(ctx, ctx->ID()->toString());
 
-  if (symbol == nullptr) {
+  if (target.variable == invalidSymbol && target.pointer == invalidSymbol) {
     return 1;
   }
 
-  std::shared_ptr<Symbol> source =
-      visit(ctx->expr()).as<std::shared_ptr<Symbol>>();
+  SymbolId source = visit(ctx->expr()).as<SymbolId>();
 
-  curCfg->current_bb->add_IRInstr(IRInstr::var_assign, Type::INT,
-                                  {symbol, source});
+  store(ctx, target, source);
+  return 0;
+}
+
+antlrcpp::Any
+CodeGenVisitor::visitMem_assign_stmt(ifccParser::Mem_assign_stmtContext *ctx) {
+  if (!isLValue(ctx->expr(0))) {
+    VisitorErrorListener::addError(ctx, "Expression is not assignable");
+    return 1;
+  }
+  LValue target = getLValue(ctx->expr(0));
+  SymbolId source = visit(ctx->expr(1)).as<SymbolId>();
+
+  store(ctx, target, source);
   return 0;
 }
 
 antlrcpp::Any CodeGenVisitor::visitIf(ifccParser::IfContext *ctx) {
-  std::shared_ptr<Symbol> result =
-      visit(ctx->expr()).as<std::shared_ptr<Symbol>>();
+  SymbolId result = visit(ctx->expr()).as<SymbolId>();
   std::string nextBBLabel = ".L" + std::to_string(nextLabel);
   nextLabel++;
 
@@ -140,8 +246,7 @@ antlrcpp::Any CodeGenVisitor::visitIf(ifccParser::IfContext *ctx) {
 }
 
 antlrcpp::Any CodeGenVisitor::visitIf_else(ifccParser::If_elseContext *ctx) {
-  std::shared_ptr<Symbol> result =
-      visit(ctx->expr()).as<std::shared_ptr<Symbol>>();
+  SymbolId result = visit(ctx->expr()).as<SymbolId>();
   std::string elseBBLabel = ".L" + std::to_string(nextLabel);
   nextLabel++;
   std::string endBBLabel = ".L" + std::to_string(nextLabel);
@@ -190,8 +295,7 @@ CodeGenVisitor::visitWhile_stmt(ifccParser::While_stmtContext *ctx) {
   baseBlock->exit_true = conditionBlock;
 
   curCfg->add_bb(conditionBlock);
-  std::shared_ptr<Symbol> result =
-      visit(ctx->expr()).as<std::shared_ptr<Symbol>>();
+  SymbolId result = visit(ctx->expr()).as<SymbolId>();
   conditionBlock->add_IRInstr(IRInstr::cmpNZ, Type::INT, {result});
 
   curCfg->add_bb(stmtBlock);
@@ -221,8 +325,8 @@ CodeGenVisitor::visitReturn_stmt(ifccParser::Return_stmtContext *ctx) {
       VisitorErrorListener::addError(ctx, message);
       return 1;
     }
-    std::shared_ptr<Symbol> val =
-        visit(ctx->expr()).as<std::shared_ptr<Symbol>>();
+    SymbolId val = convert(visit(ctx->expr()).as<SymbolId>(),
+                           curCfg->get_return_type());
     curCfg->current_bb->add_IRInstr(IRInstr::ret, curCfg->get_return_type(),
                                     {val});
   } else {
@@ -265,11 +369,10 @@ CodeGenVisitor::visitFunc_call(ifccParser::Func_callContext *ctx) {
 
   std::vector<Parameter> params = {ctx->ID()->toString()};
   for (int i = 0; i < funcCfg->get_parameters_type().size(); i++) {
-    std::shared_ptr<Symbol> symbol =
-        visit(ctx->expr(i)).as<std::shared_ptr<Symbol>>();
+    const Type &type = funcCfg->get_parameters_type()[i].type;
+    SymbolId symbol = convert(visit(ctx->expr(i)).as<SymbolId>(), type);
     params.push_back(symbol);
-    curCfg->current_bb->add_IRInstr(
-        IRInstr::param, funcCfg->get_parameters_type()[i].type, {symbol});
+    curCfg->current_bb->add_IRInstr(IRInstr::param, type, {symbol});
   }
 
   return curCfg->current_bb->add_IRInstr(IRInstr::call,
@@ -286,10 +389,8 @@ antlrcpp::Any CodeGenVisitor::visitMultdiv(ifccParser::MultdivContext *ctx) {
     instr = IRInstr::mod;
   }
 
-  std::shared_ptr<Symbol> leftVal =
-      visit(ctx->expr(0)).as<std::shared_ptr<Symbol>>();
-  std::shared_ptr<Symbol> rightVal =
-      visit(ctx->expr(1)).as<std::shared_ptr<Symbol>>();
+  SymbolId leftVal = visit(ctx->expr(0)).as<SymbolId>();
+  SymbolId rightVal = visit(ctx->expr(1)).as<SymbolId>();
 
   return curCfg->current_bb->add_IRInstr(instr, Type::INT, {leftVal, rightVal});
 }
@@ -298,16 +399,36 @@ antlrcpp::Any CodeGenVisitor::visitAddsub(ifccParser::AddsubContext *ctx) {
   IRInstr::Operation instr =
       (ctx->op->getText() == "+" ? IRInstr::add : IRInstr::sub);
 
-  std::shared_ptr<Symbol> leftVal =
-      visit(ctx->expr(0)).as<std::shared_ptr<Symbol>>();
-  std::shared_ptr<Symbol> rightVal =
-      visit(ctx->expr(1)).as<std::shared_ptr<Symbol>>();
+  SymbolId leftVal = visit(ctx->expr(0)).as<SymbolId>();
+  SymbolId rightVal = visit(ctx->expr(1)).as<SymbolId>();
 
-  if (leftVal == nullptr || rightVal == nullptr) {
+  if (leftVal == invalidSymbol || rightVal == invalidSymbol) {
     VisitorErrorListener::addError(
         ctx, "Invalid operation with function returning void");
   }
 
+  // Pointer arithmetic, in elements
+  bool leftPointer = curCfg->isWide(leftVal);
+  bool rightPointer = curCfg->isWide(rightVal);
+  if (leftPointer && rightPointer && instr == IRInstr::sub) {
+    int size = elementSize(ctx, leftVal);
+    SymbolId bytes =
+        curCfg->current_bb->add_IRInstr(instr, Type::INT, {leftVal, rightVal});
+    if (size <= 1) {
+      return bytes;
+    }
+    SymbolId divisor = curCfg->current_bb->add_IRInstr(
+        IRInstr::ldconst, Type::INT, {std::to_string(size)});
+    return curCfg->current_bb->add_IRInstr(IRInstr::div, Type::INT,
+                                           {bytes, divisor});
+  }
+  if (leftPointer) {
+    return offsetPointer(ctx, leftVal, rightVal, instr == IRInstr::sub);
+  }
+  if (rightPointer && instr == IRInstr::add) {
+    return offsetPointer(ctx, rightVal, leftVal, false);
+  }
+
   return curCfg->current_bb->add_IRInstr(instr, Type::INT, {leftVal, rightVal});
 }
 
@@ -323,15 +444,14 @@ antlrcpp::Any CodeGenVisitor::visitCmp(ifccParser::CmpContext *ctx) {
     instr = IRInstr::Operation::leq;
   }
 
-  std::shared_ptr<Symbol> leftVal =
-      visit(ctx->expr(0)).as<std::shared_ptr<Symbol>>();
-  std::shared_ptr<Symbol> rightVal =
-      visit(ctx->expr(1)).as<std::shared_ptr<Symbol>>();
+  SymbolId leftVal = visit(ctx->expr(0)).as<SymbolId>();
+  SymbolId rightVal = visit(ctx->expr(1)).as<SymbolId>();
 
-  if (leftVal == nullptr || rightVal == nullptr) {
+  if (leftVal == invalidSymbol || rightVal == invalidSymbol) {
     VisitorErrorListener::addError(
         ctx, "Invalid operation with function returning void");
   }
+  convertOperands(leftVal, rightVal);
 
   return curCfg->current_bb->add_IRInstr(instr, Type::INT, {leftVal, rightVal});
 }
@@ -340,27 +460,22 @@ antlrcpp::Any CodeGenVisitor::visitEq(ifccParser::EqContext *ctx) {
   IRInstr::Operation instr =
       (ctx->op->getText() == "==" ? IRInstr::eq : IRInstr::neq);
 
-  std::shared_ptr<Symbol> leftVal =
-      visit(ctx->expr(0)).as<std::shared_ptr<Symbol>>();
-  std::shared_ptr<Symbol> rightVal =
-      visit(ctx->expr(1)).as<std::shared_ptr<Symbol>>();
+  SymbolId leftVal = visit(ctx->expr(0)).as<SymbolId>();
+  SymbolId rightVal = visit(ctx->expr(1)).as<SymbolId>();
 
-  if (leftVal == nullptr || rightVal == nullptr) {
+  if (leftVal == invalidSymbol || rightVal == invalidSymbol) {
     VisitorErrorListener::addError(
         ctx, "Invalid operation with function returning void");
   }
+  convertOperands(leftVal, rightVal);
 
   return curCfg->current_bb->add_IRInstr(instr, Type::INT, {leftVal, rightVal});
 }
 
 antlrcpp::Any CodeGenVisitor::visitVal(ifccParser::ValContext *ctx) {
-  std::shared_ptr<Symbol> source;
+  SymbolId source = invalidSymbol;
   if (ctx->ID() != nullptr) {
-    std::shared_ptr<Symbol> symbol = getSymbol(ctx, ctx->ID()->toString());
-    if (symbol != nullptr) {
-      source =
-          curCfg->current_bb->add_IRInstr(IRInstr::ldvar, Type::INT, {symbol});
-    }
+    source = load(getVariable(ctx, ctx->ID()->toString()));
   } else if (ctx->INTEGER_LITERAL() != nullptr) {
     source = curCfg->current_bb->add_IRInstr(
         IRInstr::ldconst, Type::INT, {ctx->INTEGER_LITERAL()->toString()});
@@ -384,37 +499,32 @@ bool CodeGenVisitor::addSymbol(antlr4::ParserRuleContext *ctx,
   return result;
 }
 
-std::shared_ptr<Symbol>
-CodeGenVisitor::getSymbol(antlr4::ParserRuleContext *ctx,
-                          const std::string &id) {
-  std::shared_ptr<Symbol> symbol = curCfg->get_symbol(id);
-  if (symbol == nullptr) {
+SymbolId CodeGenVisitor::getSymbol(antlr4::ParserRuleContext *ctx,
+                                   const std::string &id) {
+  SymbolId symbol = curCfg->get_symbol(id);
+  if (symbol == invalidSymbol) {
     const std::string error = "Symbol not found: " + id;
     VisitorErrorListener::addError(ctx, error, ErrorType::Error);
-    return nullptr;
+    return invalidSymbol;
   }
 
-  symbol->used = true;
+  curCfg->getSymbol(symbol).used = true;
   return symbol;
 }
 
 antlrcpp::Any CodeGenVisitor::visitB_and(ifccParser::B_andContext *ctx) {
-  std::shared_ptr<Symbol> leftVal =
-      visit(ctx->expr(0)).as<std::shared_ptr<Symbol>>();
-  std::shared_ptr<Symbol> rightVal =
-      visit(ctx->expr(1)).as<std::shared_ptr<Symbol>>();
+  SymbolId leftVal = visit(ctx->expr(0)).as<SymbolId>();
+  SymbolId rightVal = visit(ctx->expr(1)).as<SymbolId>();
 
   return curCfg->current_bb->add_IRInstr(IRInstr::b_and, Type::INT,
                                          {leftVal, rightVal});
 }
 
 antlrcpp::Any CodeGenVisitor::visitB_or(ifccParser::B_orContext *ctx) {
-  std::shared_ptr<Symbol> leftVal =
-      visit(ctx->expr(0)).as<std::shared_ptr<Symbol>>();
-  std::shared_ptr<Symbol> rightVal =
-      visit(ctx->expr(1)).as<std::shared_ptr<Symbol>>();
+  SymbolId leftVal = visit(ctx->expr(0)).as<SymbolId>();
+  SymbolId rightVal = visit(ctx->expr(1)).as<SymbolId>();
 
-  if (leftVal == nullptr || rightVal == nullptr) {
+  if (leftVal == invalidSymbol || rightVal == invalidSymbol) {
     VisitorErrorListener::addError(
         ctx, "Invalid operation with function returning void");
   }
@@ -424,12 +534,10 @@ antlrcpp::Any CodeGenVisitor::visitB_or(ifccParser::B_orContext *ctx) {
 }
 
 antlrcpp::Any CodeGenVisitor::visitB_xor(ifccParser::B_xorContext *ctx) {
-  std::shared_ptr<Symbol> leftVal =
-      visit(ctx->expr(0)).as<std::shared_ptr<Symbol>>();
-  std::shared_ptr<Symbol> rightVal =
-      visit(ctx->expr(1)).as<std::shared_ptr<Symbol>>();
+  SymbolId leftVal = visit(ctx->expr(0)).as<SymbolId>();
+  SymbolId rightVal = visit(ctx->expr(1)).as<SymbolId>();
 
-  if (leftVal == nullptr || rightVal == nullptr) {
+  if (leftVal == invalidSymbol || rightVal == invalidSymbol) {
     VisitorErrorListener::addError(
         ctx, "Invalid operation with function returning void");
   }
@@ -439,8 +547,50 @@ antlrcpp::Any CodeGenVisitor::visitB_xor(ifccParser::B_xorContext *ctx) {
 }
 
 antlrcpp::Any CodeGenVisitor::visitUnaryOp(ifccParser::UnaryOpContext *ctx) {
-  std::shared_ptr<Symbol> val =
-      visit(ctx->expr()).as<std::shared_ptr<Symbol>>();
+  std::string op = ctx->op->getText();
+  if (op == "&") {
+    if (!isLValue(ctx->expr())) {
+      VisitorErrorListener::addError(ctx,
+                                     "Cannot take the address of an rvalue");
+      return invalidSymbol;
+    }
+    LValue lvalue = getLValue(ctx->expr());
+    if (lvalue.pointer == invalidSymbol) {
+      return invalidSymbol;
+    }
+    return addressOf(lvalue);
+  }
+  if (op == "*") {
+    return load(getLValue(ctx));
+  }
+  if ((op == "++" || op == "--") && isLValue(ctx->expr())) {
+    LValue lvalue = getLValue(ctx->expr());
+    IRInstr::Operation instr = (op == "++" ? IRInstr::inc : IRInstr::dec);
+    if (lvalue.variable != invalidSymbol && !lvalue.type.isPointer()) {
+      return curCfg->current_bb->add_IRInstr(instr, Type::INT,
+                                             {lvalue.variable});
+    }
+    SymbolId value = load(lvalue);
+    if (value == invalidSymbol || lvalue.type.isArray()) {
+      return invalidSymbol;
+    }
+    SymbolId result;
+    if (lvalue.type.isPointer()) {
+      int size = elementSize(ctx, value);
+      if (size == 0) {
+        return invalidSymbol;
+      }
+      result = curCfg->current_bb->add_IRInstr(
+          IRInstr::lea, lvalue.type,
+          {value, std::string(op == "++" ? "1" : "-1"), std::to_string(size)});
+    } else {
+      result = curCfg->current_bb->add_IRInstr(instr, Type::INT, {value});
+    }
+    store(ctx, lvalue, result);
+    return result;
+  }
+
+  SymbolId val = visit(ctx->expr()).as<SymbolId>();
   IRInstr::Operation instr;
   if (ctx->op->getText() == "-") {
     instr = IRInstr::neg;
@@ -460,5 +610,307 @@ antlrcpp::Any CodeGenVisitor::visitUnaryOp(ifccParser::UnaryOpContext *ctx) {
   } else if (ctx->op->getText() == "+") {
     return val;
   }
-  return nullptr;
+  return invalidSymbol;
+}
+
+antlrcpp::Any
+CodeGenVisitor::visitSubscript(ifccParser::SubscriptContext *ctx) {
+  return load(getLValue(ctx));
+}
+
+Type CodeGenVisitor::getType(ifccParser::TypeContext *ctx) {
+  Type type = baseType(ctx->TYPE()->toString());
+  for (size_t i = 0; i < ctx->stars.size(); i++) {
+    type = Type::pointerTo(type);
+  }
+  return type;
+}
+
+Type CodeGenVisitor::getDeclaredType(
+    antlr4::tree::TerminalNode *base,
+    ifccParser::Var_decl_memberContext *member) {
+  Type type = baseType(base->toString());
+  for (size_t i = 0; i < member->stars.size(); i++) {
+    type = Type::pointerTo(type);
+  }
+  if (type == Type::VOID) {
+    VisitorErrorListener::addError(member,
+                                   "Can't create a variable of type void");
+    type = Type::INT;
+  }
+  if (member->INTEGER_LITERAL() != nullptr) {
+    long length = std::strtol(
+        member->INTEGER_LITERAL()->toString().c_str(), nullptr, 10);
+    if (length <= 0 || length > (1 << 24)) {
+      VisitorErrorListener::addError(
+          member, "Invalid size of array " + member->ID()->toString());
+      length = 1;
+    }
+    type = Type::arrayOf(type, length);
+  }
+  return type;
+}
+
+void CodeGenVisitor::visitGlobals(ifccParser::Var_decl_stmtContext *ctx) {
+  for (auto &member : ctx->var_decl_member()) {
+    std::string name = member->ID()->toString();
+    Type type = getDeclaredType(ctx->TYPE(), member);
+    if (globals.count(name)) {
+      VisitorErrorListener::addError(
+          member, "The variable " + name + " has already been declared");
+      continue;
+    }
+    int value = 0;
+    if (member->expr() != nullptr &&
+        (type.isArray() || !evaluateConstant(member->expr(), value))) {
+      VisitorErrorListener::addError(
+          member, "The initializer of " + name + " is not a constant");
+    }
+
+    MachineCode data;
+    if (globals.empty()) {
+      data.directive(".data");
+    }
+    globals[name] = {type, value};
+    data.directive(".globl " + assemblyName(name));
+    data.directive(".balign " + std::to_string(getSlotAlignment(type)));
+    data.label(assemblyName(name));
+    if (type.isArray()) {
+      data.directive(".zero " + std::to_string(getSize(type)));
+    } else if (type.isPointer()) {
+      data.directive(".quad " + std::to_string(value));
+    } else if (type == Type::CHAR) {
+      data.directive(".byte " + std::to_string(static_cast<char>(value)));
+    } else {
+      data.directive(".long " + std::to_string(value));
+    }
+    data.print(assembly);
+  }
+}
+
+bool CodeGenVisitor::evaluateConstant(ifccParser::ExprContext *ctx,
+                                      int &value) {
+  ctx = stripParentheses(ctx);
+  if (auto val = dynamic_cast<ifccParser::ValContext *>(ctx)) {
+    if (val->INTEGER_LITERAL() != nullptr) {
+      value = static_cast<int>(std::strtoll(
+          val->INTEGER_LITERAL()->toString().c_str(), nullptr, 10));
+      return true;
+    }
+    if (val->CHAR_LITERAL() != nullptr) {
+      value = val->CHAR_LITERAL()->toString()[1];
+      return true;
+    }
+    return false;
+  }
+  auto unary = dynamic_cast<ifccParser::UnaryOpContext *>(ctx);
+  if (unary == nullptr) {
+    return false;
+  }
+  std::string op = unary->op->getText();
+  if ((op != "-" && op != "+" && op != "~" && op != "!") ||
+      !evaluateConstant(unary->expr(), value)) {
+    return false;
+  }
+  if (op == "-") {
+    value = static_cast<int>(0u - static_cast<unsigned>(value));
+  } else if (op == "~") {
+    value = ~value;
+  } else if (op == "!") {
+    value = !value;
+  }
+  return true;
+}
+
+bool CodeGenVisitor::isLValue(ifccParser::ExprContext *ctx) {
+  ctx = stripParentheses(ctx);
+  if (auto val = dynamic_cast<ifccParser::ValContext *>(ctx)) {
+    return val->ID() != nullptr;
+  }
+  if (auto unary = dynamic_cast<ifccParser::UnaryOpContext *>(ctx)) {
+    return unary->op->getText() == "*";
+  }
+  return dynamic_cast<ifccParser::SubscriptContext *>(ctx) != nullptr;
+}
+
+CodeGenVisitor::LValue
+CodeGenVisitor::getLValue(ifccParser::ExprContext *ctx) {
+  const LValue invalid = {invalidSymbol, invalidSymbol, std::string("0"),
+                          Type::INT};
+  ctx = stripParentheses(ctx);
+  if (auto val = dynamic_cast<ifccParser::ValContext *>(ctx)) {
+    return getVariable(val, val->ID()->toString());
+  }
+
+  SymbolId pointer = invalidSymbol;
+  Parameter index = std::string("0");
+  if (auto subscript = dynamic_cast<ifccParser::SubscriptContext *>(ctx)) {
+    // An array is indexed directly, without taking its address
+    ifccParser::ExprContext *base = subscript->expr(0);
+    LValue array = isLValue(base) ? getLValue(base) : invalid;
+    if (array.pointer != invalidSymbol && array.type.isArray()) {
+      pointer = array.pointer;
+    } else {
+      pointer = isLValue(base) ? load(array)
+                               : visit(base).as<SymbolId>();
+    }
+    SymbolId value = visit(subscript->expr(1)).as<SymbolId>();
+    if (value == invalidSymbol || curCfg->isWide(value)) {
+      VisitorErrorListener::addError(ctx, "Invalid array subscript");
+      return invalid;
+    }
+    index = value;
+  } else {
+    auto unary = dynamic_cast<ifccParser::UnaryOpContext *>(ctx);
+    pointer = visit(unary->expr()).as<SymbolId>();
+  }
+
+  if (pointer == invalidSymbol) {
+    return invalid;
+  }
+  // A local array, or a pointer to a complete type
+  Type type = curCfg->getSymbol(pointer).type;
+  if (!type.isArray() && elementSize(ctx, pointer) == 0) {
+    return invalid;
+  }
+  return {invalidSymbol, pointer, index, type.getElement()};
+}
+
+CodeGenVisitor::LValue
+CodeGenVisitor::getVariable(antlr4::ParserRuleContext *ctx,
+                            const std::string &id) {
+  if (curCfg->get_symbol(id) == invalidSymbol) {
+    auto global = globals.find(id);
+    if (global != globals.end()) {
+      const Type &type = global->second.type;
+      Type pointer =
+          Type::pointerTo(type.isArray() ? type.getElement() : type);
+      SymbolId address =
+          curCfg->current_bb->add_IRInstr(IRInstr::addr, pointer, {id});
+      return {invalidSymbol, address, std::string("0"), type};
+    }
+  }
+
+  SymbolId symbol = getSymbol(ctx, id);
+  if (symbol == invalidSymbol) {
+    return {invalidSymbol, invalidSymbol, std::string("0"), Type::INT};
+  }
+  const Type &type = curCfg->getSymbol(symbol).type;
+  if (addressTaken.count(symbol)) {
+    return {invalidSymbol, symbol, std::string("0"), type.getElement()};
+  }
+  if (type.isArray()) {
+    return {invalidSymbol, symbol, std::string("0"), type};
+  }
+  return {symbol, invalidSymbol, std::string("0"), type};
+}
+
+SymbolId CodeGenVisitor::load(const LValue &lvalue) {
+  if (lvalue.variable != invalidSymbol) {
+    return curCfg->current_bb->add_IRInstr(IRInstr::ldvar, Type::INT,
+                                           {lvalue.variable});
+  }
+  if (lvalue.pointer == invalidSymbol) {
+    return invalidSymbol;
+  }
+  if (lvalue.type.isArray()) {
+    return addressOf(lvalue);
+  }
+  return curCfg->current_bb->add_IRInstr(IRInstr::load, lvalue.type,
+                                         {lvalue.pointer, lvalue.index});
+}
+
+void CodeGenVisitor::store(antlr4::ParserRuleContext *ctx,
+                           const LValue &lvalue, SymbolId value) {
+  if (lvalue.variable != invalidSymbol) {
+    curCfg->current_bb->add_IRInstr(IRInstr::var_assign, Type::INT,
+                                    {lvalue.variable, value});
+    return;
+  }
+  if (lvalue.pointer == invalidSymbol) {
+    return;
+  }
+  if (lvalue.type.isArray()) {
+    VisitorErrorListener::addError(ctx, "Array type is not assignable");
+    return;
+  }
+  if (value == invalidSymbol) {
+    VisitorErrorListener::addError(
+        ctx, "Invalid operation with function returning void");
+    return;
+  }
+  curCfg->current_bb->add_IRInstr(
+      IRInstr::store, lvalue.type,
+      {lvalue.pointer, lvalue.index, convert(value, lvalue.type)});
+}
+
+SymbolId CodeGenVisitor::addressOf(const LValue &lvalue) {
+  const Type &element =
+      lvalue.type.isArray() ? lvalue.type.getElement() : lvalue.type;
+  Type pointer = Type::pointerTo(element);
+  if (isFirstElement(lvalue.index)) {
+    if (curCfg->getSymbol(lvalue.pointer).type.isArray()) {
+      return curCfg->current_bb->add_IRInstr(IRInstr::addr, pointer,
+                                             {lvalue.pointer});
+    }
+    return lvalue.pointer;
+  }
+  return curCfg->current_bb->add_IRInstr(
+      IRInstr::lea, pointer,
+      {lvalue.pointer, lvalue.index, std::to_string(getSize(element))});
+}
+
+Type CodeGenVisitor::getValueType(SymbolId value) {
+  if (value == invalidSymbol) {
+    return Type::INT;
+  }
+  return curCfg->getSymbol(value).type;
+}
+
+SymbolId CodeGenVisitor::convert(SymbolId value, const Type &type) {
+  if (value == invalidSymbol || !type.isPointer() || curCfg->isWide(value)) {
+    return value;
+  }
+  SymbolId pointer = curCfg->create_new_tempvar(type);
+  curCfg->current_bb->add_IRInstr(IRInstr::var_assign, type, {pointer, value});
+  return pointer;
+}
+
+void CodeGenVisitor::convertOperands(SymbolId &left, SymbolId &right) {
+  if (curCfg->isWide(left)) {
+    right = convert(right, getValueType(left));
+  } else if (curCfg->isWide(right)) {
+    left = convert(left, getValueType(right));
+  }
+}
+
+int CodeGenVisitor::elementSize(antlr4::ParserRuleContext *ctx,
+                                SymbolId pointer) {
+  Type type = getValueType(pointer);
+  if (!type.isPointer() || getSize(type.getElement()) == 0) {
+    VisitorErrorListener::addError(ctx, "Invalid dereference of " +
+                                            type.toString());
+    return 0;
+  }
+  return getSize(type.getElement());
+}
+
+SymbolId CodeGenVisitor::offsetPointer(antlr4::ParserRuleContext *ctx,
+                                       SymbolId pointer, SymbolId offset,
+                                       bool negate) {
+  int size = elementSize(ctx, pointer);
+  if (size == 0 || offset == invalidSymbol) {
+    return invalidSymbol;
+  }
+  if (curCfg->isWide(offset)) {
+    VisitorErrorListener::addError(ctx,
+                                   "Invalid operands to binary expression");
+    return invalidSymbol;
+  }
+  if (negate) {
+    offset = curCfg->current_bb->add_IRInstr(IRInstr::neg, Type::INT, {offset});
+  }
+  return curCfg->current_bb->add_IRInstr(
+      IRInstr::lea, getValueType(pointer),
+      {pointer, offset, std::to_string(size)});
 }
@@ -7,6 +7,7 @@
 #include "ir.h"
 #include <map>
 #include <memory>
+#include <set>
 
 class CodeGenVisitor : public ifccBaseVisitor {
 public:
@@ -27,6 +28,9 @@ public:
   virtual antlrcpp::Any
   visitVar_assign_stmt(ifccParser::Var_assign_stmtContext *ctx) override;
 
+  virtual antlrcpp::Any
+  visitMem_assign_stmt(ifccParser::Mem_assign_stmtContext *ctx) override;
+
   virtual antlrcpp::Any visitPar(ifccParser::ParContext *ctx) override;
 
   virtual antlrcpp::Any visitIf(ifccParser::IfContext *ctx) override;
@@ -59,6 +63,9 @@ public:
 
   virtual antlrcpp::Any visitUnaryOp(ifccParser::UnaryOpContext *ctx) override;
 
+  virtual antlrcpp::Any
+  visitSubscript(ifccParser::SubscriptContext *ctx) override;
+
   const std::vector<std::shared_ptr<CFG>> &getCfgList() const {
     return cfgList;
   }
@@ -75,9 +82,56 @@ private:
 
   std::stringstream assembly;
 
+  // Where an assignable expression is: a variable, or element index of the
+  // memory at pointer, a pointer symbol or a local array. The type is the one
+  // of the element, an array type for a whole array.
+  struct LValue {
+    SymbolId variable; /**< invalidSymbol if in memory */
+    SymbolId pointer;
+    Parameter index;
+    Type type;
+  };
+
+  // Globals by name, with the constant initializing a scalar
+  struct Global {
+    Type type;
+    int value;
+  };
+  std::map<std::string, Global> globals;
+  // Scalars of the function visited kept in memory, as arrays of one
+  // element, since their address is taken
+  std::set<SymbolId> addressTaken;
+  std::set<std::string> addressTakenNames;
+
   bool addSymbol(antlr4::ParserRuleContext *ctx, const std::string &id,
                  Type type);
 
-  std::shared_ptr<Symbol> getSymbol(antlr4::ParserRuleContext *ctx,
-                                    const std::string &id);
+  SymbolId getSymbol(antlr4::ParserRuleContext *ctx, const std::string &id);
+
+  Type getType(ifccParser::TypeContext *ctx);
+  Type getDeclaredType(antlr4::tree::TerminalNode *type,
+                       ifccParser::Var_decl_memberContext *member);
+  void visitGlobals(ifccParser::Var_decl_stmtContext *ctx);
+  // Value of an int constant expression, or false if it is not one
+  bool evaluateConstant(ifccParser::ExprContext *ctx, int &value);
+
+  bool isLValue(ifccParser::ExprContext *ctx);
+  LValue getLValue(ifccParser::ExprContext *ctx);
+  LValue getVariable(antlr4::ParserRuleContext *ctx, const std::string &id);
+  // The value of the lvalue, the address of its first element for an array
+  SymbolId load(const LValue &lvalue);
+  void store(antlr4::ParserRuleContext *ctx, const LValue &lvalue,
+             SymbolId value);
+  SymbolId addressOf(const LValue &lvalue);
+  Type getValueType(SymbolId value);
+  // The value converted to the type: an int becomes a pointer sign-extended
+  SymbolId convert(SymbolId value, const Type &type);
+  // Both operands of a comparison become pointers when one of them is
+  void convertOperands(SymbolId &left, SymbolId &right);
+  // Size of the elements the pointer value points to, reporting an error
+  // and returning 0 when it is not a pointer to a complete type
+  int elementSize(antlr4::ParserRuleContext *ctx, SymbolId pointer);
+  // pointer + offset elements (pointer - offset if negate)
+  SymbolId offsetPointer(antlr4::ParserRuleContext *ctx, SymbolId pointer,
+                         SymbolId offset, bool negate);
 };
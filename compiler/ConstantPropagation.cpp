@@ -0,0 +1,345 @@
+#include "ConstantPropagation.h"
+
+#include <climits>
+#include <cstdlib>
+#include <deque>
+
+namespace {
+// Folds a binary operation, returns false if its behavior is undefined
+bool foldBinary(IRInstr::Operation op, int a, int b, int &result) {
+  switch (op) {
+  case IRInstr::add:
+    return !__builtin_add_overflow(a, b, &result);
+  case IRInstr::sub:
+    return !__builtin_sub_overflow(a, b, &result);
+  case IRInstr::mul:
+    return !__builtin_mul_overflow(a, b, &result);
+  case IRInstr::div:
+  case IRInstr::mod:
+    if (b == 0 || (a == INT_MIN && b == -1)) {
+      return false;
+    }
+    result = op == IRInstr::div ? a / b : a % b;
+    return true;
+  case IRInstr::b_and:
+    result = a & b;
+    return true;
+  case IRInstr::b_or:
+    result = a | b;
+    return true;
+  case IRInstr::b_xor:
+    result = a ^ b;
+    return true;
+  case IRInstr::lt:
+    result = a < b;
+    return true;
+  case IRInstr::leq:
+    result = a <= b;
+    return true;
+  case IRInstr::gt:
+    result = a > b;
+    return true;
+  case IRInstr::geq:
+    result = a >= b;
+    return true;
+  case IRInstr::eq:
+    result = a == b;
+    return true;
+  case IRInstr::neq:
+    result = a != b;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Folds a unary operation, returns false if its behavior is undefined
+bool foldUnary(IRInstr::Operation op, int a, int &result) {
+  switch (op) {
+  case IRInstr::neg:
+    return !__builtin_sub_overflow(0, a, &result);
+  case IRInstr::not_:
+    result = ~a;
+    return true;
+  case IRInstr::lnot:
+    result = !a;
+    return true;
+  case IRInstr::inc:
+    return !__builtin_add_overflow(a, 1, &result);
+  case IRInstr::dec:
+    return !__builtin_sub_overflow(a, 1, &result);
+  default:
+    return false;
+  }
+}
+} // namespace
+
+ConstantPropagation::ConstantPropagation(CFG *cfg) : cfg(cfg) {}
+
+void ConstantPropagation::run() {
+  buildUses();
+  propagate();
+  rewrite();
+}
+
+ConstantPropagation::Value
+ConstantPropagation::evaluate(const IRInstr &instr, const State &state) const {
+  const Value varying = {Value::Varying, 0};
+  const Value unknown = {Value::Unknown, 0};
+  IRInstr::Operation op = instr.getOperation();
+  Value result = varying;
+
+  switch (op) {
+  case IRInstr::ldconst: {
+    const std::string &literal = std::get<std::string>(instr.getParams()[0]);
+    char *end;
+    long long value = std::strtoll(literal.c_str(), &end, 10);
+    if (*end == '\0' && value >= INT_MIN && value <= INT_MAX) {
+      result = {Value::Constant, (int)value};
+    }
+    return result;
+  }
+  case IRInstr::var_assign:
+    result = state[instr.getSymbolParam(1)];
+    break;
+  case IRInstr::add:
+  case IRInstr::sub:
+  case IRInstr::mul:
+  case IRInstr::div:
+  case IRInstr::mod:
+  case IRInstr::b_and:
+  case IRInstr::b_or:
+  case IRInstr::b_xor:
+  case IRInstr::lt:
+  case IRInstr::leq:
+  case IRInstr::gt:
+  case IRInstr::geq:
+  case IRInstr::eq:
+  case IRInstr::neq: {
+    Value a = state[instr.getSymbolParam(0)];
+    Value b = state[instr.getSymbolParam(1)];
+    if (a.kind == Value::Varying || b.kind == Value::Varying) {
+      return varying;
+    }
+    if (a.kind == Value::Unknown || b.kind == Value::Unknown) {
+      return unknown;
+    }
+    result.kind = foldBinary(op, a.constant, b.constant, result.constant)
+                      ? Value::Constant
+                      : Value::Varying;
+    return result;
+  }
+  case IRInstr::neg:
+  case IRInstr::not_:
+  case IRInstr::lnot:
+  case IRInstr::inc:
+  case IRInstr::dec: {
+    Value a = state[instr.getSymbolParam(0)];
+    if (a.kind != Value::Constant) {
+      return a;
+    }
+    result.kind = foldUnary(op, a.constant, result.constant)
+                      ? Value::Constant
+                      : Value::Varying;
+    break;
+  }
+  default:
+    return varying;
+  }
+
+  // Storing into a char variable truncates the value (see handleVar_assign)
+  bool store = op == IRInstr::var_assign || op == IRInstr::inc ||
+               op == IRInstr::dec;
+  if (store && result.kind == Value::Constant &&
+      cfg->getSymbol(instr.getSymbolParam(instr.getDefIndex())).type ==
+          Type::CHAR) {
+    result.constant = (signed char)result.constant;
+  }
+  return result;
+}
+
+void ConstantPropagation::buildUses() {
+  uses.assign(cfg->getSymbolCount(), {});
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    for (int i = 0; i < (int)bb->instrs.size(); i++) {
+      for (SymbolId symbol : bb->instrs[i].getUsedVariables()) {
+        uses[symbol].emplace_back(bb, i);
+      }
+    }
+  }
+}
+
+void ConstantPropagation::setValue(SymbolId symbol, Value value) {
+  // Values only go down the lattice: unknown, then constant, then varying
+  Value &current = values[symbol];
+  if (value.kind == Value::Unknown || current.kind == Value::Varying ||
+      (current.kind == Value::Constant && value.kind == Value::Constant &&
+       current.constant == value.constant)) {
+    return;
+  }
+  current = current.kind == Value::Unknown ? value : Value{Value::Varying, 0};
+  ssaWorklist.push_back(symbol);
+}
+
+void ConstantPropagation::propagate() {
+  // The symbols without a definition are read before being assigned (or are
+  // the parameters): nothing is known about them
+  values.assign(cfg->getSymbolCount(), Value{Value::Varying, 0});
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    for (const IRInstr &instr : bb->instrs) {
+      for (SymbolId symbol : instr.getDeclaredVariable()) {
+        values[symbol] = {Value::Unknown, 0};
+      }
+    }
+  }
+
+  flowWorklist.emplace_back(nullptr, cfg->getBlocks()[0]);
+  while (!flowWorklist.empty() || !ssaWorklist.empty()) {
+    while (!flowWorklist.empty()) {
+      Edge edge = flowWorklist.back();
+      flowWorklist.pop_back();
+      visitEdge(edge);
+    }
+    while (!ssaWorklist.empty()) {
+      SymbolId symbol = ssaWorklist.back();
+      ssaWorklist.pop_back();
+      for (auto &use : uses[symbol]) {
+        if (!executableBlocks.count(use.first)) {
+          continue;
+        }
+        const IRInstr &instr = use.first->instrs[use.second];
+        if (instr.getOperation() == IRInstr::phi) {
+          visitPhi(use.first, instr);
+        } else {
+          visitInstruction(use.first, instr);
+        }
+      }
+    }
+  }
+}
+
+void ConstantPropagation::visitEdge(const Edge &edge) {
+  if (edge.first != nullptr && !executableEdges.insert(edge).second) {
+    return;
+  }
+  BasicBlock *bb = edge.second;
+  bool firstVisit = executableBlocks.insert(bb).second;
+  bool hasBranch = false;
+  for (const IRInstr &instr : bb->instrs) {
+    if (instr.getOperation() == IRInstr::phi) {
+      visitPhi(bb, instr);
+    } else if (firstVisit) {
+      visitInstruction(bb, instr);
+      hasBranch |= instr.getOperation() == IRInstr::cmpNZ;
+    }
+  }
+  if (firstVisit && !hasBranch) {
+    visitBranch(bb);
+  }
+}
+
+void ConstantPropagation::visitPhi(BasicBlock *bb, const IRInstr &phi) {
+  Value result = {Value::Unknown, 0};
+  for (size_t k = 0; k < phi.phiBlocks.size(); k++) {
+    if (!executableEdges.count({phi.phiBlocks[k], bb})) {
+      continue;
+    }
+    Value source = values[phi.getSymbolParam(k + 1)];
+    if (source.kind == Value::Unknown || result.kind == Value::Varying) {
+      continue;
+    }
+    if (result.kind == Value::Unknown) {
+      result = source;
+    } else if (source.kind == Value::Varying ||
+               source.constant != result.constant) {
+      result = {Value::Varying, 0};
+    }
+  }
+  setValue(phi.getSymbolParam(0), result);
+}
+
+void ConstantPropagation::visitInstruction(BasicBlock *bb,
+                                           const IRInstr &instr) {
+  if (instr.getOperation() == IRInstr::cmpNZ) {
+    visitBranch(bb);
+    return;
+  }
+  std::vector<SymbolId> declared = instr.getDeclaredVariable();
+  if (!declared.empty()) {
+    setValue(declared[0], evaluate(instr, values));
+  }
+}
+
+void ConstantPropagation::visitBranch(BasicBlock *bb) {
+  if (bb->exit_false == nullptr) {
+    if (bb->exit_true != nullptr) {
+      flowWorklist.emplace_back(bb, bb->exit_true);
+    }
+    return;
+  }
+  Value condition = {Value::Varying, 0};
+  if (!bb->instrs.empty() &&
+      bb->instrs.back().getOperation() == IRInstr::cmpNZ) {
+    condition = values[bb->instrs.back().getSymbolParam(0)];
+  }
+  if (condition.kind == Value::Unknown) {
+    return;
+  }
+  if (condition.kind == Value::Varying || condition.constant != 0) {
+    flowWorklist.emplace_back(bb, bb->exit_true);
+  }
+  if (condition.kind == Value::Varying || condition.constant == 0) {
+    flowWorklist.emplace_back(bb, bb->exit_false);
+  }
+}
+
+void ConstantPropagation::rewrite() {
+  for (BasicBlock *bb : executableBlocks) {
+    // The phis must stay first: the ones computing a constant become
+    // ldconsts placed after them
+    std::vector<IRInstr> phis, instrs;
+    for (const IRInstr &instr : bb->instrs) {
+      std::vector<SymbolId> declared = instr.getDeclaredVariable();
+      bool isPhi = instr.getOperation() == IRInstr::phi;
+      if (!declared.empty() && values[declared[0]].kind == Value::Constant &&
+          instr.getOperation() != IRInstr::ldconst) {
+        SymbolId dest = declared[0];
+        instrs.emplace_back(bb, IRInstr::ldconst, cfg->getSymbol(dest).type,
+                            std::vector<Parameter>{
+                                std::to_string(values[dest].constant), dest});
+      } else if (isPhi) {
+        // Only the sources of executable edges are kept: the other edges are
+        // removed below, or come from blocks that never run
+        std::vector<Parameter> params = {declared[0]};
+        std::vector<BasicBlock *> phiBlocks;
+        for (size_t k = 0; k < instr.phiBlocks.size(); k++) {
+          if (executableEdges.count({instr.phiBlocks[k], bb})) {
+            params.push_back(instr.getSymbolParam(k + 1));
+            phiBlocks.push_back(instr.phiBlocks[k]);
+          }
+        }
+        phis.emplace_back(bb, IRInstr::phi, cfg->getSymbol(declared[0]).type,
+                          params);
+        phis.back().phiBlocks = phiBlocks;
+      } else {
+        instrs.push_back(instr);
+      }
+    }
+    phis.insert(phis.end(), instrs.begin(), instrs.end());
+    bb->instrs = phis;
+
+    if (bb->exit_false == nullptr || bb->instrs.empty() ||
+        bb->instrs.back().getOperation() != IRInstr::cmpNZ) {
+      continue;
+    }
+    Value condition = values[bb->instrs.back().getSymbolParam(0)];
+    if (condition.kind != Value::Constant) {
+      continue;
+    }
+    bb->instrs.pop_back();
+    if (condition.constant == 0) {
+      bb->exit_true = bb->exit_false;
+    }
+    bb->exit_false = nullptr;
+  }
+}
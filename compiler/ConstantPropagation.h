@@ -0,0 +1,57 @@
+#pragma once
+#include "ir.h"
+
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Sparse conditional constant propagation (Wegman and Zadeck), on the SSA
+// form of the IR (see SSAConstruction).
+//
+// Every symbol has a single lattice value: unknown, constant or varying.
+// Blocks are only visited once an edge reaching them is executable, and a
+// cmpNZ on a known constant makes only one of its edges executable; phis
+// only meet the sources coming through executable edges. When a value
+// changes, only the instructions using it are evaluated again, following
+// the def-use chains. Once the values are stable, the instructions computing
+// a constant become ldconst, and the branches on a constant become jumps.
+//
+// Nothing whose behavior is undefined (signed overflow, division by zero) is
+// folded: it is left to happen at run time.
+class ConstantPropagation {
+public:
+  explicit ConstantPropagation(CFG *cfg);
+
+  void run();
+
+private:
+  struct Value {
+    enum Kind { Unknown, Constant, Varying } kind;
+    int constant;
+  };
+  typedef std::vector<Value> State; /**< by SymbolId */
+  typedef std::pair<BasicBlock *, BasicBlock *> Edge;
+
+  CFG *cfg;
+  State values;
+  // Instructions using each symbol, as (block, index in the block)
+  std::vector<std::vector<std::pair<BasicBlock *, int>>> uses;
+  std::unordered_set<BasicBlock *> executableBlocks;
+  std::set<Edge> executableEdges;
+  std::vector<Edge> flowWorklist;
+  std::vector<SymbolId> ssaWorklist;
+
+  // Value computed by the instruction, given the values of its operands
+  Value evaluate(const IRInstr &instr, const State &state) const;
+
+  void buildUses();
+  void propagate();
+  void visitEdge(const Edge &edge);
+  void visitPhi(BasicBlock *bb, const IRInstr &phi);
+  void visitInstruction(BasicBlock *bb, const IRInstr &instr);
+  void visitBranch(BasicBlock *bb);
+  void setValue(SymbolId symbol, Value value);
+  void rewrite();
+};
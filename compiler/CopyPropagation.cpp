@@ -0,0 +1,98 @@
+#include "CopyPropagation.h"
+
+CopyPropagation::CopyPropagation(CFG *cfg) : cfg(cfg) {}
+
+SymbolId CopyPropagation::find(SymbolId symbol) {
+  SymbolId root = symbol;
+  while (replacement[root] != root) {
+    root = replacement[root];
+  }
+  while (replacement[symbol] != root) {
+    SymbolId next = replacement[symbol];
+    replacement[symbol] = root;
+    symbol = next;
+  }
+  return root;
+}
+
+bool CopyPropagation::findTrivialPhis(
+    std::vector<std::vector<bool>> &removed) {
+  std::vector<BasicBlock *> &blocks = cfg->getBlocks();
+  bool found = false;
+  for (size_t b = 0; b < blocks.size(); b++) {
+    auto &instrs = blocks[b]->instrs;
+    for (size_t i = 0;
+         i < instrs.size() && instrs[i].getOperation() == IRInstr::phi; i++) {
+      if (removed[b][i]) {
+        continue;
+      }
+      SymbolId dest = instrs[i].getSymbolParam(0);
+      SymbolId value = invalidSymbol;
+      bool trivial = true;
+      for (int use : instrs[i].getUseIndices()) {
+        SymbolId source = find(instrs[i].getSymbolParam(use));
+        if (source == dest || source == value) {
+          continue;
+        }
+        trivial = value == invalidSymbol;
+        value = source;
+        if (!trivial) {
+          break;
+        }
+      }
+      if (trivial && value != invalidSymbol) {
+        replacement[dest] = value;
+        removed[b][i] = true;
+        found = true;
+      }
+    }
+  }
+  return found;
+}
+
+int CopyPropagation::run() {
+  replacement.resize(cfg->getSymbolCount());
+  for (SymbolId symbol = 0; symbol < replacement.size(); symbol++) {
+    replacement[symbol] = symbol;
+  }
+
+  std::vector<BasicBlock *> &blocks = cfg->getBlocks();
+  std::vector<std::vector<bool>> removed(blocks.size());
+  for (size_t b = 0; b < blocks.size(); b++) {
+    auto &instrs = blocks[b]->instrs;
+    removed[b].assign(instrs.size(), false);
+    for (size_t i = 0; i < instrs.size(); i++) {
+      if (!cfg->isCopy(instrs[i])) {
+        continue;
+      }
+      SymbolId dest = instrs[i].getSymbolParam(0);
+      SymbolId source = find(instrs[i].getSymbolParam(1));
+      // A copy reading its own result is only reached by reading a variable
+      // before assigning it
+      if (source != dest) {
+        replacement[dest] = source;
+        removed[b][i] = true;
+      }
+    }
+  }
+  while (findTrivialPhis(removed)) {
+  }
+
+  int count = 0;
+  for (size_t b = 0; b < blocks.size(); b++) {
+    auto &instrs = blocks[b]->instrs;
+    size_t kept = 0;
+    for (size_t i = 0; i < instrs.size(); i++) {
+      if (removed[b][i]) {
+        count++;
+        continue;
+      }
+      for (int use : instrs[i].getUseIndices()) {
+        instrs[i].setSymbolParam(use, find(instrs[i].getSymbolParam(use)));
+      }
+      instrs[kept++] = instrs[i];
+    }
+    instrs.erase(instrs.begin() + kept, instrs.end());
+  }
+  return count;
+}
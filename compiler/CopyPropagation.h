@@ -0,0 +1,26 @@
+#pragma once
+#include "ir.h"
+
+#include <vector>
+
+// Copy propagation, on the SSA form of the IR.
+//
+// A copy `x = y` makes x another name of y's value: the uses of x are
+// renamed to y and the copy goes away. So does a phi whose sources are all
+// the same value (or the phi itself, around a loop that does not change it).
+// A copy into a char from a wider value truncates it, and is kept.
+class CopyPropagation {
+public:
+  explicit CopyPropagation(CFG *cfg);
+
+  // Returns the number of copies and phis removed
+  int run();
+
+private:
+  CFG *cfg;
+  std::vector<SymbolId> replacement; /**< by SymbolId, itself if none */
+
+  SymbolId find(SymbolId symbol);
+  // Finds the phis merging a single value, returns whether any was found
+  bool findTrivialPhis(std::vector<std::vector<bool>> &removed);
+};
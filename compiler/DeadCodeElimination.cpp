@@ -0,0 +1,96 @@
+#include "DeadCodeElimination.h"
+#include "Liveness.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+DeadCodeElimination::DeadCodeElimination(CFG *cfg) : cfg(cfg) {}
+
+int DeadCodeElimination::run() {
+  int removed = truncateAfterReturns() + removeUnreachableBlocks();
+  int removedNow;
+  do {
+    removedNow = removeDeadInstructions();
+    removed += removedNow;
+  } while (removedNow > 0);
+  return removed;
+}
+
+int DeadCodeElimination::truncateAfterReturns() {
+  int removed = 0;
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    auto ret = std::find_if(
+        bb->instrs.begin(), bb->instrs.end(),
+        [](const IRInstr &instr) { return instr.getOperation() == IRInstr::ret; });
+    if (ret == bb->instrs.end()) {
+      continue;
+    }
+    removed += bb->instrs.end() - ret - 1;
+    bb->instrs.erase(ret + 1, bb->instrs.end());
+    bb->exit_true = nullptr;
+    bb->exit_false = nullptr;
+  }
+  return removed;
+}
+
+int DeadCodeElimination::removeUnreachableBlocks() {
+  std::vector<BasicBlock *> &blocks = cfg->getBlocks();
+  std::unordered_set<BasicBlock *> reachable = {blocks[0]};
+  std::vector<BasicBlock *> stack = {blocks[0]};
+  while (!stack.empty()) {
+    BasicBlock *bb = stack.back();
+    stack.pop_back();
+    for (BasicBlock *succ : {bb->exit_true, bb->exit_false}) {
+      if (succ != nullptr && reachable.insert(succ).second) {
+        stack.push_back(succ);
+      }
+    }
+  }
+
+  int removed = 0;
+  auto end = std::remove_if(blocks.begin(), blocks.end(), [&](BasicBlock *bb) {
+    if (reachable.count(bb)) {
+      return false;
+    }
+    removed += bb->instrs.size();
+    delete bb;
+    return true;
+  });
+  blocks.erase(end, blocks.end());
+  return removed;
+}
+
+int DeadCodeElimination::removeDeadInstructions() {
+  Liveness liveness(cfg);
+  int removed = 0;
+  for (BasicBlock *bb : liveness.getReversePostOrder()) {
+    BitVector live = liveness.liveOut(bb);
+    std::vector<bool> dead(bb->instrs.size(), false);
+    for (int i = bb->instrs.size() - 1; i >= 0; i--) {
+      const IRInstr &instr = bb->instrs[i];
+      std::vector<SymbolId> declared = instr.getDeclaredVariable();
+      if (!instr.hasSideEffects() &&
+          std::none_of(declared.begin(), declared.end(),
+                       [&](SymbolId symbol) { return live.test(symbol); })) {
+        dead[i] = true;
+        removed++;
+        continue;
+      }
+      for (SymbolId symbol : declared) {
+        live.reset(symbol);
+      }
+      for (SymbolId symbol : instr.getUsedVariables()) {
+        live.set(symbol);
+      }
+    }
+
+    int kept = 0;
+    for (size_t i = 0; i < bb->instrs.size(); i++) {
+      if (!dead[i]) {
+        bb->instrs[kept++] = bb->instrs[i];
+      }
+    }
+    bb->instrs.erase(bb->instrs.begin() + kept, bb->instrs.end());
+  }
+  return removed;
+}
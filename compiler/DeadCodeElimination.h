@@ -0,0 +1,25 @@
+#pragma once
+#include "ir.h"
+
+// Dead code elimination.
+//
+// Removes the instructions following a ret in their block, the blocks that
+// are not reachable from the entry block, and the instructions without side
+// effects whose result is not live afterwards: unused temporaries and dead
+// stores to variables. Each block is walked backwards from its live-out set,
+// so that a chain of dead instructions within a block goes in a single walk;
+// liveness is solved again as long as something is removed.
+class DeadCodeElimination {
+public:
+  explicit DeadCodeElimination(CFG *cfg);
+
+  // Returns the number of instructions removed
+  int run();
+
+private:
+  CFG *cfg;
+
+  int truncateAfterReturns();
+  int removeUnreachableBlocks();
+  int removeDeadInstructions();
+};
@@ -0,0 +1,164 @@
+#include "Dominators.h"
+
+Dominators::Dominators(CFG *cfg) {
+  computeReversePostOrder(cfg->getBlocks()[0]);
+  computeIdoms();
+  computeTree();
+  computeFrontiers();
+}
+
+void Dominators::computeReversePostOrder(BasicBlock *entry) {
+  // Iterative DFS: long if/else chains would overflow a recursive one
+  std::vector<BasicBlock *> postOrder;
+  std::unordered_map<BasicBlock *, bool> visited;
+  std::vector<std::pair<BasicBlock *, int>> stack;
+  stack.emplace_back(entry, 0);
+  visited[entry] = true;
+  while (!stack.empty()) {
+    BasicBlock *bb = stack.back().first;
+    int &nextExit = stack.back().second;
+    BasicBlock *succ = nullptr;
+    while (succ == nullptr && nextExit < 2) {
+      BasicBlock *candidate = nextExit == 0 ? bb->exit_true : bb->exit_false;
+      nextExit++;
+      if (candidate != nullptr && !visited[candidate]) {
+        succ = candidate;
+      }
+    }
+    if (succ != nullptr) {
+      visited[succ] = true;
+      stack.emplace_back(succ, 0);
+    } else {
+      postOrder.push_back(bb);
+      stack.pop_back();
+    }
+  }
+
+  rpo.assign(postOrder.rbegin(), postOrder.rend());
+  blocks.resize(rpo.size());
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    blockIndex[rpo[i]] = i;
+  }
+  for (BasicBlock *bb : rpo) {
+    for (BasicBlock *succ : {bb->exit_true, bb->exit_false}) {
+      if (succ == nullptr) {
+        continue;
+      }
+      auto &preds = blocks[blockIndex[succ]].predecessors;
+      if (preds.empty() || preds.back() != bb) {
+        preds.push_back(bb);
+      }
+    }
+  }
+}
+
+void Dominators::computeIdoms() {
+  // Blocks are identified by their index in rpo, the entry being 0
+  for (BlockInfo &info : blocks) {
+    info.idom = -1;
+  }
+  blocks[0].idom = 0;
+  auto intersect = [this](int a, int b) {
+    while (a != b) {
+      while (a > b) {
+        a = blocks[a].idom;
+      }
+      while (b > a) {
+        b = blocks[b].idom;
+      }
+    }
+    return a;
+  };
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 1; i < (int)rpo.size(); i++) {
+      int newIdom = -1;
+      for (BasicBlock *pred : blocks[i].predecessors) {
+        int p = blockIndex[pred];
+        if (blocks[p].idom < 0) {
+          continue;
+        }
+        newIdom = newIdom < 0 ? p : intersect(p, newIdom);
+      }
+      if (newIdom != blocks[i].idom) {
+        blocks[i].idom = newIdom;
+        changed = true;
+      }
+    }
+  }
+}
+
+void Dominators::computeTree() {
+  for (int i = 1; i < (int)rpo.size(); i++) {
+    blocks[blocks[i].idom].children.push_back(rpo[i]);
+  }
+
+  int preorder = 0;
+  int postorder = 0;
+  std::vector<std::pair<int, size_t>> stack = {{0, 0}};
+  blocks[0].preorder = preorder++;
+  while (!stack.empty()) {
+    int bb = stack.back().first;
+    size_t &nextChild = stack.back().second;
+    if (nextChild < blocks[bb].children.size()) {
+      int child = blockIndex[blocks[bb].children[nextChild++]];
+      blocks[child].preorder = preorder++;
+      stack.emplace_back(child, 0);
+    } else {
+      blocks[bb].postorder = postorder++;
+      stack.pop_back();
+    }
+  }
+}
+
+void Dominators::computeFrontiers() {
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    if (blocks[i].predecessors.size() < 2) {
+      continue;
+    }
+    for (BasicBlock *pred : blocks[i].predecessors) {
+      int runner = blockIndex[pred];
+      while (runner != blocks[i].idom) {
+        auto &frontier = blocks[runner].frontier;
+        if (frontier.empty() || frontier.back() != rpo[i]) {
+          frontier.push_back(rpo[i]);
+        }
+        runner = blocks[runner].idom;
+      }
+    }
+  }
+}
+
+BasicBlock *Dominators::idom(BasicBlock *bb) const {
+  int i = blockIndex.at(bb);
+  return i == 0 ? nullptr : rpo[blocks[i].idom];
+}
+
+bool Dominators::dominates(BasicBlock *a, BasicBlock *b) const {
+  const BlockInfo &infoA = blocks[blockIndex.at(a)];
+  const BlockInfo &infoB = blocks[blockIndex.at(b)];
+  return infoA.preorder <= infoB.preorder && infoB.postorder <= infoA.postorder;
+}
+
+const std::vector<BasicBlock *> &Dominators::children(BasicBlock *bb) const {
+  return blocks[blockIndex.at(bb)].children;
+}
+
+const std::vector<BasicBlock *> &Dominators::frontier(BasicBlock *bb) const {
+  return blocks[blockIndex.at(bb)].frontier;
+}
+
+const std::vector<BasicBlock *> &
+Dominators::predecessors(BasicBlock *bb) const {
+  return blocks[blockIndex.at(bb)].predecessors;
+}
+
+std::vector<BasicBlock *> Dominators::getTreePreorder() const {
+  std::vector<BasicBlock *> order(rpo.size());
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    order[blocks[i].preorder] = rpo[i];
+  }
+  return order;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "ir.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Dominator tree and dominance frontiers of the blocks reachable from the
+// entry block.
+//
+// The immediate dominators are computed with the iterative algorithm of
+// Cooper, Harvey and Kennedy over the reverse post-order, then the frontiers
+// by walking up from the predecessors of each join block. Dominance queries
+// use the preorder and postorder numbers of the tree.
+class Dominators {
+public:
+  explicit Dominators(CFG *cfg);
+
+  // Immediate dominator, nullptr for the entry block
+  BasicBlock *idom(BasicBlock *bb) const;
+  bool dominates(BasicBlock *a, BasicBlock *b) const;
+
+  const std::vector<BasicBlock *> &children(BasicBlock *bb) const;
+  const std::vector<BasicBlock *> &frontier(BasicBlock *bb) const;
+  // Reachable predecessors, each listed once
+  const std::vector<BasicBlock *> &predecessors(BasicBlock *bb) const;
+
+  // Reachable blocks, in reverse post-order from the entry block
+  const std::vector<BasicBlock *> &getReversePostOrder() const { return rpo; }
+  // Reachable blocks, each before the blocks it dominates
+  std::vector<BasicBlock *> getTreePreorder() const;
+
+private:
+  struct BlockInfo {
+    int idom;
+    std::vector<BasicBlock *> children;
+    std::vector<BasicBlock *> frontier;
+    std::vector<BasicBlock *> predecessors;
+    int preorder;
+    int postorder;
+  };
+
+  std::vector<BasicBlock *> rpo;
+  std::unordered_map<BasicBlock *, int> blockIndex; /**< in rpo */
+  std::vector<BlockInfo> blocks;
+
+  void computeReversePostOrder(BasicBlock *entry);
+  void computeIdoms();
+  void computeTree();
+  void computeFrontiers();
+};
@@ -0,0 +1,319 @@
+#include "InductionVariables.h"
+#include "Dominators.h"
+
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <tuple>
+#include <unordered_set>
+
+InductionVariables::InductionVariables(CFG *cfg) : cfg(cfg) {}
+
+int InductionVariables::run() {
+  defBlock.clear();
+  replacement.clear();
+  grow();
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    for (const IRInstr &instr : bb->instrs) {
+      for (SymbolId symbol : instr.getDeclaredVariable()) {
+        defBlock[symbol] = bb;
+      }
+      if (instr.getOperation() == IRInstr::ldconst) {
+        const std::string &literal =
+            std::get<std::string>(instr.getParams()[0]);
+        char *end;
+        long long value = std::strtoll(literal.c_str(), &end, 10);
+        if (*end == '\0' && value >= INT_MIN && value <= INT_MAX) {
+          constants[instr.getSymbolParam(1)] = value;
+        }
+      }
+    }
+  }
+
+  // Innermost loops first, found again for each header since the
+  // preheaders add blocks to the enclosing loops (as in
+  // LoopInvariantCodeMotion)
+  std::vector<BasicBlock *> headers;
+  {
+    Dominators dominators(cfg);
+    LoopInfo loops(dominators.getReversePostOrder());
+    for (const LoopInfo::Loop &loop : loops.getLoops()) {
+      headers.push_back(loop.header);
+    }
+  }
+  int reduced = 0;
+  for (auto header = headers.rbegin(); header != headers.rend(); header++) {
+    Dominators dominators(cfg);
+    LoopInfo loops(dominators.getReversePostOrder());
+    for (const LoopInfo::Loop &loop : loops.getLoops()) {
+      if (loop.header == *header) {
+        reduced += reduce(loop);
+      }
+    }
+  }
+  return reduced;
+}
+
+std::vector<InductionVariables::BasicVariable>
+InductionVariables::findBasicVariables(const LoopInfo::Loop &loop) {
+  std::unordered_set<BasicBlock *> inLoop(loop.blocks.begin(),
+                                          loop.blocks.end());
+  std::vector<BasicVariable> found;
+  for (const IRInstr &phi : loop.header->instrs) {
+    if (phi.getOperation() != IRInstr::phi) {
+      break;
+    }
+    SymbolId dest = phi.getSymbolParam(0);
+    if (phi.getParams().size() != 3 ||
+        cfg->getSymbol(dest).type != Type::INT) {
+      continue;
+    }
+    // One source from outside the loop, the other around it
+    int around = inLoop.count(phi.phiBlocks[0]) ? 0 : 1;
+    if (inLoop.count(phi.phiBlocks[1 - around]) ||
+        !inLoop.count(phi.phiBlocks[around])) {
+      continue;
+    }
+    SymbolId next = phi.getSymbolParam(around + 1);
+    BasicBlock *nextBlock = defBlock[next];
+    if (nextBlock == nullptr || !inLoop.count(nextBlock)) {
+      continue;
+    }
+
+    for (const IRInstr &instr : nextBlock->instrs) {
+      if (instr.getDeclaredVariable() != std::vector<SymbolId>{next}) {
+        continue;
+      }
+      std::vector<SymbolId> used = instr.getUsedVariables();
+      auto isConstant = [&](SymbolId symbol) {
+        return constants.count(symbol) != 0;
+      };
+      int step = 0;
+      switch (instr.getOperation()) {
+      case IRInstr::inc:
+      case IRInstr::dec:
+        if (used[0] == dest) {
+          step = instr.getOperation() == IRInstr::inc ? 1 : -1;
+        }
+        break;
+      case IRInstr::add:
+        if (used[0] == dest && isConstant(used[1])) {
+          step = constants[used[1]];
+        } else if (used[1] == dest && isConstant(used[0])) {
+          step = constants[used[0]];
+        }
+        break;
+      case IRInstr::sub:
+        if (used[0] == dest && isConstant(used[1]) &&
+            constants[used[1]] != INT_MIN) {
+          step = -constants[used[1]];
+        }
+        break;
+      default:
+        break;
+      }
+      if (step != 0) {
+        found.push_back({dest, next, phi.getSymbolParam(2 - around),
+                         nextBlock, step});
+      }
+      break;
+    }
+  }
+  return found;
+}
+
+int InductionVariables::reduce(const LoopInfo::Loop &loop) {
+  std::vector<BasicVariable> basics = findBasicVariables(loop);
+  if (basics.empty()) {
+    return 0;
+  }
+  std::unordered_set<BasicBlock *> inLoop(loop.blocks.begin(),
+                                          loop.blocks.end());
+  auto isInvariant = [&](SymbolId symbol) {
+    return constants.count(symbol) || defBlock[symbol] == nullptr ||
+           !inLoop.count(defBlock[symbol]);
+  };
+  // Basic variable of each symbol, and whether it is the value coming
+  // around the loop
+  std::unordered_map<SymbolId, std::pair<size_t, bool>> basicOf;
+  for (size_t b = 0; b < basics.size(); b++) {
+    basicOf[basics[b].phi] = {b, false};
+    basicOf[basics[b].next] = {b, true};
+  }
+
+  struct Candidate {
+    SymbolId dest;
+    size_t basic;
+    bool next;
+    SymbolId factor;
+  };
+  std::vector<Candidate> candidates;
+  for (BasicBlock *bb : loop.blocks) {
+    for (const IRInstr &instr : bb->instrs) {
+      if (instr.getOperation() != IRInstr::mul) {
+        continue;
+      }
+      SymbolId a = instr.getSymbolParam(0);
+      SymbolId b = instr.getSymbolParam(1);
+      SymbolId dest = instr.getSymbolParam(2);
+      if (!basicOf.count(a)) {
+        std::swap(a, b);
+      }
+      if (basicOf.count(a) && isInvariant(b) &&
+          cfg->getSymbol(dest).type == Type::INT) {
+        candidates.push_back({dest, basicOf[a].first, basicOf[a].second, b});
+      }
+    }
+  }
+  if (candidates.empty()) {
+    return 0;
+  }
+  BasicBlock *preheader = getPreheader(cfg, loop);
+  if (preheader == nullptr) {
+    return 0;
+  }
+
+  // Multiplications of the same variable by the same factor share their
+  // derived variable. Constant factors are compared by value.
+  std::map<std::tuple<size_t, bool, long long>, Derived> derived;
+  std::unordered_set<SymbolId> replaced;
+  for (const Candidate &candidate : candidates) {
+    bool constant = constants.count(candidate.factor) != 0;
+    auto key = std::make_tuple(candidate.basic, constant,
+                               constant ? constants[candidate.factor]
+                                        : (long long)candidate.factor);
+    auto it = derived.find(key);
+    if (it == derived.end()) {
+      it = derived
+               .emplace(key, derive(basics[candidate.basic], candidate.factor,
+                                    preheader, loop.header))
+               .first;
+    }
+    replacement[candidate.dest] =
+        candidate.next ? it->second.next : it->second.phi;
+    replaced.insert(candidate.dest);
+  }
+
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    auto &instrs = bb->instrs;
+    instrs.erase(std::remove_if(instrs.begin(), instrs.end(),
+                                [&](const IRInstr &instr) {
+                                  std::vector<SymbolId> declared =
+                                      instr.getDeclaredVariable();
+                                  return !declared.empty() &&
+                                         replaced.count(declared[0]);
+                                }),
+                 instrs.end());
+    for (IRInstr &instr : instrs) {
+      for (int use : instr.getUseIndices()) {
+        instr.setSymbolParam(use, replacement[instr.getSymbolParam(use)]);
+      }
+    }
+  }
+  for (const BasicVariable &basic : basics) {
+    removeUnused(basic, loop.header);
+  }
+  return candidates.size();
+}
+
+void InductionVariables::grow() {
+  for (SymbolId symbol = replacement.size(); symbol < cfg->getSymbolCount();
+       symbol++) {
+    replacement.push_back(symbol);
+  }
+  defBlock.resize(cfg->getSymbolCount(), nullptr);
+}
+
+SymbolId InductionVariables::loadConstant(BasicBlock *bb, int value) {
+  SymbolId symbol = bb->add_IRInstr(IRInstr::ldconst, Type::INT,
+                                    {std::to_string(value)});
+  grow();
+  defBlock[symbol] = bb;
+  constants[symbol] = value;
+  return symbol;
+}
+
+InductionVariables::Derived
+InductionVariables::derive(const BasicVariable &basic, SymbolId factor,
+                           BasicBlock *preheader, BasicBlock *header) {
+  // In the preheader: the initial value and the step, times the factor
+  auto it = constants.find(factor);
+  if (it != constants.end()) {
+    factor = loadConstant(preheader, it->second);
+  }
+  SymbolId start = preheader->add_IRInstr(IRInstr::mul, Type::INT,
+                                          {basic.initial, factor});
+  SymbolId step;
+  if (it != constants.end()) {
+    // Wrapping, like the additions it replaces the multiplications with
+    step = loadConstant(preheader,
+                        (int)(uint32_t)((long long)basic.step * it->second));
+  } else {
+    SymbolId basicStep = loadConstant(preheader, basic.step);
+    step = preheader->add_IRInstr(IRInstr::mul, Type::INT,
+                                  {basicStep, factor});
+  }
+
+  Derived result = {cfg->create_new_tempvar(Type::INT),
+                    cfg->create_new_tempvar(Type::INT)};
+  grow();
+
+  // A phi next to the one of the basic variable, with the same predecessors
+  for (auto phi = header->instrs.begin(); phi != header->instrs.end(); phi++) {
+    if (phi->getSymbolParam(0) != basic.phi) {
+      continue;
+    }
+    std::vector<Parameter> params = {result.phi};
+    for (BasicBlock *pred : phi->phiBlocks) {
+      params.push_back(pred == preheader ? start : result.next);
+    }
+    IRInstr derivedPhi(header, IRInstr::phi, Type::INT, params);
+    derivedPhi.phiBlocks = phi->phiBlocks;
+    header->instrs.insert(phi, derivedPhi);
+    break;
+  }
+  defBlock[result.phi] = header;
+
+  // Increased right after the basic variable
+  auto &instrs = basic.nextBlock->instrs;
+  for (auto instr = instrs.begin(); instr != instrs.end(); instr++) {
+    if (instr->getDeclaredVariable() == std::vector<SymbolId>{basic.next}) {
+      instrs.insert(instr + 1,
+                    IRInstr(basic.nextBlock, IRInstr::add, Type::INT,
+                            {result.phi, step, result.next}));
+      break;
+    }
+  }
+  defBlock[result.next] = basic.nextBlock;
+  return result;
+}
+
+void InductionVariables::removeUnused(const BasicVariable &basic,
+                                      BasicBlock *header) {
+  // The phi and the increment only used by each other
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    for (const IRInstr &instr : bb->instrs) {
+      std::vector<SymbolId> declared = instr.getDeclaredVariable();
+      for (SymbolId used : instr.getUsedVariables()) {
+        SymbolId user = declared.empty() ? invalidSymbol : declared[0];
+        if ((used == basic.phi && user != basic.next) ||
+            (used == basic.next && user != basic.phi)) {
+          return;
+        }
+      }
+    }
+  }
+  for (BasicBlock *bb : {header, basic.nextBlock}) {
+    auto &instrs = bb->instrs;
+    instrs.erase(std::remove_if(instrs.begin(), instrs.end(),
+                                [&](const IRInstr &instr) {
+                                  std::vector<SymbolId> declared =
+                                      instr.getDeclaredVariable();
+                                  return !declared.empty() &&
+                                         (declared[0] == basic.phi ||
+                                          declared[0] == basic.next);
+                                }),
+                 instrs.end());
+  }
+  removed++;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "LoopInfo.h"
+#include "ir.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Strength reduction of induction variables, on the SSA form of the IR.
+//
+// A basic induction variable is a phi of a loop header whose value coming
+// around the loop is the phi plus or minus a constant step: `i = i + 1`.
+// A multiplication of it by a loop-invariant factor, `j = i * 8`, is a
+// derived induction variable: it becomes a phi of its own, starting at the
+// initial value times the factor (computed in the preheader) and increased
+// by the step times the factor right where i is. A basic induction variable
+// left with no use but its own increment is then removed.
+class InductionVariables {
+public:
+  explicit InductionVariables(CFG *cfg);
+
+  // Returns the number of multiplications replaced
+  int run();
+
+  // Number of basic induction variables removed by run
+  int getRemovedCount() const { return removed; }
+
+private:
+  struct BasicVariable {
+    SymbolId phi;       /**< value at the start of an iteration */
+    SymbolId next;      /**< value coming around the loop */
+    SymbolId initial;   /**< value entering the loop */
+    BasicBlock *nextBlock;
+    int step;
+  };
+  struct Derived {
+    SymbolId phi;
+    SymbolId next;
+  };
+
+  CFG *cfg;
+  int removed = 0;
+  std::vector<BasicBlock *> defBlock;       /**< by SymbolId, nullptr if none */
+  std::unordered_map<SymbolId, int> constants; /**< symbols set by ldconst */
+  std::vector<SymbolId> replacement;        /**< by SymbolId, itself if none */
+
+  std::vector<BasicVariable> findBasicVariables(const LoopInfo::Loop &loop);
+  int reduce(const LoopInfo::Loop &loop);
+  // Creates the derived variable basic * factor
+  Derived derive(const BasicVariable &basic, SymbolId factor,
+                 BasicBlock *preheader, BasicBlock *header);
+  // Extends the tables to the symbols created since
+  void grow();
+  SymbolId loadConstant(BasicBlock *bb, int value);
+  void removeUnused(const BasicVariable &basic, BasicBlock *header);
+};
@@ -0,0 +1,265 @@
+#include "Inliner.h"
+#include "CodeGenVisitor.h"
+#include "Options.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+// Estimated instructions saved by inlining: saving the live caller-saved
+// registers, moving the arguments, the call, the prologue and the epilogue
+const int callCost = 6;
+const int argumentCost = 1;
+// A constant argument usually lets part of the inlined body fold away
+const int constantArgumentBonus = 4;
+// Size above which a function receives no more inlined calls
+const int maxCallerSize = 2000;
+} // namespace
+
+Inliner::Inliner(const std::vector<std::shared_ptr<CFG>> &functions) {
+  for (const std::shared_ptr<CFG> &cfg : functions) {
+    if (hasBody(cfg.get())) {
+      this->functions.push_back(cfg.get());
+    }
+  }
+}
+
+int Inliner::run() {
+  if (Options::getInlineLimit() < 0) {
+    return 0;
+  }
+  std::vector<std::vector<CFG *>> components = findComponents();
+  for (size_t i = 0; i < components.size(); i++) {
+    for (CFG *cfg : components[i]) {
+      component[cfg] = i;
+    }
+  }
+  int inlined = 0;
+  for (const std::vector<CFG *> &members : components) {
+    for (CFG *cfg : members) {
+      inlined += inlineCalls(cfg);
+    }
+  }
+  return inlined;
+}
+
+int Inliner::size(CFG *cfg) {
+  int size = 0;
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    for (const IRInstr &instr : bb->instrs) {
+      IRInstr::Operation op = instr.getOperation();
+      if (op != IRInstr::param && op != IRInstr::param_decl) {
+        size++;
+      }
+    }
+  }
+  return size;
+}
+
+bool Inliner::hasBody(CFG *cfg) {
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    for (const IRInstr &instr : bb->instrs) {
+      if (instr.getOperation() == IRInstr::ret) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+std::vector<CFG *> Inliner::callees(CFG *cfg) {
+  std::vector<CFG *> result;
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    for (const IRInstr &instr : bb->instrs) {
+      if (instr.getOperation() == IRInstr::call) {
+        CFG *callee = cfg->get_visitor()->getFunction(
+            std::get<std::string>(instr.getParams()[0]));
+        if (hasBody(callee)) {
+          result.push_back(callee);
+        }
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<std::vector<CFG *>> Inliner::findComponents() {
+  std::vector<std::vector<CFG *>> components;
+  std::unordered_map<CFG *, int> index;
+  std::unordered_map<CFG *, int> lowLink;
+  std::unordered_set<CFG *> onStack;
+  std::vector<CFG *> stack;
+  std::function<void(CFG *)> visit = [&](CFG *cfg) {
+    int number = index.size();
+    index[cfg] = lowLink[cfg] = number;
+    stack.push_back(cfg);
+    onStack.insert(cfg);
+    for (CFG *callee : callees(cfg)) {
+      if (!index.count(callee)) {
+        visit(callee);
+        lowLink[cfg] = std::min(lowLink[cfg], lowLink[callee]);
+      } else if (onStack.count(callee)) {
+        lowLink[cfg] = std::min(lowLink[cfg], index[callee]);
+      }
+    }
+    if (lowLink[cfg] == index[cfg]) {
+      std::vector<CFG *> members;
+      CFG *member;
+      do {
+        member = stack.back();
+        stack.pop_back();
+        onStack.erase(member);
+        members.push_back(member);
+      } while (member != cfg);
+      components.push_back(members);
+    }
+  };
+  for (CFG *cfg : functions) {
+    if (!index.count(cfg)) {
+      visit(cfg);
+    }
+  }
+  return components;
+}
+
+bool Inliner::shouldInline(CFG *caller, const IRInstr &call, CFG *callee,
+                           const std::unordered_set<SymbolId> &constants) {
+  if (!hasBody(callee) || component[callee] == component[caller]) {
+    return false;
+  }
+  std::vector<SymbolId> arguments = call.getUsedVariables();
+  int cost = size(callee) - callCost - argumentCost * arguments.size();
+  for (SymbolId argument : arguments) {
+    if (constants.count(argument)) {
+      cost -= constantArgumentBonus;
+    }
+  }
+  return cost <= Options::getInlineLimit() &&
+         size(caller) + size(callee) <= maxCallerSize;
+}
+
+int Inliner::inlineCalls(CFG *caller) {
+  // Arguments known to be constants: the temporaries loading a literal
+  std::unordered_set<SymbolId> constants;
+  for (BasicBlock *bb : caller->getBlocks()) {
+    for (const IRInstr &instr : bb->instrs) {
+      if (instr.getOperation() == IRInstr::ldconst) {
+        constants.insert(instr.getSymbolParam(1));
+      }
+    }
+  }
+
+  // The blocks copied from a callee are not visited: their calls were not
+  // inlined into the callee, and recursion could make them grow forever
+  int inlined = 0;
+  std::vector<BasicBlock *> worklist = caller->getBlocks();
+  while (!worklist.empty()) {
+    BasicBlock *bb = worklist.back();
+    worklist.pop_back();
+    for (size_t i = 0; i < bb->instrs.size(); i++) {
+      const IRInstr &instr = bb->instrs[i];
+      if (instr.getOperation() != IRInstr::call) {
+        continue;
+      }
+      CFG *callee = caller->get_visitor()->getFunction(
+          std::get<std::string>(instr.getParams()[0]));
+      if (shouldInline(caller, instr, callee, constants)) {
+        worklist.push_back(inlineCall(caller, bb, i, callee));
+        inlined++;
+        break;
+      }
+    }
+  }
+  return inlined;
+}
+
+BasicBlock *Inliner::inlineCall(CFG *caller, BasicBlock *bb, size_t index,
+                                CFG *callee) {
+  IRInstr call = bb->instrs[index];
+  std::vector<SymbolId> arguments = call.getUsedVariables();
+  std::vector<SymbolId> result = call.getDeclaredVariable();
+
+  // The instructions after the call move to the continuation block
+  BasicBlock *continuation = new BasicBlock(caller, caller->new_BB_name());
+  for (size_t i = index + 1; i < bb->instrs.size(); i++) {
+    const IRInstr &instr = bb->instrs[i];
+    continuation->instrs.emplace_back(continuation, instr.getOperation(),
+                                      instr.getType(), instr.getParams());
+  }
+  continuation->exit_true = bb->exit_true;
+  continuation->exit_false = bb->exit_false;
+  continuation->test_var_name = bb->test_var_name;
+  continuation->falseCondition = bb->falseCondition;
+  bb->instrs.erase(bb->instrs.begin() + index, bb->instrs.end());
+  caller->getBlocks().push_back(continuation);
+
+  bb->eraseParams(arguments, bb->instrs.size());
+
+  std::unordered_map<SymbolId, SymbolId> renamed;
+  auto rename = [&](SymbolId symbol) {
+    auto it = renamed.find(symbol);
+    if (it != renamed.end()) {
+      return it->second;
+    }
+    const Symbol &original = callee->getSymbol(symbol);
+    SymbolId copy = caller->create_new_tempvar(original.type);
+    caller->getSymbol(copy).lexeme = callee->get_name() + "." +
+                                     original.lexeme + "." +
+                                     std::to_string(copy);
+    renamed[symbol] = copy;
+    return copy;
+  };
+  const std::vector<FunctionParameter> &parameters =
+      callee->get_parameters_type();
+  for (size_t i = 0; i < parameters.size(); i++) {
+    bb->add_IRInstr(IRInstr::var_assign, parameters[i].type,
+                    {rename(parameters[i].symbol), arguments[i]});
+  }
+
+  std::unordered_map<BasicBlock *, BasicBlock *> copies;
+  for (BasicBlock *source : callee->getBlocks()) {
+    BasicBlock *copy = new BasicBlock(
+        caller, source->label.empty() ? "" : caller->new_BB_name());
+    copy->test_var_name = source->test_var_name;
+    copy->falseCondition = source->falseCondition;
+    copies[source] = copy;
+    caller->getBlocks().push_back(copy);
+  }
+  for (BasicBlock *source : callee->getBlocks()) {
+    BasicBlock *copy = copies[source];
+    bool returns = false;
+    for (const IRInstr &instr : source->instrs) {
+      IRInstr::Operation op = instr.getOperation();
+      if (op == IRInstr::param_decl) {
+        continue;
+      }
+      if (op == IRInstr::ret) {
+        if (!result.empty()) {
+          copy->add_IRInstr(IRInstr::var_assign, instr.getType(),
+                            {result[0], rename(instr.getSymbolParam(0))});
+        }
+        returns = true;
+        break;
+      }
+      std::vector<Parameter> params = instr.getParams();
+      for (Parameter &param : params) {
+        if (std::holds_alternative<SymbolId>(param)) {
+          param = rename(std::get<SymbolId>(param));
+        }
+      }
+      copy->instrs.emplace_back(copy, op, instr.getType(), params);
+    }
+    if (returns || source->exit_true == nullptr) {
+      copy->exit_true = continuation;
+    } else {
+      copy->exit_true = copies[source->exit_true];
+      if (source->exit_false != nullptr) {
+        copy->exit_false = copies[source->exit_false];
+      }
+    }
+  }
+
+  bb->exit_true = copies[callee->getBlocks()[0]];
+  bb->exit_false = nullptr;
+  return continuation;
+}
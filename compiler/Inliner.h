@@ -0,0 +1,47 @@
+#pragma once
+#include "ir.h"
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Inlining of calls, on the IR of every function before it is optimized.
+//
+// An inlined call is replaced by a copy of the blocks of the callee: its
+// symbols become new symbols of the caller, its parameters are assigned the
+// arguments, and each ret assigns the result of the call and jumps to a block
+// continuing the caller after the call. A call is inlined when the size of
+// the callee, less the cost of the call sequence and a bonus for each
+// constant argument, is within Options::getInlineLimit, and as long as the
+// caller stays under a maximum size.
+//
+// The functions are visited by strongly connected components of the call
+// graph, callees first, so that a callee already holds its own inlined calls.
+// Calls within a component (recursion) are never inlined.
+class Inliner {
+public:
+  explicit Inliner(const std::vector<std::shared_ptr<CFG>> &functions);
+
+  // Returns the number of calls inlined
+  int run();
+
+private:
+  std::vector<CFG *> functions; /**< the ones with a body */
+  std::unordered_map<CFG *, int> component;
+
+  // Number of instructions of the function
+  static int size(CFG *cfg);
+  // Functions defined in the program (not putchar and getchar)
+  static bool hasBody(CFG *cfg);
+  static std::vector<CFG *> callees(CFG *cfg);
+
+  // Components in reverse topological order (Tarjan): callees first
+  std::vector<std::vector<CFG *>> findComponents();
+  bool shouldInline(CFG *caller, const IRInstr &call, CFG *callee,
+                    const std::unordered_set<SymbolId> &constants);
+  int inlineCalls(CFG *caller);
+  // Inlines the call at bb->instrs[index], returns the continuation block
+  BasicBlock *inlineCall(CFG *caller, BasicBlock *bb, size_t index,
+                         CFG *callee);
+};
@@ -0,0 +1,143 @@
+#include "InterferenceGraph.h"
+
+#include <algorithm>
+#include <utility>
+
+InterferenceGraph::InterferenceGraph(size_t symbolCount)
+    : present(symbolCount, false), nodeCount(0),
+      matrix(symbolCount > 0 ? symbolCount * (symbolCount - 1) / 2 : 0),
+      adjacency(symbolCount) {}
+
+size_t InterferenceGraph::edgeIndex(SymbolId a, SymbolId b) {
+  // Lower triangle without the diagonal: row a holds the columns [0, a)
+  if (a < b) {
+    std::swap(a, b);
+  }
+  return (size_t)a * (a - 1) / 2 + b;
+}
+
+void InterferenceGraph::addNode(SymbolId node) {
+  if (!present[node]) {
+    present[node] = true;
+    nodeCount++;
+  }
+}
+
+void InterferenceGraph::addEdge(SymbolId a, SymbolId b) {
+  addNode(a);
+  addNode(b);
+  if (a == b) {
+    return;
+  }
+  size_t index = edgeIndex(a, b);
+  if (!matrix.test(index)) {
+    matrix.set(index);
+    adjacency[a].push_back(b);
+    adjacency[b].push_back(a);
+  }
+}
+
+void InterferenceGraph::merge(SymbolId into, SymbolId from) {
+  for (SymbolId neighbor : adjacency[from]) {
+    std::vector<SymbolId> &list = adjacency[neighbor];
+    list.erase(std::find(list.begin(), list.end(), from));
+    matrix.reset(edgeIndex(from, neighbor));
+    addEdge(into, neighbor);
+  }
+  adjacency[from].clear();
+  if (present[from]) {
+    present[from] = false;
+    nodeCount--;
+  }
+}
+
+bool InterferenceGraph::interferes(SymbolId a, SymbolId b) const {
+  return a != b && matrix.test(edgeIndex(a, b));
+}
+
+DegreeBuckets::DegreeBuckets(const InterferenceGraph &graph,
+                             const std::vector<double> &spillCost)
+    : graph(graph), spillCost(spillCost), remaining(0),
+      removed(graph.getSymbolCount(), true),
+      currentDegree(graph.getSymbolCount(), 0),
+      head(graph.getSymbolCount() + 1, invalidSymbol),
+      next(graph.getSymbolCount(), invalidSymbol),
+      prev(graph.getSymbolCount(), invalidSymbol) {
+  for (SymbolId node = 0; node < graph.getSymbolCount(); node++) {
+    if (graph.contains(node)) {
+      removed[node] = false;
+      currentDegree[node] = graph.degree(node);
+      link(node);
+      remaining++;
+    }
+  }
+  std::vector<Candidate> initial;
+  initial.reserve(remaining);
+  for (SymbolId node = 0; node < graph.getSymbolCount(); node++) {
+    if (!removed[node]) {
+      initial.push_back(candidate(node));
+    }
+  }
+  candidates = decltype(candidates)(std::greater<Candidate>(),
+                                    std::move(initial));
+}
+
+DegreeBuckets::Candidate DegreeBuckets::candidate(SymbolId node) const {
+  size_t d = currentDegree[node];
+  return {spillCost[node] / std::max<size_t>(d, 1), node, d};
+}
+
+void DegreeBuckets::link(SymbolId node) {
+  size_t d = currentDegree[node];
+  prev[node] = invalidSymbol;
+  next[node] = head[d];
+  if (head[d] != invalidSymbol) {
+    prev[head[d]] = node;
+  }
+  head[d] = node;
+}
+
+void DegreeBuckets::unlink(SymbolId node) {
+  if (prev[node] != invalidSymbol) {
+    next[prev[node]] = next[node];
+  } else {
+    head[currentDegree[node]] = next[node];
+  }
+  if (next[node] != invalidSymbol) {
+    prev[next[node]] = prev[node];
+  }
+}
+
+SymbolId DegreeBuckets::findNodeBelow(size_t maxDegree) const {
+  for (size_t d = 0; d < maxDegree && d < head.size(); d++) {
+    if (head[d] != invalidSymbol) {
+      return head[d];
+    }
+  }
+  return invalidSymbol;
+}
+
+SymbolId DegreeBuckets::cheapestRemaining() {
+  while (!candidates.empty()) {
+    Candidate top = candidates.top();
+    if (!removed[top.node] && top.degree == currentDegree[top.node]) {
+      return top.node;
+    }
+    candidates.pop();
+  }
+  return invalidSymbol;
+}
+
+void DegreeBuckets::remove(SymbolId node) {
+  unlink(node);
+  removed[node] = true;
+  remaining--;
+  for (SymbolId neighbor : graph.neighbors(node)) {
+    if (!removed[neighbor]) {
+      unlink(neighbor);
+      currentDegree[neighbor]--;
+      link(neighbor);
+      candidates.push(candidate(neighbor));
+    }
+  }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "BitVector.h"
+#include "Symbol.h"
+
+#include <functional>
+#include <queue>
+#include <vector>
+
+// Interference graph over the symbols of a function.
+//
+// Edges are stored twice: in a triangular bit matrix, so that testing or
+// adding an edge is O(1) without duplicates, and in adjacency lists, so that
+// the neighbors of a node can be walked in O(degree).
+class InterferenceGraph {
+public:
+  explicit InterferenceGraph(size_t symbolCount);
+
+  void addNode(SymbolId node);
+  void addEdge(SymbolId a, SymbolId b);
+  // Coalesces two nodes that do not interfere: into gets the edges of from,
+  // which leaves the graph
+  void merge(SymbolId into, SymbolId from);
+
+  bool contains(SymbolId node) const { return present[node]; }
+  bool interferes(SymbolId a, SymbolId b) const;
+
+  const std::vector<SymbolId> &neighbors(SymbolId node) const {
+    return adjacency[node];
+  }
+  size_t degree(SymbolId node) const { return adjacency[node].size(); }
+
+  // Number of symbols the graph can hold, nodes are in [0, getSymbolCount())
+  size_t getSymbolCount() const { return present.size(); }
+  size_t getNodeCount() const { return nodeCount; }
+
+private:
+  std::vector<bool> present;
+  size_t nodeCount;
+  BitVector matrix;
+  std::vector<std::vector<SymbolId>> adjacency;
+
+  static size_t edgeIndex(SymbolId a, SymbolId b);
+};
+
+// Nodes of an interference graph bucketed by their current degree, for the
+// simplify phase of the coloring. Removing a node updates the degree of its
+// neighbors in O(degree).
+//
+// The spill candidates are kept in a min-heap by spill cost per degree,
+// updated lazily: a node is pushed again when its degree drops, and the
+// entries of removed nodes or of an older degree are skipped when popped. A
+// spill choice thus costs O(log E) amortized instead of a walk over the graph.
+class DegreeBuckets {
+public:
+  // spillCost is indexed by SymbolId
+  DegreeBuckets(const InterferenceGraph &graph,
+                const std::vector<double> &spillCost);
+
+  bool empty() const { return remaining == 0; }
+
+  // Returns a remaining node of degree < maxDegree, or invalidSymbol
+  SymbolId findNodeBelow(size_t maxDegree) const;
+  // Returns the remaining node with the lowest spill cost per interference,
+  // the lowest SymbolId among equal ones, or invalidSymbol
+  SymbolId cheapestRemaining();
+
+  bool isRemoved(SymbolId node) const { return removed[node]; }
+  size_t degree(SymbolId node) const { return currentDegree[node]; }
+  void remove(SymbolId node);
+
+private:
+  struct Candidate {
+    double ratio; /**< spill cost per degree when pushed */
+    SymbolId node;
+    size_t degree;
+
+    bool operator>(const Candidate &other) const {
+      return ratio > other.ratio || (ratio == other.ratio && node > other.node);
+    }
+  };
+
+  const InterferenceGraph &graph;
+  const std::vector<double> &spillCost;
+  size_t remaining;
+  std::vector<bool> removed;
+  std::vector<size_t> currentDegree;
+
+  // Doubly linked list of the nodes of each degree
+  std::vector<SymbolId> head;
+  std::vector<SymbolId> next;
+  std::vector<SymbolId> prev;
+
+  std::priority_queue<Candidate, std::vector<Candidate>,
+                      std::greater<Candidate>>
+      candidates;
+
+  void link(SymbolId node);
+  void unlink(SymbolId node);
+  Candidate candidate(SymbolId node) const;
+};
@@ -0,0 +1,181 @@
+#include "LinearScan.h"
+
+#include <algorithm>
+#include <climits>
+
+LinearScan::LinearScan(CFG *cfg, const Liveness &liveness, int registerCount)
+    : cfg(cfg), liveness(liveness), registerCount(registerCount),
+      symbolCount(cfg->getSymbolCount()), slotCount(0) {}
+
+void LinearScan::run() {
+  cfg->registerAssignment.assign(symbolCount, -1);
+  cfg->splitInfo = SplitInfo();
+  cfg->splitInfo.splitSlot.assign(symbolCount, INT_MAX);
+
+  numberSlots();
+  buildIntervals();
+  allocate();
+  resolveEdges();
+}
+
+void LinearScan::numberSlots() {
+  for (BasicBlock *bb : liveness.getReversePostOrder()) {
+    cfg->splitInfo.firstSlot[bb] = slotCount;
+    slotCount += bb->instrs.size() + 1;
+  }
+  blockStart.assign(slotCount, false);
+  for (auto &entry : cfg->splitInfo.firstSlot) {
+    blockStart[entry.second] = true;
+  }
+}
+
+void LinearScan::buildIntervals() {
+  from.assign(symbolCount, INT_MAX);
+  to.assign(symbolCount, -1);
+  auto extend = [this](SymbolId symbol, int position) {
+    from[symbol] = std::min(from[symbol], position);
+    to[symbol] = std::max(to[symbol], position);
+  };
+
+  // The prologue writes every parameter at once, even the unused ones
+  for (const FunctionParameter &parameter : cfg->get_parameters_type()) {
+    extend(parameter.symbol, 0);
+  }
+
+  for (BasicBlock *bb : liveness.getReversePostOrder()) {
+    int slot = cfg->splitInfo.firstSlot[bb];
+    int branchSlot = slot + bb->instrs.size();
+    liveness.liveIn(bb).forEach(
+        [&](size_t symbol) { extend(symbol, 2 * slot); });
+    liveness.liveOut(bb).forEach(
+        [&](size_t symbol) { extend(symbol, 2 * branchSlot + 1); });
+    for (auto &instr : bb->instrs) {
+      for (SymbolId symbol : instr.getUsedVariables()) {
+        extend(symbol, 2 * slot);
+      }
+      for (SymbolId symbol : instr.getDeclaredVariable()) {
+        extend(symbol, 2 * slot + 1);
+      }
+      slot++;
+    }
+  }
+}
+
+std::vector<SymbolId> LinearScan::sortByStart() const {
+  // Counting sort: positions are bounded by twice the number of slots
+  std::vector<int> count(2 * slotCount + 1, 0);
+  for (SymbolId symbol = 0; symbol < symbolCount; symbol++) {
+    if (to[symbol] >= 0) {
+      count[from[symbol] + 1]++;
+    }
+  }
+  for (size_t i = 1; i < count.size(); i++) {
+    count[i] += count[i - 1];
+  }
+  std::vector<SymbolId> order(count.back());
+  for (SymbolId symbol = 0; symbol < symbolCount; symbol++) {
+    if (to[symbol] >= 0) {
+      order[count[from[symbol]]++] = symbol;
+    }
+  }
+  return order;
+}
+
+void LinearScan::allocate() {
+  std::vector<int> &assignment = cfg->registerAssignment;
+  SplitInfo &split = cfg->splitInfo;
+  std::vector<SymbolId> active; // at most registerCount intervals
+  std::vector<bool> registerFree(registerCount, true);
+
+  for (SymbolId current : sortByStart()) {
+    for (size_t i = 0; i < active.size();) {
+      if (to[active[i]] < from[current]) {
+        registerFree[assignment[active[i]]] = true;
+        active[i] = active.back();
+        active.pop_back();
+      } else {
+        i++;
+      }
+    }
+
+    int freeRegister = -1;
+    for (int reg : cfg->registerPreference(current)) {
+      if (reg < registerCount && registerFree[reg] &&
+          cfg->canUseRegister(current, reg)) {
+        freeRegister = reg;
+        break;
+      }
+    }
+    if (freeRegister >= 0) {
+      registerFree[freeRegister] = false;
+      assignment[current] = freeRegister;
+      active.push_back(current);
+      continue;
+    }
+
+    // No register left: the interval ending last, among those whose
+    // register current may use, gives up its register
+    auto victim = active.end();
+    for (auto it = active.begin(); it != active.end(); it++) {
+      if (cfg->canUseRegister(current, assignment[*it]) &&
+          (victim == active.end() || to[*it] > to[*victim])) {
+        victim = it;
+      }
+    }
+    if (victim == active.end() || to[*victim] <= to[current]) {
+      continue; // current stays in its stack slot
+    }
+    SymbolId spilled = *victim;
+    // The split happens before the instruction starting the current interval
+    int splitSlot = from[current] / 2;
+    if (2 * splitSlot <= from[spilled]) {
+      assignment[current] = assignment[spilled];
+      assignment[spilled] = -1;
+    } else {
+      split.splitSlot[spilled] = splitSlot;
+      // At a block start, the moves are done on the incoming edges
+      if (!blockStart[splitSlot]) {
+        split.stores[splitSlot].push_back(spilled);
+      }
+      assignment[current] = assignment[spilled];
+    }
+    *victim = current;
+  }
+}
+
+void LinearScan::resolveEdges() {
+  SplitInfo &split = cfg->splitInfo;
+  bool anySplit = std::any_of(split.splitSlot.begin(), split.splitSlot.end(),
+                              [](int slot) { return slot != INT_MAX; });
+  if (!anySplit) {
+    return;
+  }
+
+  for (BasicBlock *bb : liveness.getReversePostOrder()) {
+    int branchSlot = split.firstSlot[bb] + bb->instrs.size();
+    for (BasicBlock *succ : {bb->exit_true, bb->exit_false}) {
+      if (succ == nullptr) {
+        continue;
+      }
+      int succSlot = split.firstSlot[succ];
+      std::vector<SplitMove> stores, loads;
+      liveness.liveIn(succ).forEach([&](size_t symbol) {
+        if (cfg->registerAssignment[symbol] < 0) {
+          return;
+        }
+        bool inRegisterBefore = branchSlot < split.splitSlot[symbol];
+        bool inRegisterAfter = succSlot < split.splitSlot[symbol];
+        if (inRegisterBefore && !inRegisterAfter) {
+          stores.push_back({(SymbolId)symbol, false});
+        } else if (!inRegisterBefore && inRegisterAfter) {
+          loads.push_back({(SymbolId)symbol, true});
+        }
+      });
+      // Stores first: a load may reuse the register of a stored symbol
+      stores.insert(stores.end(), loads.begin(), loads.end());
+      if (!stores.empty()) {
+        split.edgeMoves[{bb, succ}] = stores;
+      }
+    }
+  }
+}
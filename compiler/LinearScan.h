@@ -0,0 +1,46 @@
+#pragma once
+#include "Liveness.h"
+#include "ir.h"
+
+#include <vector>
+
+// Linear-scan register allocation, selected with -fregalloc=linear.
+//
+// The instructions of the reachable blocks are numbered in reverse
+// post-order, with one more slot per block for its branch. Each symbol gets
+// a single live interval covering all the slots where it is live, and the
+// intervals are allocated in order of their start. When no register is free,
+// the interval ending last is split: it keeps its register up to the current
+// slot and lives in its stack slot (Symbol::offset) from there on. The moves
+// this requires are recorded in the SplitInfo of the CFG.
+//
+// Apart from the sort (a counting sort on slots), the allocation is linear
+// in the number of instructions times the number of registers.
+class LinearScan {
+public:
+  LinearScan(CFG *cfg, const Liveness &liveness, int registerCount);
+
+  // Fills registerAssignment and splitInfo of the CFG
+  void run();
+
+private:
+  CFG *cfg;
+  const Liveness &liveness;
+  int registerCount;
+  SymbolId symbolCount;
+
+  int slotCount;
+  std::vector<bool> blockStart; /**< by slot */
+
+  // Interval of each symbol, in positions: the uses of slot s are at 2s and
+  // its definition at 2s + 1, so that an operand and the result of the same
+  // instruction can share a register.
+  std::vector<int> from;
+  std::vector<int> to;
+
+  void numberSlots();
+  void buildIntervals();
+  std::vector<SymbolId> sortByStart() const;
+  void allocate();
+  void resolveEdges();
+};
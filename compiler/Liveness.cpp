@@ -0,0 +1,118 @@
+#include "Liveness.h"
+
+#include <deque>
+#include <utility>
+
+Liveness::Liveness(CFG *cfg) : symbolCount(cfg->getSymbolCount()) {
+  computeReversePostOrder(cfg->getBlocks()[0]);
+  computeLocalSets();
+  solve();
+}
+
+void Liveness::computeReversePostOrder(BasicBlock *entry) {
+  // Iterative DFS: long if/else chains would overflow a recursive one
+  std::vector<BasicBlock *> postOrder;
+  std::unordered_map<BasicBlock *, bool> visited;
+  std::vector<std::pair<BasicBlock *, int>> stack;
+  stack.emplace_back(entry, 0);
+  visited[entry] = true;
+  while (!stack.empty()) {
+    BasicBlock *bb = stack.back().first;
+    int &nextExit = stack.back().second;
+    BasicBlock *succ = nullptr;
+    while (succ == nullptr && nextExit < 2) {
+      BasicBlock *candidate = nextExit == 0 ? bb->exit_true : bb->exit_false;
+      nextExit++;
+      if (candidate != nullptr && !visited[candidate]) {
+        succ = candidate;
+      }
+    }
+    if (succ != nullptr) {
+      visited[succ] = true;
+      stack.emplace_back(succ, 0);
+    } else {
+      postOrder.push_back(bb);
+      stack.pop_back();
+    }
+  }
+
+  rpo.assign(postOrder.rbegin(), postOrder.rend());
+  blocks.resize(rpo.size());
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    blockIndex[rpo[i]] = i;
+  }
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    for (BasicBlock *succ : {rpo[i]->exit_true, rpo[i]->exit_false}) {
+      if (succ != nullptr) {
+        int succIndex = blockIndex[succ];
+        blocks[i].successors.push_back(succIndex);
+        blocks[succIndex].predecessors.push_back(i);
+      }
+    }
+  }
+}
+
+void Liveness::computeLocalSets() {
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    BlockInfo &info = blocks[i];
+    info.use = BitVector(symbolCount);
+    info.def = BitVector(symbolCount);
+    info.in = BitVector(symbolCount);
+    info.out = BitVector(symbolCount);
+    // A use only counts if it is not preceded by a def in the same block
+    for (auto &instr : rpo[i]->instrs) {
+      for (SymbolId symbol : instr.getUsedVariables()) {
+        if (!info.def.test(symbol)) {
+          info.use.set(symbol);
+        }
+      }
+      for (SymbolId symbol : instr.getDeclaredVariable()) {
+        info.def.set(symbol);
+      }
+    }
+  }
+}
+
+void Liveness::solve() {
+  // Liveness flows backwards, so the reverse post-order is walked from its
+  // end: most successors are then up to date when a block is processed.
+  std::deque<int> worklist;
+  std::vector<bool> queued(rpo.size(), true);
+  for (int i = rpo.size() - 1; i >= 0; i--) {
+    worklist.push_back(i);
+  }
+
+  BitVector newIn(symbolCount);
+  while (!worklist.empty()) {
+    int i = worklist.front();
+    worklist.pop_front();
+    queued[i] = false;
+
+    BlockInfo &info = blocks[i];
+    for (int succ : info.successors) {
+      info.out.unionWith(blocks[succ].in);
+    }
+
+    // in = use | (out - def)
+    newIn = info.out;
+    newIn.subtract(info.def);
+    newIn.unionWith(info.use);
+    if (newIn != info.in) {
+      info.in = newIn;
+      for (int pred : info.predecessors) {
+        if (!queued[pred]) {
+          queued[pred] = true;
+          worklist.push_back(pred);
+        }
+      }
+    }
+  }
+}
+
+const BitVector &Liveness::liveIn(BasicBlock *bb) const {
+  return blocks[blockIndex.at(bb)].in;
+}
+
+const BitVector &Liveness::liveOut(BasicBlock *bb) const {
+  return blocks[blockIndex.at(bb)].out;
+}
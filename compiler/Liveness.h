@@ -0,0 +1,65 @@
+#pragma once
+#include "BitVector.h"
+#include "ir.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Block-level liveness analysis.
+//
+// The use/def sets of every reachable block are computed once, as bit vectors
+// indexed by SymbolId. Live-in/live-out are then solved with a
+// worklist seeded in reverse post-order. Clients needing the live set at each
+// instruction walk the blocks with forEachInstruction.
+class Liveness {
+public:
+  explicit Liveness(CFG *cfg);
+
+  // Calls f(instr, live) for every instruction of the reachable blocks, each
+  // block being walked backwards. live holds the symbols live after instr.
+  // Per-instruction sets are never materialized.
+  template <typename F> void forEachInstruction(F f) const;
+
+  const BitVector &liveIn(BasicBlock *bb) const;
+  const BitVector &liveOut(BasicBlock *bb) const;
+
+  // Reachable blocks, in reverse post-order from the entry block
+  const std::vector<BasicBlock *> &getReversePostOrder() const { return rpo; }
+
+private:
+  struct BlockInfo {
+    BitVector use;
+    BitVector def;
+    BitVector in;
+    BitVector out;
+    std::vector<int> successors;
+    std::vector<int> predecessors;
+  };
+
+  std::vector<BasicBlock *> rpo;
+  std::unordered_map<BasicBlock *, int> blockIndex;
+  std::vector<BlockInfo> blocks;
+
+  size_t symbolCount;
+
+  void computeReversePostOrder(BasicBlock *entry);
+  void computeLocalSets();
+  void solve();
+};
+
+template <typename F> void Liveness::forEachInstruction(F f) const {
+  BitVector live(symbolCount);
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    live = blocks[i].out;
+    auto &instrs = rpo[i]->instrs;
+    for (auto instr = instrs.rbegin(); instr != instrs.rend(); instr++) {
+      f(*instr, live);
+      for (SymbolId symbol : instr->getDeclaredVariable()) {
+        live.reset(symbol);
+      }
+      for (SymbolId symbol : instr->getUsedVariables()) {
+        live.set(symbol);
+      }
+    }
+  }
+}
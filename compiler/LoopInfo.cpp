@@ -0,0 +1,103 @@
+#include "LoopInfo.h"
+
+#include <algorithm>
+
+LoopInfo::LoopInfo(const std::vector<BasicBlock *> &rpo) {
+  std::unordered_map<BasicBlock *, int> index;
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    index[rpo[i]] = i;
+  }
+  std::vector<std::vector<int>> predecessors(rpo.size());
+  std::vector<std::vector<int>> latches(rpo.size());
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    for (BasicBlock *succ : {rpo[i]->exit_true, rpo[i]->exit_false}) {
+      if (succ == nullptr) {
+        continue;
+      }
+      int succIndex = index[succ];
+      predecessors[succIndex].push_back(i);
+      if (succIndex <= i) {
+        latches[succIndex].push_back(i);
+      }
+    }
+  }
+
+  std::vector<int> inLoop(rpo.size(), -1); /**< last header visited */
+  for (int header = 0; header < (int)rpo.size(); header++) {
+    if (latches[header].empty()) {
+      continue;
+    }
+    Loop loop{rpo[header], {rpo[header]}};
+    inLoop[header] = header;
+    std::vector<int> worklist;
+    for (int latch : latches[header]) {
+      if (inLoop[latch] != header) {
+        inLoop[latch] = header;
+        worklist.push_back(latch);
+      }
+    }
+    while (!worklist.empty()) {
+      int block = worklist.back();
+      worklist.pop_back();
+      loop.blocks.push_back(rpo[block]);
+      for (int pred : predecessors[block]) {
+        if (inLoop[pred] != header) {
+          inLoop[pred] = header;
+          worklist.push_back(pred);
+        }
+      }
+    }
+    for (BasicBlock *bb : loop.blocks) {
+      loopDepth[bb]++;
+    }
+    loops.push_back(std::move(loop));
+  }
+}
+
+int LoopInfo::depth(BasicBlock *bb) const {
+  auto it = loopDepth.find(bb);
+  return it != loopDepth.end() ? it->second : 0;
+}
+
+BasicBlock *getPreheader(CFG *cfg, const LoopInfo::Loop &loop) {
+  BasicBlock *header = loop.header;
+  BasicBlock *entry = nullptr;
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    if (bb->exit_true != header && bb->exit_false != header) {
+      continue;
+    }
+    if (std::find(loop.blocks.begin(), loop.blocks.end(), bb) !=
+        loop.blocks.end()) {
+      continue;
+    }
+    if (entry != nullptr || bb->exit_true == bb->exit_false) {
+      return nullptr;
+    }
+    entry = bb;
+  }
+  if (entry == nullptr || entry->exit_false == nullptr) {
+    return entry;
+  }
+
+  // On the true edge, the preheader is emitted right after the entry block
+  // and needs no label
+  bool trueEdge = entry->exit_true == header;
+  BasicBlock *preheader =
+      new BasicBlock(cfg, trueEdge ? "" : cfg->new_BB_name());
+  preheader->exit_true = header;
+  if (trueEdge) {
+    entry->exit_true = preheader;
+  } else {
+    entry->exit_false = preheader;
+  }
+  cfg->getBlocks().push_back(preheader);
+
+  for (IRInstr &instr : header->instrs) {
+    if (instr.getOperation() != IRInstr::phi) {
+      break;
+    }
+    std::replace(instr.phiBlocks.begin(), instr.phiBlocks.end(), entry,
+                 preheader);
+  }
+  return preheader;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "ir.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Natural loops of a function.
+//
+// A back edge is an edge to a block that does not come later in reverse
+// post-order; the CFGs built by the visitor are reducible, so its target
+// (the header) dominates its source. The loop of a header gathers the blocks
+// that reach one of its back edges without going through the header.
+class LoopInfo {
+public:
+  struct Loop {
+    BasicBlock *header;
+    std::vector<BasicBlock *> blocks; /**< header first */
+  };
+
+  // rpo: the reachable blocks in reverse post-order (see Liveness)
+  explicit LoopInfo(const std::vector<BasicBlock *> &rpo);
+
+  // Number of loops containing the block, 0 outside loops
+  int depth(BasicBlock *bb) const;
+
+  // Loops in reverse post-order of their headers, outer loops first
+  const std::vector<Loop> &getLoops() const { return loops; }
+
+private:
+  std::vector<Loop> loops;
+  std::unordered_map<BasicBlock *, int> loopDepth;
+};
+
+// Block running right before the loop: the only block entering the header
+// from outside the loop if it jumps nowhere else, otherwise a block inserted
+// on that edge, which the phis of the header then come from. nullptr if
+// several blocks enter the loop.
+BasicBlock *getPreheader(CFG *cfg, const LoopInfo::Loop &loop);
@@ -0,0 +1,147 @@
+#include "LoopInvariantCodeMotion.h"
+#include "Dominators.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+LoopInvariantCodeMotion::LoopInvariantCodeMotion(CFG *cfg) : cfg(cfg) {}
+
+int LoopInvariantCodeMotion::run() {
+  defBlock.assign(cfg->getSymbolCount(), nullptr);
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    for (const IRInstr &instr : bb->instrs) {
+      for (SymbolId symbol : instr.getDeclaredVariable()) {
+        defBlock[symbol] = bb;
+      }
+    }
+  }
+
+  std::vector<BasicBlock *> headers;
+  {
+    Dominators dominators(cfg);
+    LoopInfo loops(dominators.getReversePostOrder());
+    for (const LoopInfo::Loop &loop : loops.getLoops()) {
+      headers.push_back(loop.header);
+    }
+  }
+  // An inner header comes after the headers of the enclosing loops in
+  // reverse post-order. The loops are found again for each header, since the
+  // preheaders add blocks to the enclosing loops.
+  int hoisted = 0;
+  for (auto header = headers.rbegin(); header != headers.rend(); header++) {
+    Dominators dominators(cfg);
+    LoopInfo loops(dominators.getReversePostOrder());
+    for (const LoopInfo::Loop &loop : loops.getLoops()) {
+      if (loop.header == *header) {
+        hoisted += hoist(loop);
+      }
+    }
+  }
+  return hoisted;
+}
+
+bool LoopInvariantCodeMotion::canHoist(const IRInstr &instr) {
+  switch (instr.getOperation()) {
+  case IRInstr::var_assign:
+  case IRInstr::ldconst:
+  case IRInstr::add:
+  case IRInstr::sub:
+  case IRInstr::mul:
+  case IRInstr::b_and:
+  case IRInstr::b_or:
+  case IRInstr::b_xor:
+  case IRInstr::lt:
+  case IRInstr::leq:
+  case IRInstr::gt:
+  case IRInstr::geq:
+  case IRInstr::eq:
+  case IRInstr::neq:
+  case IRInstr::neg:
+  case IRInstr::not_:
+  case IRInstr::lnot:
+  case IRInstr::inc:
+  case IRInstr::dec:
+  case IRInstr::addr:
+  case IRInstr::lea:
+    return true;
+  default:
+    return false;
+  }
+}
+
+int LoopInvariantCodeMotion::hoist(const LoopInfo::Loop &loop) {
+  std::unordered_set<BasicBlock *> inLoop(loop.blocks.begin(),
+                                          loop.blocks.end());
+  std::unordered_set<SymbolId> invariant;
+  auto isInvariant = [&](SymbolId symbol) {
+    return defBlock[symbol] == nullptr || !inLoop.count(defBlock[symbol]) ||
+           invariant.count(symbol);
+  };
+
+  // Invariant instructions as (block, index), each after the invariant
+  // instructions it uses
+  std::vector<std::pair<BasicBlock *, size_t>> found;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (BasicBlock *bb : loop.blocks) {
+      for (size_t i = 0; i < bb->instrs.size(); i++) {
+        const IRInstr &instr = bb->instrs[i];
+        if (!canHoist(instr)) {
+          continue;
+        }
+        SymbolId dest = instr.getDeclaredVariable()[0];
+        std::vector<SymbolId> used = instr.getUsedVariables();
+        if (!invariant.count(dest) &&
+            std::all_of(used.begin(), used.end(), isInvariant)) {
+          invariant.insert(dest);
+          found.emplace_back(bb, i);
+          changed = true;
+        }
+      }
+    }
+  }
+
+  std::unordered_set<SymbolId> usedByHoisted;
+  for (auto &[bb, i] : found) {
+    if (bb->instrs[i].getOperation() != IRInstr::ldconst) {
+      for (SymbolId symbol : bb->instrs[i].getUsedVariables()) {
+        usedByHoisted.insert(symbol);
+      }
+    }
+  }
+  auto isUnusedConstant = [&](const std::pair<BasicBlock *, size_t> &at) {
+    const IRInstr &instr = at.first->instrs[at.second];
+    return instr.getOperation() == IRInstr::ldconst &&
+           !usedByHoisted.count(instr.getSymbolParam(1));
+  };
+  found.erase(std::remove_if(found.begin(), found.end(), isUnusedConstant),
+              found.end());
+  if (found.empty()) {
+    return 0;
+  }
+  BasicBlock *preheader = getPreheader(cfg, loop);
+  if (preheader == nullptr) {
+    return 0;
+  }
+
+  std::unordered_map<BasicBlock *, std::vector<bool>> moved;
+  for (auto &[bb, i] : found) {
+    std::vector<bool> &blockMoved = moved[bb];
+    blockMoved.resize(bb->instrs.size(), false);
+    blockMoved[i] = true;
+    preheader->instrs.push_back(bb->instrs[i]);
+    defBlock[bb->instrs[i].getDeclaredVariable()[0]] = preheader;
+  }
+  for (auto &[bb, blockMoved] : moved) {
+    size_t kept = 0;
+    for (size_t i = 0; i < bb->instrs.size(); i++) {
+      if (!blockMoved[i]) {
+        bb->instrs[kept++] = bb->instrs[i];
+      }
+    }
+    bb->instrs.erase(bb->instrs.begin() + kept, bb->instrs.end());
+  }
+  return found.size();
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "LoopInfo.h"
+#include "ir.h"
+
+#include <vector>
+
+// Loop-invariant code motion, on the SSA form of the IR.
+//
+// An instruction of a loop is invariant when it has no side effect and its
+// operands are defined outside the loop or by invariant instructions. The
+// invariant instructions move to the preheader of the loop (getPreheader),
+// so they run once before the loop rather than on every iteration.
+// Divisions stay in place, since the loop might not have run them at all.
+// Constants only move along with an instruction using them: loading them
+// again is as cheap as keeping them in a register.
+//
+// The loops are visited innermost first, so an instruction hoisted out of an
+// inner loop can then leave the enclosing ones.
+class LoopInvariantCodeMotion {
+public:
+  explicit LoopInvariantCodeMotion(CFG *cfg);
+
+  // Returns the number of instructions hoisted
+  int run();
+
+private:
+  CFG *cfg;
+  std::vector<BasicBlock *> defBlock; /**< by SymbolId, nullptr if none */
+
+  static bool canHoist(const IRInstr &instr);
+  int hoist(const LoopInfo::Loop &loop);
+};
@@ -0,0 +1,430 @@
+#include "LoopUnrolling.h"
+#include "Dominators.h"
+#include "Options.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <unordered_set>
+
+namespace {
+// Largest number of instructions of the copies replacing a loop
+const int maxUnrolledSize = 96;
+// Largest trip count of a loop fully unrolled
+const int maxFullUnrollTrips = 32;
+
+IRInstr::Operation swapOperands(IRInstr::Operation op) {
+  switch (op) {
+  case IRInstr::lt:
+    return IRInstr::gt;
+  case IRInstr::leq:
+    return IRInstr::geq;
+  case IRInstr::gt:
+    return IRInstr::lt;
+  default:
+    return IRInstr::leq;
+  }
+}
+
+bool compare(IRInstr::Operation op, int64_t a, int64_t b) {
+  switch (op) {
+  case IRInstr::lt:
+    return a < b;
+  case IRInstr::leq:
+    return a <= b;
+  case IRInstr::gt:
+    return a > b;
+  default:
+    return a >= b;
+  }
+}
+} // namespace
+
+LoopUnrolling::LoopUnrolling(CFG *cfg) : cfg(cfg), partial(0) {}
+
+int LoopUnrolling::run() {
+  defCount.assign(cfg->getSymbolCount(), 0);
+  constants.clear();
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    for (const IRInstr &instr : bb->instrs) {
+      for (SymbolId symbol : instr.getDeclaredVariable()) {
+        defCount[symbol]++;
+      }
+      if (instr.getOperation() == IRInstr::ldconst) {
+        const std::string &literal =
+            std::get<std::string>(instr.getParams()[0]);
+        char *end;
+        long long value = std::strtoll(literal.c_str(), &end, 10);
+        if (*end == '\0' && value >= INT_MIN && value <= INT_MAX) {
+          constants[instr.getSymbolParam(1)] = value;
+        }
+      }
+    }
+  }
+  for (auto it = constants.begin(); it != constants.end();) {
+    it = defCount[it->first] == 1 ? std::next(it) : constants.erase(it);
+  }
+
+  // The loops are innermost, hence disjoint: they are all found first
+  std::vector<CountedLoop> candidates;
+  {
+    Dominators dominators(cfg);
+    LoopInfo loops(dominators.getReversePostOrder());
+    for (const LoopInfo::Loop &loop : loops.getLoops()) {
+      CountedLoop counted;
+      if (analyze(loop, loops, counted)) {
+        candidates.push_back(counted);
+      }
+    }
+  }
+
+  int full = 0;
+  partial = 0;
+  for (const CountedLoop &counted : candidates) {
+    int initial;
+    int trips = -1;
+    if (counted.bound == invalidSymbol && findInitialValue(counted, initial)) {
+      trips = tripCount(counted, initial, maxFullUnrollTrips);
+    }
+    if (trips >= 0 && trips * counted.size <= maxUnrolledSize) {
+      unrollFully(counted, trips);
+      full++;
+      continue;
+    }
+    int factor = std::min(Options::getUnrollFactor(),
+                          maxUnrolledSize / std::max(counted.size, 1));
+    if (factor >= 2 && (trips < 0 || trips >= factor) &&
+        unrollPartially(counted, factor)) {
+      partial++;
+    }
+  }
+  return full;
+}
+
+bool LoopUnrolling::analyze(const LoopInfo::Loop &loop, const LoopInfo &loops,
+                            CountedLoop &counted) {
+  BasicBlock *header = loop.header;
+  std::unordered_set<BasicBlock *> inLoop(loop.blocks.begin(),
+                                          loop.blocks.end());
+  if (header->exit_false == nullptr || header->falseCondition != "e" ||
+      !inLoop.count(header->exit_true) || inLoop.count(header->exit_false) ||
+      header->exit_true == header) {
+    return false;
+  }
+  counted.header = header;
+  counted.exit = header->exit_false;
+  counted.body.clear();
+  counted.size = 0;
+
+  // Innermost, leaving only from the header, with a single latch
+  BasicBlock *latch = nullptr;
+  for (BasicBlock *bb : loop.blocks) {
+    if (loops.depth(bb) != loops.depth(header)) {
+      return false;
+    }
+    if (bb == header) {
+      continue;
+    }
+    for (BasicBlock *succ : {bb->exit_true, bb->exit_false}) {
+      if (succ == header) {
+        if (latch != nullptr && latch != bb) {
+          return false;
+        }
+        latch = bb;
+      } else if (succ != nullptr && !inLoop.count(succ)) {
+        return false;
+      }
+    }
+    counted.body.push_back(bb);
+    counted.size += bb->instrs.size();
+  }
+  if (latch == nullptr) {
+    return false;
+  }
+
+  // The header: constants, the comparison, and the branch on its result
+  std::vector<IRInstr> &instrs = header->instrs;
+  if (instrs.size() < 2 || instrs.back().getOperation() != IRInstr::cmpNZ) {
+    return false;
+  }
+  const IRInstr &comparison = instrs[instrs.size() - 2];
+  IRInstr::Operation op = comparison.getOperation();
+  if ((op != IRInstr::lt && op != IRInstr::leq && op != IRInstr::gt &&
+       op != IRInstr::geq) ||
+      comparison.getSymbolParam(2) != instrs.back().getSymbolParam(0)) {
+    return false;
+  }
+  std::unordered_set<SymbolId> headerSymbols;
+  for (size_t i = 0; i < instrs.size(); i++) {
+    if (i + 2 < instrs.size() &&
+        instrs[i].getOperation() != IRInstr::ldconst) {
+      return false;
+    }
+    for (SymbolId symbol : instrs[i].getDeclaredVariable()) {
+      headerSymbols.insert(symbol);
+    }
+  }
+  // They are left behind by a full unrolling
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    if (bb == header) {
+      continue;
+    }
+    for (const IRInstr &instr : bb->instrs) {
+      for (SymbolId symbol : instr.getUsedVariables()) {
+        if (headerSymbols.count(symbol)) {
+          return false;
+        }
+      }
+    }
+  }
+
+  // The variable and the bound, defined by the header when constant
+  std::unordered_map<SymbolId, int> loopDefs;
+  for (BasicBlock *bb : loop.blocks) {
+    for (const IRInstr &instr : bb->instrs) {
+      for (SymbolId symbol : instr.getDeclaredVariable()) {
+        loopDefs[symbol]++;
+      }
+    }
+  }
+  SymbolId left = comparison.getSymbolParam(0);
+  SymbolId right = comparison.getSymbolParam(1);
+  if (headerSymbols.count(left)) {
+    std::swap(left, right);
+    op = swapOperands(op);
+  }
+  counted.variable = left;
+  counted.op = op;
+  counted.bound = invalidSymbol;
+  counted.constantBound = 0;
+  if (headerSymbols.count(left) || left == right ||
+      cfg->getSymbol(left).type != Type::INT || loopDefs[left] != 1) {
+    return false;
+  }
+  if (headerSymbols.count(right)) {
+    auto constant = constants.find(right);
+    if (constant == constants.end()) {
+      return false;
+    }
+    counted.constantBound = constant->second;
+  } else if (loopDefs.count(right)) {
+    return false;
+  } else {
+    counted.bound = right;
+  }
+  return findStep(counted, latch, counted.step);
+}
+
+bool LoopUnrolling::findStep(const CountedLoop &counted, BasicBlock *latch,
+                             int &step) const {
+  SymbolId variable = counted.variable;
+  const std::vector<IRInstr> &instrs = latch->instrs;
+  for (size_t i = 0; i < instrs.size(); i++) {
+    std::vector<SymbolId> defs = instrs[i].getDeclaredVariable();
+    if (defs.empty() || defs[0] != variable) {
+      continue;
+    }
+    IRInstr::Operation op = instrs[i].getOperation();
+    if (op == IRInstr::inc || op == IRInstr::dec) {
+      step = op == IRInstr::inc ? 1 : -1;
+      return true;
+    }
+    if (op != IRInstr::var_assign) {
+      return false;
+    }
+    // i = t, t = i + c, i - c or c + i
+    SymbolId value = instrs[i].getSymbolParam(1);
+    if (defCount[value] != 1) {
+      return false;
+    }
+    for (size_t j = 0; j < i; j++) {
+      const IRInstr &instr = instrs[j];
+      if (instr.getDeclaredVariable() != std::vector<SymbolId>{value}) {
+        continue;
+      }
+      IRInstr::Operation update = instr.getOperation();
+      if (update != IRInstr::add && update != IRInstr::sub) {
+        return false;
+      }
+      SymbolId a = instr.getSymbolParam(0);
+      SymbolId b = instr.getSymbolParam(1);
+      if (update == IRInstr::add && b == variable) {
+        std::swap(a, b);
+      }
+      auto constant = constants.find(b);
+      if (a != variable || constant == constants.end() ||
+          constant->second == 0 ||
+          (update == IRInstr::sub && constant->second == INT_MIN)) {
+        return false;
+      }
+      step = update == IRInstr::add ? constant->second : -constant->second;
+      return true;
+    }
+    return false;
+  }
+  return false;
+}
+
+std::vector<BasicBlock *>
+LoopUnrolling::enteringBlocks(const CountedLoop &counted) const {
+  std::vector<BasicBlock *> entering;
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    if ((bb->exit_true == counted.header ||
+         bb->exit_false == counted.header) &&
+        std::find(counted.body.begin(), counted.body.end(), bb) ==
+            counted.body.end()) {
+      entering.push_back(bb);
+    }
+  }
+  return entering;
+}
+
+bool LoopUnrolling::findInitialValue(const CountedLoop &counted,
+                                     int &initial) const {
+  std::vector<BasicBlock *> entering = enteringBlocks(counted);
+  if (entering.size() != 1) {
+    return false;
+  }
+  // The last assignment of the variable before the loop, from a constant
+  const std::vector<IRInstr> &instrs = entering[0]->instrs;
+  for (auto instr = instrs.rbegin(); instr != instrs.rend(); instr++) {
+    std::vector<SymbolId> defs = instr->getDeclaredVariable();
+    if (defs.empty() || defs[0] != counted.variable) {
+      continue;
+    }
+    if (instr->getOperation() != IRInstr::var_assign) {
+      return false;
+    }
+    auto constant = constants.find(instr->getSymbolParam(1));
+    if (constant == constants.end()) {
+      return false;
+    }
+    initial = constant->second;
+    return true;
+  }
+  return false;
+}
+
+int LoopUnrolling::tripCount(const CountedLoop &counted, int initial,
+                             int limit) const {
+  // The increments wrap around as the addl emitted for them does
+  int32_t value = initial;
+  for (int trips = 0; trips <= limit; trips++) {
+    if (!compare(counted.op, value, counted.constantBound)) {
+      return trips;
+    }
+    value = int32_t(uint32_t(value) + uint32_t(counted.step));
+  }
+  return -1;
+}
+
+BasicBlock *LoopUnrolling::copyBody(const CountedLoop &counted,
+                                    BasicBlock *next) {
+  std::unordered_map<BasicBlock *, BasicBlock *> copies;
+  for (BasicBlock *source : counted.body) {
+    BasicBlock *copy =
+        new BasicBlock(cfg, source->label.empty() ? "" : cfg->new_BB_name());
+    copy->test_var_name = source->test_var_name;
+    copy->falseCondition = source->falseCondition;
+    copies[source] = copy;
+    cfg->getBlocks().push_back(copy);
+  }
+  // The symbols are shared by the copies: SSA construction renames them
+  auto target = [&](BasicBlock *bb) {
+    if (bb == counted.header) {
+      return next;
+    }
+    return bb == nullptr ? nullptr : copies[bb];
+  };
+  for (BasicBlock *source : counted.body) {
+    BasicBlock *copy = copies[source];
+    for (const IRInstr &instr : source->instrs) {
+      copy->instrs.emplace_back(copy, instr.getOperation(), instr.getType(),
+                                instr.getParams());
+    }
+    copy->exit_true = target(source->exit_true);
+    copy->exit_false = target(source->exit_false);
+  }
+  return copies[counted.header->exit_true];
+}
+
+void LoopUnrolling::unrollFully(const CountedLoop &counted, int trips) {
+  BasicBlock *next = counted.exit;
+  for (int i = 0; i < trips; i++) {
+    next = copyBody(counted, next);
+  }
+  for (BasicBlock *bb : enteringBlocks(counted)) {
+    if (bb->exit_true == counted.header) {
+      bb->exit_true = next;
+    }
+    if (bb->exit_false == counted.header) {
+      bb->exit_false = next;
+    }
+  }
+}
+
+bool LoopUnrolling::unrollPartially(const CountedLoop &counted, int factor) {
+  // Going towards the bound, so that the new one is below it
+  bool increasing = counted.op == IRInstr::lt || counted.op == IRInstr::leq;
+  if ((counted.step > 0) != increasing) {
+    return false;
+  }
+  int64_t distance = int64_t(factor - 1) * counted.step;
+  if (distance > INT_MAX / 2 || distance < -(INT_MAX / 2)) {
+    return false;
+  }
+  std::vector<BasicBlock *> entering = enteringBlocks(counted);
+
+  // bound - distance, not overflowing when the bound is a variable: the
+  // original loop runs alone otherwise
+  BasicBlock *guard = nullptr;
+  SymbolId newBound = invalidSymbol;
+  BasicBlock *header = new BasicBlock(cfg, cfg->new_BB_name());
+  if (counted.bound == invalidSymbol) {
+    int64_t value = int64_t(counted.constantBound) - distance;
+    if (value < INT_MIN || value > INT_MAX) {
+      return false;
+    }
+    newBound = header->add_IRInstr(IRInstr::ldconst, Type::INT,
+                                   {std::to_string(value)});
+  } else {
+    guard = new BasicBlock(cfg, cfg->new_BB_name());
+    int64_t limit = increasing ? int64_t(INT_MIN) + distance
+                               : int64_t(INT_MAX) + distance;
+    SymbolId distanceSymbol = guard->add_IRInstr(
+        IRInstr::ldconst, Type::INT, {std::to_string(distance)});
+    newBound = guard->add_IRInstr(IRInstr::sub, Type::INT,
+                                  {counted.bound, distanceSymbol});
+    SymbolId limitSymbol = guard->add_IRInstr(IRInstr::ldconst, Type::INT,
+                                              {std::to_string(limit)});
+    SymbolId inRange = guard->add_IRInstr(
+        increasing ? IRInstr::geq : IRInstr::leq, Type::INT,
+        {counted.bound, limitSymbol});
+    guard->add_IRInstr(IRInstr::cmpNZ, Type::INT, {inRange});
+    guard->exit_true = header;
+    guard->exit_false = counted.header;
+    cfg->getBlocks().push_back(guard);
+  }
+  SymbolId condition = header->add_IRInstr(
+      counted.op, Type::INT, {counted.variable, newBound});
+  header->add_IRInstr(IRInstr::cmpNZ, Type::INT, {condition});
+  cfg->getBlocks().push_back(header);
+
+  BasicBlock *next = header;
+  for (int i = 0; i < factor; i++) {
+    next = copyBody(counted, next);
+  }
+  header->exit_true = next;
+  header->exit_false = counted.header;
+
+  BasicBlock *entry = guard != nullptr ? guard : header;
+  for (BasicBlock *bb : entering) {
+    if (bb->exit_true == counted.header) {
+      bb->exit_true = entry;
+    }
+    if (bb->exit_false == counted.header) {
+      bb->exit_false = entry;
+    }
+  }
+  return true;
+}
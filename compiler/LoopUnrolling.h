@@ -0,0 +1,68 @@
+#pragma once
+#include "LoopInfo.h"
+#include "ir.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Unrolling of the counted loops built by the visitor, before SSA
+// construction.
+//
+// A counted loop is an innermost while loop whose header only tests
+// `i op n`, op being <, <=, > or >=, n a constant or a variable the loop does
+// not assign, and whose induction variable i is only assigned by the block
+// jumping back to the header, which adds a constant step to it (++i,
+// i = i + 2...). The body may branch, but only leaves the loop by returning.
+//
+// When the block entering the loop sets i to a constant and n is constant,
+// the trip count is known: a loop small enough is replaced by that many
+// copies of its body, chained without any test. Otherwise, the loop gets a
+// new header testing whether Options::getUnrollFactor more iterations
+// remain, `i op n - (factor - 1) * step`, which runs that many copies of the
+// body before testing again; the original loop then runs the remaining
+// iterations. For a variable n, a test first checks that the bound of the
+// new header does not overflow, going straight to the original loop if it
+// does.
+class LoopUnrolling {
+public:
+  explicit LoopUnrolling(CFG *cfg);
+
+  // Returns the number of loops fully unrolled
+  int run();
+
+  // Number of loops partially unrolled by the last run
+  int getPartialCount() const { return partial; }
+
+private:
+  struct CountedLoop {
+    BasicBlock *header;
+    BasicBlock *exit;
+    std::vector<BasicBlock *> body; /**< the blocks but the header */
+    int size;                       /**< instructions of the body */
+    SymbolId variable;
+    int step;
+    IRInstr::Operation op; /**< variable op bound */
+    SymbolId bound;        /**< invalidSymbol if constant */
+    int constantBound;
+  };
+
+  CFG *cfg;
+  int partial;
+  std::vector<int> defCount;                   /**< by SymbolId */
+  std::unordered_map<SymbolId, int> constants; /**< symbols set by ldconst */
+
+  bool analyze(const LoopInfo::Loop &loop, const LoopInfo &loops,
+               CountedLoop &counted);
+  bool findStep(const CountedLoop &counted, BasicBlock *latch,
+                int &step) const;
+  bool findInitialValue(const CountedLoop &counted, int &initial) const;
+  // Iterations run from the initial value, -1 if more than limit
+  int tripCount(const CountedLoop &counted, int initial, int limit) const;
+  std::vector<BasicBlock *> enteringBlocks(const CountedLoop &counted) const;
+
+  void unrollFully(const CountedLoop &counted, int trips);
+  bool unrollPartially(const CountedLoop &counted, int factor);
+  // Copies the body, its edges back to the header going to next instead.
+  // Returns the copy of the first block of the body.
+  BasicBlock *copyBody(const CountedLoop &counted, BasicBlock *next);
+};
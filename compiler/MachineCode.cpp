@@ -0,0 +1,53 @@
+#include "MachineCode.h"
+
+void MachineCode::emit(const std::string &opcode,
+                       const std::vector<std::string> &operands) {
+  instrs.push_back({MachineInstr::instruction, opcode, operands});
+}
+
+void MachineCode::label(const std::string &name) {
+  instrs.push_back({MachineInstr::label, name, {}});
+}
+
+void MachineCode::directive(const std::string &text) {
+  instrs.push_back({MachineInstr::directive, text, {}});
+}
+
+void MachineCode::append(const MachineCode &other) {
+  instrs.insert(instrs.end(), other.instrs.begin(), other.instrs.end());
+}
+
+void MachineCode::print(std::ostream &os) const {
+  for (const MachineInstr &instr : instrs) {
+    switch (instr.kind) {
+    case MachineInstr::instruction:
+      os << instr.opcode;
+      for (size_t i = 0; i < instr.operands.size(); i++) {
+        os << (i ? ", " : " ") << instr.operands[i];
+      }
+      os << "\n";
+      break;
+    case MachineInstr::label:
+      os << instr.opcode << ":\n";
+      break;
+    case MachineInstr::directive:
+      os << instr.opcode << "\n";
+      break;
+    }
+  }
+}
+
+std::string invertedCondition(const std::string &condition) {
+  static const std::vector<std::pair<std::string, std::string>> pairs = {
+      {"e", "ne"}, {"l", "ge"}, {"g", "le"}, {"b", "ae"},
+      {"a", "be"}, {"z", "nz"}, {"s", "ns"}};
+  for (const auto &pair : pairs) {
+    if (condition == pair.first) {
+      return pair.second;
+    }
+    if (condition == pair.second) {
+      return pair.first;
+    }
+  }
+  return "";
+}
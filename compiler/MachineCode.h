@@ -0,0 +1,58 @@
+#pragma once
+#include "Registers.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// One line of assembly: an instruction, with its operands in AT&T order
+// (sources first), a label or a directive.
+struct MachineInstr {
+  enum Kind { instruction, label, directive };
+
+  Kind kind;
+  std::string opcode; /**< also the name of a label, the text of a directive */
+  std::vector<std::string> operands;
+};
+
+// The assembly of a function, kept as a list of machine instructions so that
+// it can be rewritten (see Peephole) before being printed.
+class MachineCode {
+public:
+  void emit(const std::string &opcode,
+            const std::vector<std::string> &operands = {});
+  void label(const std::string &name);
+  void directive(const std::string &text);
+  void append(const MachineCode &other);
+
+  inline std::vector<MachineInstr> &getInstrs() { return instrs; }
+
+  void print(std::ostream &os) const;
+
+private:
+  std::vector<MachineInstr> instrs;
+};
+
+// Condition code (e, ne, l...) holding exactly when the given one does not,
+// or "" if unknown
+std::string invertedCondition(const std::string &condition);
+
+// Operands
+inline std::string reg8(int reg) { return "%" + registers8[reg]; }
+inline std::string reg32(int reg) { return "%" + registers32[reg]; }
+inline std::string reg64(int reg) { return "%" + registers64[reg]; }
+inline std::string immediate(long value) { return "$" + std::to_string(value); }
+// Register holding a 64-bit value (a pointer) or a 32-bit one, and the move
+// of such a value
+inline std::string regOfWidth(int reg, bool wide) {
+  return wide ? reg64(reg) : reg32(reg);
+}
+inline std::string moveOfWidth(bool wide) { return wide ? "movq" : "movl"; }
+// Assembly name of a function or a global variable
+inline std::string assemblyName(const std::string &name) {
+#ifdef __APPLE__
+  return "_" + name;
+#else
+  return name;
+#endif
+}
@@ -0,0 +1,51 @@
+#include "Options.h"
+
+#include <cstdlib>
+
+RegisterAllocator Options::mRegisterAllocator =
+    RegisterAllocator::GraphColoring;
+int Options::mInlineLimit = 30;
+bool Options::mOmitFramePointer = false;
+bool Options::mPeephole = true;
+bool Options::mUnrollLoops = true;
+int Options::mUnrollFactor = 4;
+
+static const std::string inlineLimitPrefix = "-finline-limit=";
+static const std::string unrollFactorPrefix = "-funroll-factor=";
+
+bool Options::parse(const std::string &arg) {
+  if (arg == "-fregalloc=graph") {
+    mRegisterAllocator = RegisterAllocator::GraphColoring;
+  } else if (arg == "-fregalloc=linear") {
+    mRegisterAllocator = RegisterAllocator::LinearScan;
+  } else if (arg == "-fomit-frame-pointer") {
+    mOmitFramePointer = true;
+  } else if (arg == "-fno-omit-frame-pointer") {
+    mOmitFramePointer = false;
+  } else if (arg == "-fno-peephole") {
+    mPeephole = false;
+  } else if (arg == "-fno-inline") {
+    mInlineLimit = -1;
+  } else if (arg.rfind(inlineLimitPrefix, 0) == 0) {
+    std::string value = arg.substr(inlineLimitPrefix.size());
+    char *end;
+    long limit = std::strtol(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || limit < 0 || limit > 100000) {
+      return false;
+    }
+    mInlineLimit = limit;
+  } else if (arg == "-fno-unroll-loops") {
+    mUnrollLoops = false;
+  } else if (arg.rfind(unrollFactorPrefix, 0) == 0) {
+    std::string value = arg.substr(unrollFactorPrefix.size());
+    char *end;
+    long factor = std::strtol(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || factor < 1 || factor > 32) {
+      return false;
+    }
+    mUnrollFactor = factor;
+  } else {
+    return false;
+  }
+  return true;
+}
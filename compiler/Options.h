@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+
+enum class RegisterAllocator { GraphColoring, LinearScan };
+
+// Code generation options, set from the command line
+class Options {
+public:
+  static inline RegisterAllocator getRegisterAllocator() {
+    return mRegisterAllocator;
+  }
+
+  // Largest estimated size of a function inlined at a call (see Inliner),
+  // negative when inlining is disabled
+  static inline int getInlineLimit() { return mInlineLimit; }
+
+  // Whether the frames are addressed from rsp, rbp being allocatable
+  static inline bool omitFramePointer() { return mOmitFramePointer; }
+
+  // Whether the emitted assembly goes through the peephole optimizer
+  static inline bool peephole() { return mPeephole; }
+
+  // Whether the counted loops are unrolled (see LoopUnrolling)
+  static inline bool unrollLoops() { return mUnrollLoops; }
+
+  // Copies of the body a partially unrolled loop runs per test, 1 to only
+  // unroll loops fully
+  static inline int getUnrollFactor() { return mUnrollFactor; }
+
+  // Parses a code generation option (-f...). Returns false if the argument
+  // is not one.
+  static bool parse(const std::string &arg);
+
+protected:
+  static RegisterAllocator mRegisterAllocator;
+  static int mInlineLimit;
+  static bool mOmitFramePointer;
+  static bool mPeephole;
+  static bool mUnrollLoops;
+  static int mUnrollFactor;
+};
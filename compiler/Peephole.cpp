@@ -0,0 +1,228 @@
+#include "Peephole.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+bool isMove(const MachineInstr &instr) {
+  return instr.kind == MachineInstr::instruction &&
+         (instr.opcode == "movl" || instr.opcode == "movq");
+}
+
+bool isRegister(const std::string &operand) {
+  return !operand.empty() && operand[0] == '%';
+}
+
+bool isImmediate(const std::string &operand) {
+  return !operand.empty() && operand[0] == '$';
+}
+
+bool isMemory(const std::string &operand) {
+  return operand.find('(') != std::string::npos;
+}
+
+// Index of the register named by "%name" in any width, or -1
+int registerIndex(const std::string &name) {
+  for (int reg = 0; reg < registerCount; reg++) {
+    if (name == reg8(reg) || name == reg32(reg) || name == reg64(reg)) {
+      return reg;
+    }
+  }
+  return -1;
+}
+
+// Whether reading the operand involves the register: the register itself, or
+// one of the registers of a memory address
+bool readsRegister(const std::string &operand, const std::string &reg) {
+  if (isRegister(operand)) {
+    return registerIndex(operand) == registerIndex(reg) || operand == reg;
+  }
+  size_t open = operand.find('(');
+  if (open == std::string::npos) {
+    return false;
+  }
+  size_t start = open + 1;
+  while (start < operand.size()) {
+    size_t end = operand.find_first_of(",)", start);
+    std::string part = operand.substr(start, end - start);
+    if (isRegister(part) && (registerIndex(part) == registerIndex(reg) ||
+                             part == reg)) {
+      return true;
+    }
+    if (end == std::string::npos) {
+      break;
+    }
+    start = end + 1;
+  }
+  return false;
+}
+
+bool isJump(const MachineInstr &instr) {
+  return instr.kind == MachineInstr::instruction && instr.opcode[0] == 'j';
+}
+
+} // namespace
+
+Peephole::Peephole(MachineCode *code) : code(code), changes(0) {}
+
+int Peephole::run() {
+  std::vector<MachineInstr> &instrs = code->getInstrs();
+  changes += threadJumps();
+  out.reserve(instrs.size());
+  for (const MachineInstr &instr : instrs) {
+    referenced.insert(instr.operands.begin(), instr.operands.end());
+  }
+  bool reachable = true;
+  for (const MachineInstr &instr : instrs) {
+    switch (instr.kind) {
+    case MachineInstr::label:
+      if (instr.opcode.rfind(".L", 0) == 0 && !referenced.count(instr.opcode)) {
+        changes++;
+        break;
+      }
+      addLabel(instr);
+      reachable = true;
+      break;
+    case MachineInstr::directive:
+      out.push_back(instr);
+      break;
+    case MachineInstr::instruction:
+      if (!reachable) {
+        changes++;
+        break;
+      }
+      out.push_back(instr);
+      while (simplifyLast()) {
+        changes++;
+      }
+      reachable = !(instr.opcode == "jmp" || instr.opcode == "ret");
+      break;
+    }
+  }
+  instrs.swap(out);
+  return changes;
+}
+
+int Peephole::threadJumps() {
+  std::vector<MachineInstr> &instrs = code->getInstrs();
+  // Label -> target of the jmp right after it
+  std::unordered_map<std::string, std::string> forward;
+  for (size_t i = 0; i < instrs.size(); i++) {
+    if (instrs[i].kind != MachineInstr::label) {
+      continue;
+    }
+    size_t next = i + 1;
+    while (next < instrs.size() && instrs[next].kind == MachineInstr::label) {
+      next++;
+    }
+    if (next < instrs.size() && instrs[next].opcode == "jmp" &&
+        instrs[next].kind == MachineInstr::instruction) {
+      forward[instrs[i].opcode] = instrs[next].operands[0];
+    }
+  }
+
+  int threaded = 0;
+  for (MachineInstr &instr : instrs) {
+    if (!isJump(instr) || instr.operands.size() != 1) {
+      continue;
+    }
+    // Follows the chain, a cycle of jmp keeping its first label
+    std::string target = instr.operands[0];
+    std::unordered_set<std::string> seen = {target};
+    auto it = forward.find(target);
+    while (it != forward.end() && seen.insert(it->second).second) {
+      target = it->second;
+      it = forward.find(target);
+    }
+    if (it != forward.end()) {
+      continue;
+    }
+    if (target != instr.operands[0]) {
+      instr.operands[0] = target;
+      threaded++;
+    }
+  }
+  return threaded;
+}
+
+bool Peephole::simplifyLast() {
+  if (out.empty()) {
+    return false;
+  }
+  MachineInstr &last = out.back();
+  if (last.kind != MachineInstr::instruction) {
+    return false;
+  }
+  if (isMove(last) && isRegister(last.operands[0]) &&
+      last.operands[0] == last.operands[1]) {
+    out.pop_back();
+    return true;
+  }
+  if ((last.opcode == "cmpl" || last.opcode == "cmpq") &&
+      last.operands[0] == "$0" && isRegister(last.operands[1])) {
+    std::string test = last.opcode == "cmpl" ? "testl" : "testq";
+    last = {MachineInstr::instruction, test,
+            {last.operands[1], last.operands[1]}};
+    return true;
+  }
+
+  if (out.size() < 2) {
+    return false;
+  }
+  const MachineInstr &previous = out[out.size() - 2];
+  if (!isMove(previous) || !isMove(last) || previous.opcode != last.opcode) {
+    return false;
+  }
+  const std::string &source = previous.operands[0];
+  const std::string &dest = previous.operands[1];
+  // mov a, b; mov b, a: the second one changes nothing. The same goes for
+  // mov a, b; mov a, b, unless b is part of the address of a.
+  if (!readsRegister(source, dest) &&
+      ((last.operands[0] == dest && last.operands[1] == source) ||
+       last.operands == previous.operands)) {
+    out.pop_back();
+    return true;
+  }
+  // mov a, m; mov m, %r: the value is still in a
+  if (isMemory(dest) && last.operands[0] == dest &&
+      isRegister(last.operands[1]) &&
+      (isRegister(source) || isImmediate(source))) {
+    last.operands[0] = source;
+    return true;
+  }
+  return false;
+}
+
+void Peephole::addLabel(const MachineInstr &label) {
+  // The labels at the end of out are at the same address as this one
+  std::vector<std::string> here = {label.opcode};
+  size_t end = out.size();
+  while (end > 0 && out[end - 1].kind == MachineInstr::label) {
+    here.push_back(out[end - 1].opcode);
+    end--;
+  }
+  auto jumpsHere = [&](const MachineInstr &instr) {
+    return isJump(instr) && instr.operands.size() == 1 &&
+           std::find(here.begin(), here.end(), instr.operands[0]) != here.end();
+  };
+
+  // jcc L; jmp M; L: becomes jncc M; L:
+  if (end >= 2 && end == out.size() && isJump(out[end - 2]) &&
+      out[end - 2].opcode != "jmp" && jumpsHere(out[end - 2]) &&
+      out[end - 1].opcode == "jmp") {
+    std::string inverted = invertedCondition(out[end - 2].opcode.substr(1));
+    if (!inverted.empty()) {
+      out[end - 2].opcode = "j" + inverted;
+      out[end - 2].operands = out[end - 1].operands;
+      out.pop_back();
+      end--;
+      changes++;
+    }
+  }
+  while (end > 0 && jumpsHere(out[end - 1])) {
+    out.erase(out.begin() + end - 1);
+    end--;
+    changes++;
+  }
+  out.push_back(label);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "MachineCode.h"
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Peephole optimizer over the machine instructions of a function.
+//
+// The instructions are copied one at a time, and each rule looks at the end
+// of the copy: when one applies, the rules are tried again, so that a rewrite
+// exposing another one is caught within the same pass. The rules:
+// - a move of a register to itself is removed;
+// - a move undoing the previous one (mov a, b; mov b, a), or repeating it, is
+//   removed: this catches a store followed by a reload of the same slot;
+// - a load of what the previous instruction stored takes it from the stored
+//   register or immediate instead;
+// - cmpl $0, %r becomes testl %r, %r;
+// - a jump to a label followed by a jmp goes to the target of the jmp;
+// - a jump to the next instruction is removed, and a conditional jump over an
+//   unconditional one is inverted to take its target;
+// - the instructions between an unconditional jump or a ret and the next
+//   label are removed, since nothing reaches them;
+// - the local labels (.L...) that no instruction refers to are removed.
+// Moves and compares are only paired within a run of instructions: a label
+// may be reached from elsewhere, with other values in the registers.
+class Peephole {
+public:
+  explicit Peephole(MachineCode *code);
+
+  // Returns the number of instructions removed or rewritten
+  int run();
+
+private:
+  MachineCode *code;
+  std::vector<MachineInstr> out;
+  std::unordered_set<std::string> referenced; /**< operands of instructions */
+  int changes;
+
+  // Makes the jumps to a jmp go to its target, returns how many changed
+  int threadJumps();
+  // Applies one rule to the last instructions of out, returns whether one did
+  bool simplifyLast();
+  void addLabel(const MachineInstr &label);
+};
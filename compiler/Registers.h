@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// The general-purpose registers given to the register allocators (rsp holds
+// the stack). The allocatable registers come first, caller-saved then
+// callee-saved, rbp last since it is only allocatable when the frame pointer
+// is omitted (see CFG::allocatableRegisterCount); the last one, r11, is the
+// scratch register, used by the instructions whose operands live in memory.
+enum Register {
+  RAX,
+  RCX,
+  RDX,
+  RSI,
+  RDI,
+  R8,
+  R9,
+  R10,
+  RBX,
+  R12,
+  R13,
+  R14,
+  R15,
+  RBP,
+  R11,
+  registerCount
+};
+
+const std::string registers8[] = {"al",   "cl",   "dl",   "sil",  "dil",
+                                  "r8b",  "r9b",  "r10b", "bl",   "r12b",
+                                  "r13b", "r14b", "r15b", "bpl",  "r11b"};
+const std::string registers32[] = {"eax",  "ecx",  "edx",  "esi",  "edi",
+                                   "r8d",  "r9d",  "r10d", "ebx",  "r12d",
+                                   "r13d", "r14d", "r15d", "ebp",  "r11d"};
+const std::string registers64[] = {"rax", "rcx", "rdx", "rsi", "rdi",
+                                   "r8",  "r9",  "r10", "rbx", "r12",
+                                   "r13", "r14", "r15", "rbp", "r11"};
+
+// Registers passing the first six arguments of a call
+const Register argumentRegisters[] = {RDI, RSI, RDX, RCX, R8, R9};
+
+// Register classes, as bit sets indexed by Register
+typedef uint32_t RegisterSet;
+
+inline RegisterSet registerBit(int reg) { return RegisterSet(1) << reg; }
+
+const RegisterSet calleeSavedRegisters =
+    registerBit(RBX) | registerBit(R12) | registerBit(R13) | registerBit(R14) |
+    registerBit(R15) | registerBit(RBP);
+// Everything a call may overwrite
+const RegisterSet callerSavedRegisters =
+    (registerBit(registerCount) - 1) & ~calleeSavedRegisters;
+// idivl divides edx:eax, and leaves its results there
+const RegisterSet divisionRegisters = registerBit(RAX) | registerBit(RDX);
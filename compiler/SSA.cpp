@@ -0,0 +1,244 @@
+#include "SSA.h"
+#include "Liveness.h"
+
+#include <algorithm>
+
+SSAConstruction::SSAConstruction(CFG *cfg) : cfg(cfg) {}
+
+void SSAConstruction::run() {
+  normalizeBranches();
+  Dominators dominators(cfg);
+  insertPhis(dominators);
+  rename(dominators);
+}
+
+void SSAConstruction::normalizeBranches() {
+  // A branch whose two edges reach the same block would need two sets of
+  // phi sources for a single predecessor
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    if (bb->exit_false != nullptr && bb->exit_false == bb->exit_true) {
+      if (!bb->instrs.empty() &&
+          bb->instrs.back().getOperation() == IRInstr::cmpNZ) {
+        bb->instrs.pop_back();
+      }
+      bb->exit_false = nullptr;
+    }
+  }
+}
+
+void SSAConstruction::insertPhis(const Dominators &dominators) {
+  const std::vector<BasicBlock *> &rpo = dominators.getReversePostOrder();
+  std::unordered_map<BasicBlock *, int> blockIndex;
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    blockIndex[rpo[i]] = i;
+  }
+
+  size_t symbolCount = cfg->getSymbolCount();
+  std::vector<std::vector<int>> defBlocks(symbolCount);
+  std::vector<int> defCount(symbolCount, 0);
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    for (const IRInstr &instr : rpo[i]->instrs) {
+      for (SymbolId symbol : instr.getDeclaredVariable()) {
+        defCount[symbol]++;
+        if (defBlocks[symbol].empty() || defBlocks[symbol].back() != i) {
+          defBlocks[symbol].push_back(i);
+        }
+      }
+    }
+  }
+
+  Liveness liveness(cfg);
+  std::vector<std::vector<IRInstr>> newPhis(rpo.size());
+  std::vector<SymbolId> visited(rpo.size(), invalidSymbol);
+  needsVersions.assign(symbolCount, false);
+  for (SymbolId symbol = 0; symbol < symbolCount; symbol++) {
+    needsVersions[symbol] = defCount[symbol] > 1;
+    // Iterated dominance frontier of the definitions
+    std::vector<int> worklist = defBlocks[symbol];
+    while (!worklist.empty()) {
+      int block = worklist.back();
+      worklist.pop_back();
+      for (BasicBlock *join : dominators.frontier(rpo[block])) {
+        int j = blockIndex[join];
+        if (visited[j] == symbol) {
+          continue;
+        }
+        visited[j] = symbol;
+        worklist.push_back(j);
+        if (!liveness.liveIn(join).test(symbol)) {
+          continue;
+        }
+        const std::vector<BasicBlock *> &preds = dominators.predecessors(join);
+        std::vector<Parameter> params(preds.size() + 1, symbol);
+        newPhis[j].emplace_back(join, IRInstr::phi,
+                                cfg->getSymbol(symbol).type, params);
+        newPhis[j].back().phiBlocks = preds;
+        phiSymbols[join].push_back(symbol);
+        needsVersions[symbol] = true;
+      }
+    }
+  }
+
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    rpo[i]->instrs.insert(rpo[i]->instrs.begin(), newPhis[i].begin(),
+                          newPhis[i].end());
+  }
+}
+
+void SSAConstruction::rename(const Dominators &dominators) {
+  // Current version of each original symbol, on top of its stack
+  std::vector<std::vector<SymbolId>> versions(cfg->getSymbolCount());
+
+  // Iterative preorder walk of the dominator tree: a block's versions are
+  // popped once all the blocks it dominates are renamed
+  struct Frame {
+    BasicBlock *bb;
+    bool renamed;
+    std::vector<SymbolId> defined;
+  };
+  std::vector<Frame> stack = {{cfg->getBlocks()[0], false, {}}};
+  while (!stack.empty()) {
+    if (stack.back().renamed) {
+      for (SymbolId symbol : stack.back().defined) {
+        versions[symbol].pop_back();
+      }
+      stack.pop_back();
+      continue;
+    }
+    stack.back().renamed = true;
+    BasicBlock *bb = stack.back().bb;
+    renameBlock(bb, versions, stack.back().defined);
+    for (BasicBlock *child : dominators.children(bb)) {
+      stack.push_back({child, false, {}});
+    }
+  }
+}
+
+void SSAConstruction::renameBlock(BasicBlock *bb,
+                                  std::vector<std::vector<SymbolId>> &versions,
+                                  std::vector<SymbolId> &defined) {
+  auto current = [&versions](SymbolId symbol) {
+    return versions[symbol].empty() ? symbol : versions[symbol].back();
+  };
+
+  auto phis = phiSymbols.find(bb);
+  size_t phiCount = phis == phiSymbols.end() ? 0 : phis->second.size();
+  for (size_t i = 0; i < bb->instrs.size(); i++) {
+    IRInstr &instr = bb->instrs[i];
+    SymbolId original;
+    if (i < phiCount) {
+      original = phis->second[i];
+    } else {
+      for (int use : instr.getUseIndices()) {
+        instr.setSymbolParam(use, current(instr.getSymbolParam(use)));
+      }
+      int def = instr.getDefIndex();
+      if (def < 0 || instr.getOperation() == IRInstr::param_decl) {
+        continue;
+      }
+      original = instr.getSymbolParam(def);
+    }
+    if (!needsVersions[original]) {
+      continue;
+    }
+    SymbolId version = cfg->new_version(original);
+    instr.setSymbolParam(instr.getDefIndex(), version);
+    versions[original].push_back(version);
+    defined.push_back(original);
+  }
+
+  for (BasicBlock *succ : {bb->exit_true, bb->exit_false}) {
+    auto succPhis = succ == nullptr ? phiSymbols.end() : phiSymbols.find(succ);
+    if (succPhis == phiSymbols.end()) {
+      continue;
+    }
+    for (size_t i = 0; i < succPhis->second.size(); i++) {
+      IRInstr &phi = succ->instrs[i];
+      for (size_t k = 0; k < phi.phiBlocks.size(); k++) {
+        if (phi.phiBlocks[k] == bb) {
+          phi.setSymbolParam(k + 1, current(succPhis->second[i]));
+        }
+      }
+    }
+  }
+}
+
+SSADestruction::SSADestruction(CFG *cfg) : cfg(cfg) {}
+
+void SSADestruction::run() {
+  std::vector<BasicBlock *> blocks = cfg->getBlocks();
+  for (BasicBlock *bb : blocks) {
+    size_t phiCount = 0;
+    while (phiCount < bb->instrs.size() &&
+           bb->instrs[phiCount].getOperation() == IRInstr::phi) {
+      phiCount++;
+    }
+    if (phiCount == 0) {
+      continue;
+    }
+
+    std::vector<BasicBlock *> preds = bb->instrs[0].phiBlocks;
+    for (size_t k = 0; k < preds.size(); k++) {
+      std::vector<std::pair<SymbolId, SymbolId>> copies;
+      for (size_t i = 0; i < phiCount; i++) {
+        copies.emplace_back(bb->instrs[i].getSymbolParam(0),
+                            bb->instrs[i].getSymbolParam(k + 1));
+      }
+      BasicBlock *pred = preds[k];
+      if (pred->exit_false != nullptr) {
+        pred = splitEdge(pred, bb);
+      }
+      emitParallelCopy(pred, copies);
+    }
+    bb->instrs.erase(bb->instrs.begin(), bb->instrs.begin() + phiCount);
+  }
+}
+
+BasicBlock *SSADestruction::splitEdge(BasicBlock *from, BasicBlock *to) {
+  // On the true edge, the new block is emitted right after its predecessor
+  // and needs no label
+  bool trueEdge = from->exit_true == to;
+  BasicBlock *bb = new BasicBlock(cfg, trueEdge ? "" : cfg->new_BB_name());
+  bb->exit_true = to;
+  if (trueEdge) {
+    from->exit_true = bb;
+  } else {
+    from->exit_false = bb;
+  }
+  cfg->getBlocks().push_back(bb);
+  return bb;
+}
+
+void SSADestruction::emitParallelCopy(
+    BasicBlock *bb, std::vector<std::pair<SymbolId, SymbolId>> copies) {
+  copies.erase(std::remove_if(copies.begin(), copies.end(),
+                              [](const std::pair<SymbolId, SymbolId> &copy) {
+                                return copy.first == copy.second;
+                              }),
+               copies.end());
+
+  auto emit = [this, bb](SymbolId dest, SymbolId source) {
+    bb->instrs.emplace_back(bb, IRInstr::var_assign,
+                            cfg->getSymbol(dest).type,
+                            std::vector<Parameter>{dest, source});
+  };
+  while (!copies.empty()) {
+    // A copy can go once no other copy reads its destination
+    auto ready = std::find_if(copies.begin(), copies.end(), [&](auto &copy) {
+      return std::none_of(copies.begin(), copies.end(), [&](auto &other) {
+        return other.second == copy.first;
+      });
+    });
+    if (ready != copies.end()) {
+      emit(ready->first, ready->second);
+      copies.erase(ready);
+      continue;
+    }
+    // Only cycles are left: the first copy reads its source from a
+    // temporary, which frees the source
+    SymbolId temp =
+        cfg->create_new_tempvar(cfg->getSymbol(copies[0].first).type);
+    emit(temp, copies[0].second);
+    copies[0].second = temp;
+  }
+}
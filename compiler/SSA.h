@@ -0,0 +1,61 @@
+#pragma once
+#include "Dominators.h"
+#include "ir.h"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Conversion of the IR to SSA form.
+//
+// phi instructions are placed on the iterated dominance frontiers of the
+// definitions of each symbol, only where the symbol is live (pruned SSA).
+// Then the blocks are renamed in dominator tree order: every definition of a
+// symbol defined more than once, or merged by a phi, gets a new version
+// (CFG::new_version). The symbols defined once keep their id, and so do the
+// parameters, which the prologue writes. A use reached by no definition
+// reads the original symbol.
+//
+// The phis of a block come first in it, and expect the unreachable blocks to
+// be removed (see DeadCodeElimination).
+class SSAConstruction {
+public:
+  explicit SSAConstruction(CFG *cfg);
+
+  void run();
+
+private:
+  CFG *cfg;
+  // Original symbol of each phi, in the order of the phis of the block
+  std::unordered_map<BasicBlock *, std::vector<SymbolId>> phiSymbols;
+  std::vector<bool> needsVersions; /**< by SymbolId */
+
+  void normalizeBranches();
+  void insertPhis(const Dominators &dominators);
+  void rename(const Dominators &dominators);
+  // Renames the block, pushing the new version of each symbol it defines
+  void renameBlock(BasicBlock *bb,
+                   std::vector<std::vector<SymbolId>> &versions,
+                   std::vector<SymbolId> &defined);
+};
+
+// Conversion out of SSA form.
+//
+// The phis of a block become copies at the end of its predecessors, after
+// splitting the critical edges so that the copies run on that edge only. The
+// copies of an edge happen simultaneously: they are sequentialized as
+// var_assigns, a temporary breaking each cycle.
+class SSADestruction {
+public:
+  explicit SSADestruction(CFG *cfg);
+
+  void run();
+
+private:
+  CFG *cfg;
+
+  BasicBlock *splitEdge(BasicBlock *from, BasicBlock *to);
+  // copies: (destination, source) pairs
+  void emitParallelCopy(BasicBlock *bb,
+                        std::vector<std::pair<SymbolId, SymbolId>> copies);
+};
@@ -0,0 +1,98 @@
+#include "StackSlotColoring.h"
+#include "InterferenceGraph.h"
+#include "Liveness.h"
+
+#include <algorithm>
+#include <climits>
+
+StackSlotColoring::StackSlotColoring(CFG *cfg,
+                                     const std::vector<bool> &inMemory)
+    : cfg(cfg), inMemory(inMemory), areaSize(0) {}
+
+int StackSlotColoring::run() {
+  size_t symbolCount = cfg->getSymbolCount();
+  std::vector<SymbolId> candidates;
+  std::vector<bool> shareable(symbolCount, false);
+  for (SymbolId symbol = 0; symbol < symbolCount; symbol++) {
+    if (!inMemory[symbol] || getSlotSize(cfg->getSymbol(symbol).type) == 0) {
+      continue;
+    }
+    candidates.push_back(symbol);
+    shareable[symbol] = !cfg->getSymbol(symbol).type.isArray() &&
+                        (cfg->splitInfo.splitSlot.empty() ||
+                         cfg->splitInfo.splitSlot[symbol] == INT_MAX);
+  }
+
+  // A definition writes the slot even when its value is dead
+  InterferenceGraph interference(symbolCount);
+  std::vector<int> accesses(symbolCount, 0);
+  Liveness liveness(cfg);
+  liveness.forEachInstruction([&](IRInstr &instr, const BitVector &live) {
+    for (SymbolId symbol : instr.getUsedVariables()) {
+      accesses[symbol]++;
+    }
+    for (SymbolId defined : instr.getDeclaredVariable()) {
+      accesses[defined]++;
+      if (!inMemory[defined]) {
+        continue;
+      }
+      live.forEach([&](size_t other) {
+        if (other != defined && inMemory[other]) {
+          interference.addEdge(defined, other);
+        }
+      });
+    }
+  });
+
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [&](SymbolId a, SymbolId b) {
+                     return accesses[a] > accesses[b];
+                   });
+  struct Slot {
+    unsigned int size;
+    unsigned int alignment;
+    std::vector<SymbolId> members;
+  };
+  std::vector<Slot> slots;
+  std::vector<int> slotOf(symbolCount, -1);
+  for (SymbolId symbol : candidates) {
+    const Type &type = cfg->getSymbol(symbol).type;
+    unsigned int size = getSlotSize(type);
+    for (size_t i = 0; shareable[symbol] && i < slots.size(); i++) {
+      const Slot &slot = slots[i];
+      if (slot.size == size &&
+          std::none_of(slot.members.begin(), slot.members.end(),
+                       [&](SymbolId member) {
+                         return !shareable[member] ||
+                                interference.interferes(symbol, member);
+                       })) {
+        slotOf[symbol] = i;
+        break;
+      }
+    }
+    if (slotOf[symbol] < 0) {
+      slotOf[symbol] = slots.size();
+      slots.push_back({size, getSlotAlignment(type), {}});
+    }
+    slots[slotOf[symbol]].members.push_back(symbol);
+  }
+
+  // The most aligned slots first, so that aligning them wastes little
+  std::vector<size_t> order(slots.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return slots[a].alignment > slots[b].alignment;
+  });
+  int offset = 0;
+  for (size_t i : order) {
+    int alignment = slots[i].alignment;
+    offset = (offset + slots[i].size + alignment - 1) / alignment * alignment;
+    for (SymbolId member : slots[i].members) {
+      cfg->getSymbol(member).offset = offset;
+    }
+  }
+  areaSize = offset;
+  return candidates.size() - slots.size();
+}
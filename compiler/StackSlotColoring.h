@@ -0,0 +1,33 @@
+#pragma once
+#include "ir.h"
+
+#include <vector>
+
+// Stack slot sharing, once the registers are allocated.
+//
+// Two symbols living in memory may share a stack slot when their values are
+// never needed at the same time: the interference graph of these symbols is
+// built from liveness, as for the registers, and colored greedily, the most
+// used symbols first. Only symbols whose slots have the same size (getSlotSize)
+// share one, and never arrays, whose address may be kept anywhere. The slots
+// are then laid out by decreasing alignment (getSlotAlignment), and their
+// offsets set in the symbols (Symbol::offset).
+//
+// A symbol split by the linear scan is stored at its split slot, where it may
+// not be live: it keeps a slot of its own.
+class StackSlotColoring {
+public:
+  // inMemory tells, by SymbolId, the symbols needing a stack slot
+  StackSlotColoring(CFG *cfg, const std::vector<bool> &inMemory);
+
+  // Returns the number of slots saved by sharing
+  int run();
+
+  // Bytes taken by the slots, set by run()
+  int getAreaSize() const { return areaSize; }
+
+private:
+  CFG *cfg;
+  const std::vector<bool> &inMemory;
+  int areaSize;
+};
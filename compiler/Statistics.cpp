@@ -0,0 +1,23 @@
+#include "Statistics.h"
+
+#include <iomanip>
+
+bool Statistics::mEnabled = false;
+std::vector<std::pair<std::string, long>> Statistics::mCounters;
+
+void Statistics::add(const std::string &counter, long count) {
+  for (auto &entry : mCounters) {
+    if (entry.first == counter) {
+      entry.second += count;
+      return;
+    }
+  }
+  mCounters.emplace_back(counter, count);
+}
+
+void Statistics::print(std::ostream &os) {
+  for (auto &entry : mCounters) {
+    os << "stats: " << std::left << std::setw(47) << entry.first << " "
+       << entry.second << std::endl;
+  }
+}
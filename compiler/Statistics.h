@@ -0,0 +1,21 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Counts what the optimizations do (e.g. the instructions they remove),
+// across all functions. Enabled with -fstats; the totals are printed on
+// stderr at exit.
+class Statistics {
+public:
+  static inline void enable() { mEnabled = true; }
+  static inline bool isEnabled() { return mEnabled; }
+
+  static void add(const std::string &counter, long count);
+  static void print(std::ostream &os);
+
+protected:
+  static bool mEnabled;
+  static std::vector<std::pair<std::string, long>> mCounters;
+};
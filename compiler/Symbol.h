@@ -1,6 +1,12 @@
 #pragma once
 #include "Type.h"
+#include <cstdint>
 #include <string>
+
+// Index of a symbol in the arena of the CFG that owns it
+typedef uint32_t SymbolId;
+const SymbolId invalidSymbol = UINT32_MAX;
+
 struct Symbol {
   // Memory offset (in bytes)
   int offset;
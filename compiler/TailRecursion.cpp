@@ -0,0 +1,173 @@
+#include "TailRecursion.h"
+
+TailRecursion::TailRecursion(CFG *cfg) : cfg(cfg) {}
+
+int TailRecursion::run() {
+  if (cfg->addressesFrame()) {
+    return 0;
+  }
+  std::vector<Site> sites;
+  IRInstr::Operation accumulation = IRInstr::nothing;
+  for (BasicBlock *bb : cfg->getBlocks()) {
+    Site site;
+    if (!findSite(bb, site)) {
+      continue;
+    }
+    // A single accumulator, for one operation
+    if (site.op != IRInstr::nothing) {
+      if (accumulation == IRInstr::nothing) {
+        accumulation = site.op;
+      } else if (site.op != accumulation) {
+        continue;
+      }
+    }
+    sites.push_back(site);
+  }
+  if (sites.empty()) {
+    return 0;
+  }
+
+  BasicBlock *entry = cfg->getBlocks()[0];
+  size_t declarations = 0;
+  while (declarations < entry->instrs.size() &&
+         entry->instrs[declarations].getOperation() == IRInstr::param_decl) {
+    declarations++;
+  }
+  BasicBlock *body = splitEntry();
+  SymbolId accumulator = invalidSymbol;
+  if (accumulation != IRInstr::nothing) {
+    accumulator = cfg->create_new_tempvar(Type::INT);
+    std::string identity = accumulation == IRInstr::add ? "0" : "1";
+    SymbolId initial =
+        entry->add_IRInstr(IRInstr::ldconst, Type::INT, {identity});
+    entry->add_IRInstr(IRInstr::var_assign, Type::INT, {accumulator, initial});
+  }
+
+  const std::vector<FunctionParameter> &parameters =
+      cfg->get_parameters_type();
+  for (Site &site : sites) {
+    BasicBlock *bb = site.bb;
+    if (bb == entry) {
+      bb = body;
+      site.call -= declarations;
+    }
+    std::vector<SymbolId> arguments = bb->instrs[site.call].getUsedVariables();
+    // The constants loaded between the call and the operation may be its
+    // operand
+    std::vector<IRInstr> kept;
+    for (size_t i = site.call + 1; i < bb->instrs.size(); i++) {
+      if (bb->instrs[i].getOperation() == IRInstr::ldconst) {
+        kept.push_back(bb->instrs[i]);
+      }
+    }
+    bb->instrs.erase(bb->instrs.begin() + site.call, bb->instrs.end());
+    bb->eraseParams(arguments, bb->instrs.size());
+    bb->instrs.insert(bb->instrs.end(), kept.begin(), kept.end());
+
+    if (site.op != IRInstr::nothing) {
+      SymbolId folded = bb->add_IRInstr(site.op, Type::INT,
+                                        {accumulator, site.operand});
+      bb->add_IRInstr(IRInstr::var_assign, Type::INT, {accumulator, folded});
+    }
+    std::vector<SymbolId> values;
+    for (size_t i = 0; i < parameters.size(); i++) {
+      SymbolId value = cfg->create_new_tempvar(parameters[i].type);
+      bb->add_IRInstr(IRInstr::var_assign, parameters[i].type,
+                      {value, arguments[i]});
+      values.push_back(value);
+    }
+    for (size_t i = 0; i < parameters.size(); i++) {
+      bb->add_IRInstr(IRInstr::var_assign, parameters[i].type,
+                      {parameters[i].symbol, values[i]});
+    }
+    bb->exit_true = body;
+    bb->exit_false = nullptr;
+  }
+
+  // The other returns apply the accumulator
+  if (accumulation != IRInstr::nothing) {
+    for (BasicBlock *bb : cfg->getBlocks()) {
+      if (bb->instrs.empty() ||
+          bb->instrs.back().getOperation() != IRInstr::ret) {
+        continue;
+      }
+      SymbolId value = bb->instrs.back().getSymbolParam(0);
+      bb->instrs.pop_back();
+      SymbolId result =
+          bb->add_IRInstr(accumulation, Type::INT, {accumulator, value});
+      bb->add_IRInstr(IRInstr::ret, Type::INT, {result});
+    }
+  }
+  return sites.size();
+}
+
+bool TailRecursion::findSite(BasicBlock *bb, Site &site) const {
+  const std::vector<IRInstr> &instrs = bb->instrs;
+  for (size_t i = 0; i < instrs.size(); i++) {
+    const IRInstr &call = instrs[i];
+    if (call.getOperation() != IRInstr::call ||
+        std::get<std::string>(call.getParams()[0]) != cfg->get_name()) {
+      continue;
+    }
+    std::vector<SymbolId> result = call.getDeclaredVariable();
+    site = {bb, i, IRInstr::nothing, invalidSymbol};
+    size_t next = i + 1;
+    while (next < instrs.size() &&
+           instrs[next].getOperation() == IRInstr::ldconst) {
+      next++;
+    }
+    if (next < instrs.size() && instrs[next].getOperation() == IRInstr::ret &&
+        next == i + 1) {
+      if (result == instrs[next].getUsedVariables()) {
+        return true;
+      }
+      continue;
+    }
+
+    // ret (x op f(...)), x not being the result itself
+    IRInstr::Operation op = next < instrs.size()
+                                ? instrs[next].getOperation()
+                                : IRInstr::nothing;
+    if ((op != IRInstr::add && op != IRInstr::mul) || result.empty() ||
+        cfg->get_return_type() != Type::INT || next + 1 >= instrs.size() ||
+        instrs[next + 1].getOperation() != IRInstr::ret ||
+        instrs[next + 1].getUsedVariables() !=
+            instrs[next].getDeclaredVariable()) {
+      continue;
+    }
+    std::vector<SymbolId> operands = instrs[next].getUsedVariables();
+    if (operands[0] == result[0] && operands[1] != result[0]) {
+      site.operand = operands[1];
+    } else if (operands[1] == result[0] && operands[0] != result[0]) {
+      site.operand = operands[0];
+    } else {
+      continue;
+    }
+    site.op = op;
+    return true;
+  }
+  return false;
+}
+
+BasicBlock *TailRecursion::splitEntry() {
+  BasicBlock *entry = cfg->getBlocks()[0];
+  BasicBlock *body = new BasicBlock(cfg, cfg->new_BB_name());
+  auto firstInstr = entry->instrs.begin();
+  while (firstInstr != entry->instrs.end() &&
+         firstInstr->getOperation() == IRInstr::param_decl) {
+    firstInstr++;
+  }
+  for (auto instr = firstInstr; instr != entry->instrs.end(); instr++) {
+    body->instrs.emplace_back(body, instr->getOperation(), instr->getType(),
+                              instr->getParams());
+  }
+  entry->instrs.erase(firstInstr, entry->instrs.end());
+  body->exit_true = entry->exit_true;
+  body->exit_false = entry->exit_false;
+  body->test_var_name = entry->test_var_name;
+  body->falseCondition = entry->falseCondition;
+  entry->exit_true = body;
+  entry->exit_false = nullptr;
+  cfg->getBlocks().push_back(body);
+  return body;
+}
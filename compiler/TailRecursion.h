@@ -0,0 +1,43 @@
+#pragma once
+#include "ir.h"
+
+#include <vector>
+
+// Self-recursive tail calls turned into loops, on the IR before SSA.
+//
+// A call of the function itself whose result is returned right away (or a
+// void call followed by a return) reuses the current frame: the arguments are
+// assigned to the parameters, through temporaries since they may read the
+// parameters, and the block jumps back to the start of the body. The body
+// moves out of the entry block, which keeps the param_decl instructions, so
+// that it can be jumped to.
+//
+// A returned `x + f(...)` or `x * f(...)` becomes a tail call as well, with
+// an accumulator: the operand is folded into it before jumping, and every
+// other return applies it to the value returned. The wrapping int addition
+// and multiplication are associative, so the result is unchanged.
+//
+// A function taking the address of a local array is left alone: a call may
+// be given that address, and the array would be the one the loop reuses.
+class TailRecursion {
+public:
+  explicit TailRecursion(CFG *cfg);
+
+  // Returns the number of calls turned into jumps
+  int run();
+
+private:
+  struct Site {
+    BasicBlock *bb;
+    size_t call;            /**< index of the call in bb */
+    IRInstr::Operation op;  /**< add or mul with an accumulator, or nothing */
+    SymbolId operand;       /**< other operand of op */
+  };
+
+  CFG *cfg;
+
+  // The self-recursive tail call of the block, if any
+  bool findSite(BasicBlock *bb, Site &site) const;
+  // Moves the body out of the entry block, returns its first block
+  BasicBlock *splitEntry();
+};
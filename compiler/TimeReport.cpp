@@ -0,0 +1,24 @@
+#include "TimeReport.h"
+
+#include <iomanip>
+
+bool TimeReport::mEnabled = false;
+std::vector<std::pair<std::string, double>> TimeReport::mPhases;
+
+void TimeReport::add(const std::string &phase, double seconds) {
+  for (auto &entry : mPhases) {
+    if (entry.first == phase) {
+      entry.second += seconds;
+      return;
+    }
+  }
+  mPhases.emplace_back(phase, seconds);
+}
+
+void TimeReport::print(std::ostream &os) {
+  for (auto &entry : mPhases) {
+    os << "time-report: " << std::left << std::setw(31) << entry.first << " "
+       << std::fixed << std::setprecision(6) << entry.second << " s"
+       << std::endl;
+  }
+}
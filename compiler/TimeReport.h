@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Accumulates the time spent in each compilation phase, across all functions.
+// Enabled with -ftime-report; the totals are printed on stderr at exit.
+class TimeReport {
+public:
+  static inline void enable() { mEnabled = true; }
+  static inline bool isEnabled() { return mEnabled; }
+
+  static void add(const std::string &phase, double seconds);
+  static void print(std::ostream &os);
+
+  // Measures the lifetime of the object and adds it to the given phase
+  class Scope {
+  public:
+    explicit Scope(const std::string &phase)
+        : phase(phase), start(std::chrono::steady_clock::now()) {}
+    ~Scope() {
+      if (TimeReport::isEnabled()) {
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        TimeReport::add(phase, elapsed.count());
+      }
+    }
+
+  private:
+    std::string phase;
+    std::chrono::steady_clock::time_point start;
+  };
+
+protected:
+  static bool mEnabled;
+  static std::vector<std::pair<std::string, double>> mPhases;
+};
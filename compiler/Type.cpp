@@ -1,13 +1,81 @@
 #include "Type.h"
 
-unsigned int getSize(Type t) {
-  switch (t) {
-  case Type::INT:
+#include <algorithm>
+
+const Type Type::INT(Type::Int);
+const Type Type::CHAR(Type::Char);
+const Type Type::VOID(Type::Void);
+
+Type Type::pointerTo(const Type &element) {
+  Type t(Pointer);
+  t.element = std::make_shared<const Type>(element);
+  return t;
+}
+
+Type Type::arrayOf(const Type &element, int length) {
+  Type t(Array);
+  t.length = length;
+  t.element = std::make_shared<const Type>(element);
+  return t;
+}
+
+bool Type::operator==(const Type &other) const {
+  if (kind != other.kind || length != other.length) {
+    return false;
+  }
+  return element == nullptr || *element == *other.element;
+}
+
+std::string Type::toString() const {
+  switch (kind) {
+  case Int:
+    return "int";
+  case Char:
+    return "char";
+  case Void:
+    return "void";
+  case Pointer:
+    return element->toString() + "*";
+  case Array:
+    return element->toString() + "[" + std::to_string(length) + "]";
+  }
+  return "";
+}
+
+unsigned int getSize(const Type &t) {
+  switch (t.getKind()) {
+  case Type::Int:
     return 4;
-  case Type::CHAR:
+  case Type::Char:
     return 1;
-  case Type::VOID:
+  case Type::Void:
+    return 0;
+  case Type::Pointer:
+    return 8;
+  case Type::Array:
+    return t.getLength() * getSize(t.getElement());
+  }
+  return 0;
+}
+
+unsigned int getSlotSize(const Type &t) {
+  switch (t.getKind()) {
+  case Type::Int:
+  case Type::Char:
+    return 4;
+  case Type::Void:
     return 0;
+  case Type::Pointer:
+    return 8;
+  case Type::Array:
+    return (getSize(t) + 3) / 4 * 4;
   }
   return 0;
 }
+
+unsigned int getSlotAlignment(const Type &t) {
+  if (t.isArray()) {
+    return std::max(4u, getSize(t.getElement()));
+  }
+  return getSlotSize(t);
+}
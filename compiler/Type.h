@@ -1,4 +1,46 @@
 #pragma once
-enum class Type { INT, CHAR, VOID };
+#include <memory>
+#include <string>
 
-unsigned int getSize(Type t);
+// Type of a symbol or a value: int, char, void, a pointer to a type, or an
+// array of a type with its length. Pointers are the only 64-bit values, the
+// others are handled as 32-bit ones.
+class Type {
+public:
+  enum Kind { Int, Char, Void, Pointer, Array };
+
+  static const Type INT;
+  static const Type CHAR;
+  static const Type VOID;
+
+  Type() : kind(Int), length(0) {}
+  static Type pointerTo(const Type &element);
+  static Type arrayOf(const Type &element, int length);
+
+  inline Kind getKind() const { return kind; }
+  inline bool isPointer() const { return kind == Pointer; }
+  inline bool isArray() const { return kind == Array; }
+  // The type pointed to, or the type of the elements of an array
+  inline const Type &getElement() const { return *element; }
+  inline int getLength() const { return length; }
+
+  bool operator==(const Type &other) const;
+  inline bool operator!=(const Type &other) const { return !(*this == other); }
+
+  std::string toString() const;
+
+private:
+  explicit Type(Kind kind) : kind(kind), length(0) {}
+
+  Kind kind;
+  int length; /**< of an array */
+  std::shared_ptr<const Type> element;
+};
+
+unsigned int getSize(const Type &t);
+// Bytes of the stack slot of a value of the type: char values are kept
+// sign-extended, so that any slot of a scalar reads as a 32-bit operand
+unsigned int getSlotSize(const Type &t);
+// Alignment of that slot: its size for a scalar, the one of the elements for
+// an array
+unsigned int getSlotAlignment(const Type &t);
@@ -0,0 +1,167 @@
+#include "ValueNumbering.h"
+
+#include <algorithm>
+
+bool ValueNumbering::Expression::operator==(const Expression &other) const {
+  return op == other.op && type == other.type && operands == other.operands &&
+         constant == other.constant && block == other.block;
+}
+
+size_t ValueNumbering::ExpressionHash::operator()(
+    const Expression &expression) const {
+  size_t hash = std::hash<int>()(expression.op) * 31 +
+                std::hash<int>()(expression.type.getKind());
+  for (SymbolId operand : expression.operands) {
+    hash = hash * 31 + std::hash<SymbolId>()(operand);
+  }
+  hash = hash * 31 + std::hash<std::string>()(expression.constant);
+  return hash * 31 + std::hash<BasicBlock *>()(expression.block);
+}
+
+ValueNumbering::ValueNumbering(CFG *cfg) : cfg(cfg) {}
+
+int ValueNumbering::run() {
+  valueNumber.resize(cfg->getSymbolCount());
+  for (SymbolId symbol = 0; symbol < valueNumber.size(); symbol++) {
+    valueNumber[symbol] = symbol;
+  }
+
+  // Iterative preorder walk of the dominator tree: the expressions of a
+  // block are removed once all the blocks it dominates are numbered
+  Dominators dominators(cfg);
+  struct Frame {
+    BasicBlock *bb;
+    bool numbered;
+    std::vector<Expression> added;
+  };
+  int replaced = 0;
+  std::vector<Frame> stack = {{cfg->getBlocks()[0], false, {}}};
+  while (!stack.empty()) {
+    if (stack.back().numbered) {
+      for (const Expression &expression : stack.back().added) {
+        available.erase(expression);
+      }
+      stack.pop_back();
+      continue;
+    }
+    stack.back().numbered = true;
+    BasicBlock *bb = stack.back().bb;
+    stack.back().added = numberBlock(bb, replaced);
+    for (BasicBlock *child : dominators.children(bb)) {
+      stack.push_back({child, false, {}});
+    }
+  }
+  return replaced;
+}
+
+bool ValueNumbering::getExpression(BasicBlock *bb, const IRInstr &instr,
+                                   Expression &expression) const {
+  IRInstr::Operation op = instr.getOperation();
+  expression.op = op;
+  expression.type = cfg->getSymbol(instr.getDeclaredVariable()[0]).type;
+  expression.block = nullptr;
+  for (SymbolId operand : instr.getUsedVariables()) {
+    expression.operands.push_back(valueNumber[operand]);
+  }
+
+  // Commutative: the operands are put in a canonical order
+  if (instr.isCommutative()) {
+    std::sort(expression.operands.begin(), expression.operands.end());
+  }
+  switch (op) {
+  case IRInstr::add:
+  case IRInstr::mul:
+  case IRInstr::b_and:
+  case IRInstr::b_or:
+  case IRInstr::b_xor:
+  case IRInstr::eq:
+  case IRInstr::neq:
+  case IRInstr::sub:
+  case IRInstr::div:
+  case IRInstr::mod:
+  case IRInstr::lt:
+  case IRInstr::leq:
+  case IRInstr::gt:
+  case IRInstr::geq:
+  case IRInstr::neg:
+  case IRInstr::not_:
+  case IRInstr::lnot:
+  case IRInstr::inc:
+  case IRInstr::dec:
+    return true;
+  case IRInstr::ldconst:
+    expression.constant = std::get<std::string>(instr.getParams()[0]);
+    return true;
+  case IRInstr::addr:
+  case IRInstr::lea:
+    // The object or global, and the constant index and scale
+    if (instr.getObject() != invalidSymbol) {
+      expression.constant = "#" + std::to_string(instr.getObject());
+    }
+    for (const Parameter &param : instr.getParams()) {
+      if (std::holds_alternative<std::string>(param)) {
+        expression.constant += std::get<std::string>(param) + ",";
+      }
+    }
+    return true;
+  case IRInstr::phi:
+    expression.block = bb;
+    return true;
+  default:
+    return false;
+  }
+}
+
+std::vector<ValueNumbering::Expression>
+ValueNumbering::numberBlock(BasicBlock *bb, int &replaced) {
+  std::vector<Expression> added;
+  for (IRInstr &instr : bb->instrs) {
+    std::vector<SymbolId> declared = instr.getDeclaredVariable();
+    if (declared.empty()) {
+      continue;
+    }
+    SymbolId dest = declared[0];
+    Type type = cfg->getSymbol(dest).type;
+
+    // A copy has the value number of its source, unless it truncates it
+    if (instr.getOperation() == IRInstr::var_assign) {
+      if (cfg->isCopy(instr)) {
+        valueNumber[dest] = valueNumber[instr.getSymbolParam(1)];
+      }
+      continue;
+    }
+
+    Expression expression;
+    if (!getExpression(bb, instr, expression)) {
+      continue;
+    }
+    // A phi whose sources all have the same value number is that value
+    if (instr.getOperation() == IRInstr::phi &&
+        std::all_of(expression.operands.begin(), expression.operands.end(),
+                    [&](SymbolId operand) {
+                      return operand == expression.operands[0];
+                    })) {
+      valueNumber[dest] = expression.operands[0];
+      continue;
+    }
+
+    auto earlier = available.find(expression);
+    if (earlier == available.end()) {
+      available.emplace(expression, dest);
+      added.push_back(expression);
+      continue;
+    }
+    valueNumber[dest] = valueNumber[earlier->second];
+    // Constants are loaded again rather than kept alive, and the phis stay
+    // first in their block. A copy into a char truncates, which only the
+    // results already truncated by inc and dec are safe from.
+    IRInstr::Operation op = instr.getOperation();
+    if (op == IRInstr::ldconst || op == IRInstr::phi ||
+        (type == Type::CHAR && op != IRInstr::inc && op != IRInstr::dec)) {
+      continue;
+    }
+    instr = IRInstr(bb, IRInstr::var_assign, type, {dest, earlier->second});
+    replaced++;
+  }
+  return added;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "Dominators.h"
+#include "ir.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Dominator-based global value numbering, on the SSA form of the IR.
+//
+// The blocks are walked in dominator tree order with a scoped hash table of
+// the expressions computed so far, keyed by their operation and the value
+// numbers of their operands (sorted for the commutative operations). An
+// instruction recomputing an expression available in a dominating block is
+// replaced by a copy of the earlier result. The value number of a copy is
+// the one of its source, so the redundancy is also found through copies and
+// through constants loaded twice.
+class ValueNumbering {
+public:
+  explicit ValueNumbering(CFG *cfg);
+
+  // Returns the number of instructions replaced by a copy
+  int run();
+
+private:
+  struct Expression {
+    IRInstr::Operation op;
+    Type type; /**< of the result: storing into a char truncates */
+    std::vector<SymbolId> operands;
+    std::string constant;
+    BasicBlock *block; /**< phi only, a phi merging the block's edges */
+
+    bool operator==(const Expression &other) const;
+  };
+  struct ExpressionHash {
+    size_t operator()(const Expression &expression) const;
+  };
+
+  CFG *cfg;
+  std::vector<SymbolId> valueNumber; /**< by SymbolId */
+  std::unordered_map<Expression, SymbolId, ExpressionHash> available;
+
+  // The expression computed by the instruction, or false if it is not pure
+  bool getExpression(BasicBlock *bb, const IRInstr &instr,
+                     Expression &expression) const;
+  // Numbers the instructions of the block, returns the expressions it makes
+  // available to the blocks it dominates
+  std::vector<Expression> numberBlock(BasicBlock *bb, int &replaced);
+};
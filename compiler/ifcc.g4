@@ -2,12 +2,15 @@ grammar ifcc;
 
 axiom : prog EOF ;
 
-prog : func+ ;
+prog : (func | var_decl_stmt)+ ;
 
-func : TYPE ID '(' (TYPE ID (',' TYPE ID)*)? ')' block ;
+func : type ID '(' (type ID (',' type ID)*)? ')' block ;
+
+type : TYPE (stars+='*')* ;
 
 stmt : var_decl_stmt
      | var_assign_stmt
+     | mem_assign_stmt
      | if_stmt
      | while_stmt
      | block
@@ -15,8 +18,9 @@ stmt : var_decl_stmt
      | return_stmt;
 
 var_decl_stmt : TYPE var_decl_member (',' var_decl_member)* ';';
-var_decl_member: ID ('=' expr)?;
+var_decl_member: (stars+='*')* ID ('[' INTEGER_LITERAL ']')? ('=' expr)?;
 var_assign_stmt: ID '=' expr ';' ;
+mem_assign_stmt: expr '=' expr ';' ;
 if_stmt: IF '(' expr ')' block #if
        | IF '(' expr ')' if_block=block ELSE else_block=block #if_else
        ;
@@ -25,7 +29,8 @@ while_stmt: WHILE '(' expr ')' block;
 block: '{' stmt* '}';
 
 expr : '(' expr ')' #par
-     | op=('-'|'~'|'!'|'++'|'--'|'+') expr #unaryOp
+     | expr '[' expr ']' #subscript
+     | op=('-'|'~'|'!'|'++'|'--'|'+'|'*'|'&') expr #unaryOp
      | ID '(' (expr (',' expr)*)? ')' #func_call
      | expr op=('*' | '/' | '%') expr #multdiv
      | expr op=('+' | '-') expr #addsub
@@ -1,114 +1,236 @@
 #include "ir.h"
+#include "BlockLayout.h"
+#include "CFGSimplification.h"
 #include "CodeGenVisitor.h"
+#include "ConstantPropagation.h"
+#include "CopyPropagation.h"
+#include "DeadCodeElimination.h"
+#include "InductionVariables.h"
+#include "InterferenceGraph.h"
+#include "LinearScan.h"
+#include "Liveness.h"
+#include "LoopInfo.h"
+#include "LoopInvariantCodeMotion.h"
+#include "LoopUnrolling.h"
+#include "Options.h"
+#include "Peephole.h"
+#include "SSA.h"
+#include "StackSlotColoring.h"
+#include "Statistics.h"
+#include "TailRecursion.h"
+#include "TimeReport.h"
+#include "ValueNumbering.h"
 #include "Type.h"
 #include "VisitorErrorListener.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstdint>
 #include <iostream>
 #include <memory>
-#include <queue>
 #include <string>
 
-std::ostream &operator<<(std::ostream &os, const Parameter &param) {
-  if (auto symbol = std::get_if<std::shared_ptr<Symbol>>(&param)) {
-    os << (*symbol)->lexeme;
-  } else if (auto n = std::get_if<std::string>(&param)) {
+namespace {
+// A parameter together with the CFG owning its symbol, for printing
+struct PrintedParameter {
+  const Parameter &param;
+  CFG *cfg;
+};
+
+std::ostream &operator<<(std::ostream &os, const PrintedParameter &printed) {
+  if (auto symbol = std::get_if<SymbolId>(&printed.param)) {
+    os << printed.cfg->getSymbol(*symbol).lexeme;
+  } else if (auto n = std::get_if<std::string>(&printed.param)) {
     os << *n;
   }
 
   return os;
 }
 
+// Condition code holding when the comparison is false, or nullptr if the
+// operation is not a comparison
+const char *negatedCondition(IRInstr::Operation op) {
+  switch (op) {
+  case IRInstr::lt:
+    return "ge";
+  case IRInstr::leq:
+    return "g";
+  case IRInstr::gt:
+    return "le";
+  case IRInstr::geq:
+    return "l";
+  case IRInstr::eq:
+    return "ne";
+  case IRInstr::neq:
+    return "e";
+  default:
+    return nullptr;
+  }
+}
+
+struct Magic {
+  int32_t multiplier;
+  int shift;
+};
+
+// Magic number of the signed division by d >= 2 (Hacker's Delight, 10-1):
+// n / d is the high half of n * multiplier (plus n when the multiplier is
+// negative) shifted right by shift, plus one when n is negative
+Magic signedMagic(uint32_t d) {
+  const uint32_t two31 = 0x80000000u;
+  uint32_t anc = two31 - 1 - two31 % d; /**< |nc| */
+  int p = 31;
+  uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+  uint32_t q2 = two31 / d, r2 = two31 - q2 * d;
+  uint32_t delta;
+  do {
+    p++;
+    q1 *= 2;
+    r1 *= 2;
+    if (r1 >= anc) {
+      q1++;
+      r1 -= anc;
+    }
+    q2 *= 2;
+    r2 *= 2;
+    if (r2 >= d) {
+      q2++;
+      r2 -= d;
+    }
+    delta = d - r2;
+  } while (q1 < delta || (q1 == delta && r1 == 0));
+  return {(int32_t)(q2 + 1), p - 32};
+}
+
+// log2 of x if x is a power of two, otherwise -1
+int exactLog2(uint32_t x) {
+  if (x == 0 || (x & (x - 1)) != 0) {
+    return -1;
+  }
+  return __builtin_ctz(x);
+}
+} // namespace
+
 IRInstr::IRInstr(BasicBlock *bb_, Operation op, Type t,
                  const std::vector<Parameter> &params)
     : block(bb_), op(op), outType(t), params(params) {}
 
-void IRInstr::genAsm(std::ostream &os, CFG *cfg) {
+void IRInstr::genAsm(MachineCode &code, CFG *cfg) {
   switch (op) {
   case add:
-    handleBinaryOp("addl", os, cfg);
+    handleBinaryOp("addl", code, cfg);
     break;
   case sub:
-    handleBinaryOp("subl", os, cfg);
+    handleBinaryOp("subl", code, cfg);
     break;
   case mul:
-    handleBinaryOp("imull", os, cfg);
+    handleBinaryOp("imull", code, cfg);
     break;
   case cmpNZ:
-    handleCmpNZ(os, cfg);
+    handleCmpNZ(code, cfg);
+    break;
+  case cmp:
+    handleCmp(code, cfg);
     break;
   case div:
-    handleDiv(os, cfg);
+    handleDiv(code, cfg);
     break;
   case mod:
-    handleMod(os, cfg);
+    handleMod(code, cfg);
+    break;
+  case mulconst:
+    handleMulConst(code, cfg);
+    break;
+  case divconst:
+    handleDivConst(false, code, cfg);
+    break;
+  case modconst:
+    handleDivConst(true, code, cfg);
     break;
   case b_and:
-    handleBinaryOp("andl", os, cfg);
+    handleBinaryOp("andl", code, cfg);
     break;
   case b_or:
-    handleBinaryOp("orl", os, cfg);
+    handleBinaryOp("orl", code, cfg);
     break;
   case b_xor:
-    handleBinaryOp("xorl", os, cfg);
+    handleBinaryOp("xorl", code, cfg);
     break;
   case lt:
-    handleCmpOp("setl", os, cfg);
+    handleCmpOp("setl", code, cfg);
     break;
   case leq:
-    handleCmpOp("setle", os, cfg);
+    handleCmpOp("setle", code, cfg);
     break;
   case gt:
-    handleCmpOp("setg", os, cfg);
+    handleCmpOp("setg", code, cfg);
     break;
   case geq:
-    handleCmpOp("setge", os, cfg);
+    handleCmpOp("setge", code, cfg);
     break;
   case eq:
-    handleCmpOp("sete", os, cfg);
+    handleCmpOp("sete", code, cfg);
     break;
   case neq:
-    handleCmpOp("setne", os, cfg);
+    handleCmpOp("setne", code, cfg);
     break;
   case ret:
-    handleRet(os, cfg);
+    handleRet(code, cfg);
     break;
   case var_assign:
-    handleVar_assign(os, cfg);
+    handleVar_assign(code, cfg);
     break;
   case ldconst:
-    handleLdconst(os, cfg);
+    handleLdconst(code, cfg);
     break;
   case ldvar:
-    handleLdvar(os, cfg);
+    handleLdvar(code, cfg);
+    break;
   case neg:
-    handleUnaryOp("neg", os, cfg);
+    handleUnaryOp("neg", code, cfg);
     break;
   case not_:
-    handleUnaryOp("notl", os, cfg);
+    handleUnaryOp("notl", code, cfg);
     break;
   case lnot:
-    handleUnaryOp("lnot", os, cfg);
+    handleUnaryOp("lnot", code, cfg);
     break;
   case inc:
-    handleUnaryOp("inc", os, cfg);
+    handleUnaryOp("inc", code, cfg);
     break;
   case dec:
-    handleUnaryOp("dec", os, cfg);
+    handleUnaryOp("dec", code, cfg);
+    break;
+  case addr:
+    handleAddr(code, cfg);
+    break;
+  case lea:
+    handleLea(code, cfg);
+    break;
+  case load:
+    handleLoad(code, cfg);
+    break;
+  case store:
+    handleStore(code, cfg);
     break;
   case nothing:
     break;
   case call:
-    handleCall(os, cfg);
+  case tailcall:
+    handleCall(code, cfg);
     break;
   case param:
-    handleParam(os, cfg);
+    handleParam(code, cfg);
     break;
   case param_decl:
     break;
+  case phi:
+    // Replaced by copies before code generation (see SSADestruction)
+    break;
   }
 }
 
-std::set<std::shared_ptr<Symbol>> IRInstr::getUsedVariables() {
-  std::set<std::shared_ptr<Symbol>> result;
+std::vector<int> IRInstr::getUseIndices() const {
   switch (op) {
   case IRInstr::add:
   case IRInstr::sub:
@@ -124,48 +246,69 @@ std::set<std::shared_ptr<Symbol>> IRInstr::getUsedVariables() {
   case IRInstr::geq:
   case IRInstr::eq:
   case IRInstr::neq:
-    result.insert(std::get<std::shared_ptr<Symbol>>(params[0]));
-    result.insert(std::get<std::shared_ptr<Symbol>>(params[1]));
-    break;
+  case IRInstr::cmp:
+    return {0, 1};
   case IRInstr::ldconst:
-    break;
+    return {};
   case IRInstr::var_assign:
-  case IRInstr::lnot:
-    result.insert(std::get<std::shared_ptr<Symbol>>(params[1]));
-    break;
+    return {1};
   case IRInstr::cmpNZ:
   case IRInstr::neg:
   case IRInstr::not_:
+  case IRInstr::lnot:
   case IRInstr::inc:
   case IRInstr::dec:
   case IRInstr::param:
-    result.insert(std::get<std::shared_ptr<Symbol>>(params[0]));
-    break;
+  case IRInstr::mulconst:
+  case IRInstr::divconst:
+  case IRInstr::modconst:
+    return {0};
   case ret:
     if (outType != Type::VOID) {
-      result.insert(std::get<std::shared_ptr<Symbol>>(params[0]));
+      return {0};
     }
-    break;
+    return {};
   case IRInstr::nothing:
   case IRInstr::ldvar:
   case IRInstr::param_decl:
-    break;
-  case IRInstr::call: {
+  case IRInstr::addr:
+    return {};
+  case IRInstr::lea:
+  case IRInstr::load:
+  case IRInstr::store: {
+    std::vector<int> result;
+    if (std::holds_alternative<SymbolId>(params[0]) &&
+        getObject() == invalidSymbol) {
+      result.push_back(0);
+    }
+    if (std::holds_alternative<SymbolId>(params[1])) {
+      result.push_back(1);
+    }
+    if (op == IRInstr::store) {
+      result.push_back(2);
+    }
+    return result;
+  }
+  case IRInstr::call:
+  case IRInstr::tailcall:
+  case IRInstr::phi: {
+    // call: the function name, the arguments then the result if any.
+    // phi: the result then the sources.
+    std::vector<int> result;
     int cnt = params.size();
-    if (outType != Type::VOID) {
+    if (op == IRInstr::call && outType != Type::VOID) {
       cnt--;
     }
     for (int i = 1; i < cnt; i++) {
-      result.insert(std::get<std::shared_ptr<Symbol>>(params[i]));
+      result.push_back(i);
     }
-    break;
+    return result;
   }
   }
-  return result;
+  return {};
 }
 
-std::set<std::shared_ptr<Symbol>> IRInstr::getDeclaredVariable() {
-  std::set<std::shared_ptr<Symbol>> result;
+int IRInstr::getDefIndex() const {
   switch (op) {
   case IRInstr::add:
   case IRInstr::sub:
@@ -181,538 +324,835 @@ std::set<std::shared_ptr<Symbol>> IRInstr::getDeclaredVariable() {
   case IRInstr::geq:
   case IRInstr::eq:
   case IRInstr::neq:
-    result.insert(std::get<std::shared_ptr<Symbol>>(params[2]));
-    break;
+  case IRInstr::mulconst:
+  case IRInstr::divconst:
+  case IRInstr::modconst:
+  case IRInstr::load:
+    return 2;
   case IRInstr::ldconst:
-  case IRInstr::lnot:
-    result.insert(std::get<std::shared_ptr<Symbol>>(params[1]));
-    break;
-  case IRInstr::var_assign:
   case IRInstr::neg:
   case IRInstr::not_:
+  case IRInstr::lnot:
   case IRInstr::inc:
   case IRInstr::dec:
+  case IRInstr::addr:
+    return 1;
+  case IRInstr::lea:
+    return 3;
+  case IRInstr::var_assign:
   case IRInstr::param_decl:
-    result.insert(std::get<std::shared_ptr<Symbol>>(params[0]));
-    break;
+  case IRInstr::phi:
+    return 0;
   case IRInstr::call:
     if (outType != Type::VOID) {
-      result.insert(
-          std::get<std::shared_ptr<Symbol>>(params[params.size() - 1]));
+      return params.size() - 1;
     }
-    break;
+    return -1;
   case IRInstr::ret:
   case IRInstr::cmpNZ:
+  case IRInstr::cmp:
   case IRInstr::ldvar:
   case IRInstr::nothing:
   case IRInstr::param:
-    break;
+  case IRInstr::tailcall:
+  case IRInstr::store:
+    return -1;
+  }
+  return -1;
+}
+
+std::vector<SymbolId> IRInstr::getUsedVariables() const {
+  std::vector<SymbolId> result;
+  for (int i : getUseIndices()) {
+    result.push_back(getSymbolParam(i));
   }
   return result;
 }
 
+std::vector<SymbolId> IRInstr::getDeclaredVariable() const {
+  int def = getDefIndex();
+  if (def < 0) {
+    return {};
+  }
+  return {getSymbolParam(def)};
+}
+
+bool IRInstr::hasSideEffects() const {
+  switch (op) {
+  case IRInstr::cmpNZ:
+  case IRInstr::cmp:
+  case IRInstr::ret:
+  case IRInstr::call:
+  case IRInstr::tailcall:
+  case IRInstr::param:
+  case IRInstr::param_decl:
+  case IRInstr::store:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool IRInstr::isCommutative() const {
+  switch (op) {
+  case IRInstr::add:
+  case IRInstr::mul:
+  case IRInstr::b_and:
+  case IRInstr::b_or:
+  case IRInstr::b_xor:
+  case IRInstr::eq:
+  case IRInstr::neq:
+    return true;
+  default:
+    return false;
+  }
+}
+
+SymbolId IRInstr::getObject() const {
+  if (op != IRInstr::addr && op != IRInstr::lea && op != IRInstr::load &&
+      op != IRInstr::store) {
+    return invalidSymbol;
+  }
+  auto symbol = std::get_if<SymbolId>(&params[0]);
+  if (symbol == nullptr || !block->cfg->getSymbol(*symbol).type.isArray()) {
+    return invalidSymbol;
+  }
+  return *symbol;
+}
+
 std::ostream &operator<<(std::ostream &os, IRInstr &instruction) {
+  auto param = [&instruction](int i) {
+    return PrintedParameter{instruction.params[i], instruction.block->cfg};
+  };
   switch (instruction.op) {
   case IRInstr::add:
-    os << instruction.params[2] << " = " << instruction.params[0] << " + "
-       << instruction.params[1];
+    os << param(2) << " = " << param(0) << " + " << param(1);
     break;
   case IRInstr::sub:
-    os << instruction.params[2] << " = " << instruction.params[0] << " - "
-       << instruction.params[1];
+    os << param(2) << " = " << param(0) << " - " << param(1);
     break;
   case IRInstr::div:
-    os << instruction.params[2] << " = " << instruction.params[0] << " / "
-       << instruction.params[1];
+  case IRInstr::divconst:
+    os << param(2) << " = " << param(0) << " / " << param(1);
     break;
   case IRInstr::mod:
-    os << instruction.params[2] << " = " << instruction.params[0] << " % "
-       << instruction.params[1];
+  case IRInstr::modconst:
+    os << param(2) << " = " << param(0) << " % " << param(1);
     break;
   case IRInstr::mul:
-    os << instruction.params[2] << " = " << instruction.params[0] << " * "
-       << instruction.params[1];
+  case IRInstr::mulconst:
+    os << param(2) << " = " << param(0) << " * " << param(1);
     break;
   case IRInstr::lt:
-    os << instruction.params[2] << " = " << instruction.params[0] << " < "
-       << instruction.params[1];
+    os << param(2) << " = " << param(0) << " < " << param(1);
     break;
   case IRInstr::leq:
-    os << instruction.params[2] << " = " << instruction.params[0]
-       << " <= " << instruction.params[1];
+    os << param(2) << " = " << param(0) << " <= " << param(1);
     break;
   case IRInstr::gt:
-    os << instruction.params[2] << " = " << instruction.params[0] << " > "
-       << instruction.params[1];
+    os << param(2) << " = " << param(0) << " > " << param(1);
     break;
   case IRInstr::geq:
-    os << instruction.params[2] << " = " << instruction.params[0]
-       << " >= " << instruction.params[1];
+    os << param(2) << " = " << param(0) << " >= " << param(1);
     break;
   case IRInstr::eq:
-    os << instruction.params[2] << " = " << instruction.params[0]
-       << " == " << instruction.params[1];
+    os << param(2) << " = " << param(0) << " == " << param(1);
     break;
   case IRInstr::neq:
-    os << instruction.params[2] << " = " << instruction.params[0]
-       << " != " << instruction.params[1];
+    os << param(2) << " = " << param(0) << " != " << param(1);
     break;
   case IRInstr::b_and:
-    os << instruction.params[2] << " = " << instruction.params[0] << " & "
-       << instruction.params[1];
+    os << param(2) << " = " << param(0) << " & " << param(1);
     break;
   case IRInstr::b_or:
-    os << instruction.params[2] << " = " << instruction.params[0] << " | "
-       << instruction.params[1];
+    os << param(2) << " = " << param(0) << " | " << param(1);
     break;
   case IRInstr::b_xor:
-    os << instruction.params[2] << " = " << instruction.params[0] << " ^ "
-       << instruction.params[1];
+    os << param(2) << " = " << param(0) << " ^ " << param(1);
     break;
   case IRInstr::ldconst:
-    os << instruction.params[1] << " = " << instruction.params[0];
+    os << param(1) << " = " << param(0);
     break;
   case IRInstr::ldvar:
-    os << "ldvar " << instruction.params[0];
+    os << "ldvar " << param(0);
     break;
   case IRInstr::ret:
-    os << "ret " << instruction.params[0];
+    os << "ret";
+    if (!instruction.params.empty()) {
+      os << " " << param(0);
+    }
     break;
   case IRInstr::var_assign:
-    os << instruction.params[0] << " = " << instruction.params[1];
+    os << param(0) << " = " << param(1);
     break;
   case IRInstr::cmpNZ:
-    os << instruction.params[0] << " !=  0";
+    os << param(0) << " !=  0";
+    break;
+  case IRInstr::cmp:
+    os << "cmp " << param(0) << ", " << param(1);
     break;
   case IRInstr::neg:
-    os << " - " << instruction.params[0];
+    os << param(1) << " = - " << param(0);
     break;
   case IRInstr::not_:
-    os << " ~ " << instruction.params[0];
+    os << param(1) << " = ~ " << param(0);
     break;
   case IRInstr::lnot:
-    os << instruction.params[1] << "= ! " << instruction.params[0];
+    os << param(1) << " = ! " << param(0);
     break;
   case IRInstr::inc:
-    os << "++" << instruction.params[0];
+    os << param(1) << " = ++" << param(0);
     break;
   case IRInstr::dec:
-    os << "--" << instruction.params[0];
+    os << param(1) << " = --" << param(0);
+    break;
+  case IRInstr::addr:
+    os << param(1) << " = &" << param(0);
+    break;
+  case IRInstr::lea:
+    os << param(3) << " = " << param(0) << " + " << param(1) << " * "
+       << param(2);
+    break;
+  case IRInstr::load:
+    os << param(2) << " = " << param(0) << "[" << param(1) << "]";
+    break;
+  case IRInstr::store:
+    os << param(0) << "[" << param(1) << "] = " << param(2);
+    break;
+  case IRInstr::phi:
+    os << param(0) << " = phi(";
+    for (size_t i = 1; i < instruction.params.size(); i++) {
+      os << (i > 1 ? ", " : "") << param(i) << " "
+         << instruction.phiBlocks[i - 1]->label;
+    }
+    os << ")";
     break;
   case IRInstr::nothing:
   case IRInstr::call:
-    if (instruction.params.size() == 2) {
-      os << instruction.params[1] << " = call " << instruction.params[0];
+    if (instruction.outType != Type::VOID) {
+      os << param(instruction.params.size() - 1) << " = call " << param(0);
     } else {
-      os << "call " << instruction.params[0];
+      os << "call " << param(0);
     }
     break;
+  case IRInstr::tailcall:
+    os << "tailcall " << param(0);
+    break;
   case IRInstr::param:
-    os << "param " << instruction.params[0];
+    os << "param " << param(0);
     break;
   case IRInstr::param_decl:
-    os << "param_decl " << instruction.params[0];
+    os << "param_decl " << param(0);
     break;
   }
   return os;
 }
 
-void IRInstr::handleCmpNZ(std::ostream &os, CFG *cfg) {
+void IRInstr::handleCmpNZ(MachineCode &code, CFG *cfg) {
+  // Becomes a test when the symbol is in a register (see Peephole)
+  SymbolId symbol = getSymbolParam(0);
+  code.emit(cfg->isWide(symbol) ? "cmpq" : "cmpl",
+            {immediate(0), cfg->gen_asm_source(symbol)});
+}
 
-  int firstRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[0]));
-  if (firstRegister == cfg->scratchRegister) {
-    os << "movl -" << std::get<std::shared_ptr<Symbol>>(params[0])->offset
-       << "(%rbp), " << registers32[firstRegister] << std::endl;
+void IRInstr::handleDivision(MachineCode &code, CFG *cfg) {
+  // Division behaves a little bit differently, it divides the contents of
+  // edx:eax (where ':' means concatenation) with the given operand. The
+  // quotient is stored in eax and the remainder in edx
+  std::string divisor = cfg->gen_asm_source(getSymbolParam(1));
+  int divisorRegister = cfg->findRegister(getSymbolParam(1));
+  if (divisorRegister == RAX || divisorRegister == RDX) {
+    code.emit("movl", {reg32(divisorRegister), reg32(cfg->scratchRegister)});
+    divisor = reg32(cfg->scratchRegister);
   }
+  cfg->gen_asm_load(code, getSymbolParam(0), RAX);
+  code.emit("cltd");
+  code.emit("idivl", {divisor});
+}
 
-  os << "testl %" << registers32[firstRegister] << ", %"
-     << registers32[firstRegister] << std::endl;
+void IRInstr::handleDiv(MachineCode &code, CFG *cfg) {
+  handleDivision(code, cfg);
+  cfg->gen_asm_store(code, RAX, getSymbolParam(2));
 }
 
-void IRInstr::handleDiv(std::ostream &os, CFG *cfg) {
-  // Division behaves a little bit differently, it divides the contents of
-  // edx:eax (where ':' means concatenation) with the content of the given
-  // register The quotient is stored in eax and the remainder in edx
-
-  int firstRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[0]));
-  int secondRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[1]));
-  int destRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[2]));
-  if (firstRegister == cfg->scratchRegister) {
-    os << "movl -" << std::get<std::shared_ptr<Symbol>>(params[0])->offset
-       << "(%rbp), %" << registers32[firstRegister] << std::endl;
-  }
-  os << "movl %" << registers32[firstRegister] << ", %eax" << std::endl;
-  os << "movl $0, %edx" << std::endl;
-  if (secondRegister == cfg->scratchRegister) {
-    os << "movl -" << std::get<std::shared_ptr<Symbol>>(params[1])->offset
-       << "(%rbp), " << registers32[secondRegister] << std::endl;
-  }
-  os << "idivl %" << registers32[secondRegister] << std::endl;
-  os << "movl %eax, %" << registers32[destRegister] << std::endl;
-  if (destRegister == cfg->scratchRegister) {
-    os << "movl %" << registers32[destRegister] << ", -"
-       << std::get<std::shared_ptr<Symbol>>(params[2])->offset << "(%rbp)"
-       << std::endl;
-  }
-}
-
-void IRInstr::handleMod(std::ostream &os, CFG *cfg) {
-  int firstRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[0]));
-  int secondRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[1]));
-  int destRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[2]));
-  if (firstRegister == cfg->scratchRegister) {
-    os << "movl -" << std::get<std::shared_ptr<Symbol>>(params[0])->offset
-       << "(%rbp), %" << registers32[firstRegister] << std::endl;
-  }
-  os << "movl %" << registers32[firstRegister] << ", %eax" << std::endl;
-  os << "movl $0, %edx" << std::endl;
-
-  if (secondRegister == cfg->scratchRegister) {
-    os << "movl -" << std::get<std::shared_ptr<Symbol>>(params[1])->offset
-       << "(%rbp), %" << registers32[secondRegister] << std::endl;
-  }
-  os << "idivl %" << registers32[secondRegister] << std::endl;
-  os << "movl %edx, %" << registers32[destRegister] << std::endl;
-  if (destRegister == cfg->scratchRegister) {
-    os << "movl %" << registers32[destRegister] << ",-"
-       << std::get<std::shared_ptr<Symbol>>(params[2])->offset << "(%rbp)"
-       << std::endl;
-  }
-}
-
-void IRInstr::handleRet(std::ostream &os, CFG *cfg) {
-  if (outType != Type::VOID) {
-    int firstRegister =
-        cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[0]));
+void IRInstr::handleMod(MachineCode &code, CFG *cfg) {
+  handleDivision(code, cfg);
+  cfg->gen_asm_store(code, RDX, getSymbolParam(2));
+}
 
-    if (firstRegister == cfg->scratchRegister) {
-      os << "movl -" << std::get<std::shared_ptr<Symbol>>(params[0])->offset
-         << "(%rbp), %" << registers32[firstRegister] << std::endl;
+void IRInstr::handleMulConst(MachineCode &code, CFG *cfg) {
+  SymbolId source = getSymbolParam(0);
+  int32_t factor = std::stoi(std::get<std::string>(params[1]));
+  int work = cfg->findRegister(getSymbolParam(2));
+  std::string result = reg32(work);
+
+  // factor = 2^shift * odd: odd in {1, 3, 5, 9} is a lea, 2^shift a shift
+  int shift = factor > 0 ? __builtin_ctz(factor) : 0;
+  int32_t odd = factor > 0 ? factor >> shift : factor;
+  if (factor == 0) {
+    code.emit("movl", {immediate(0), result});
+  } else if (odd == 1 || odd == -1) {
+    cfg->gen_asm_load(code, source, work);
+    if (odd == -1) {
+      code.emit("negl", {result});
     }
-    os << "movl %" << registers32[firstRegister] << ", %eax" << std::endl;
+  } else if (odd == 3 || odd == 5 || odd == 9) {
+    int sourceRegister = cfg->findRegister(source);
+    cfg->gen_asm_load(code, source, sourceRegister);
+    std::string base = reg64(sourceRegister);
+    code.emit("leal", {"(" + base + "," + base + "," + std::to_string(odd - 1) +
+                           ")",
+                       result});
+  } else {
+    shift = 0;
+    code.emit("imull",
+              {immediate(factor), cfg->gen_asm_source(source), result});
   }
-  os << "popq %rbp\n";
-  os << "ret\n";
+  if (shift > 0) {
+    code.emit("shll", {immediate(shift), result});
+  }
+  cfg->gen_asm_store(code, work, getSymbolParam(2));
 }
 
-void IRInstr::handleVar_assign(std::ostream &os, CFG *cfg) {
-  int destRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[0]));
-  int sourceRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[1]));
-  auto symbol = std::get<std::shared_ptr<Symbol>>(params[0]);
-  std::string instr = (symbol->type == Type::CHAR ? "movb " : "movl ");
-  const std::string *registers =
-      (symbol->type == Type::CHAR ? registers8 : registers32);
-
-  if (sourceRegister == cfg->scratchRegister) {
-    os << "movl -" << std::get<std::shared_ptr<Symbol>>(params[1])->offset
-       << "(%rbp), %" << registers32[sourceRegister] << std::endl;
+void IRInstr::handleDivConst(bool remainder, MachineCode &code, CFG *cfg) {
+  // The result is computed in the scratch register: the dividend stays where
+  // it is, and is read again
+  std::string n = cfg->gen_asm_source(getSymbolParam(0));
+  int32_t d = std::stoi(std::get<std::string>(params[1]));
+  uint32_t absolute = d < 0 ? -(uint32_t)d : d;
+  std::string q = reg32(cfg->scratchRegister);
+  std::string q64 = reg64(cfg->scratchRegister);
+
+  int k = exactLog2(absolute);
+  if (absolute == 1) {
+    if (remainder) {
+      code.emit("movl", {immediate(0), q});
+    } else {
+      code.emit("movl", {n, q});
+    }
+  } else if (k > 0) {
+    // Rounding toward zero: a negative n is biased by 2^k - 1 first
+    code.emit("movl", {n, q});
+    if (k > 1) {
+      code.emit("sarl", {immediate(31), q});
+    }
+    code.emit("shrl", {immediate(32 - k), q});
+    code.emit("addl", {n, q});
+    if (remainder) {
+      code.emit("andl", {immediate(-(int64_t)absolute), q});
+    } else {
+      code.emit("sarl", {immediate(k), q});
+    }
+  } else {
+    Magic magic = signedMagic(absolute);
+    code.emit("movslq", {n, q64});
+    code.emit("imulq", {immediate(magic.multiplier), q64, q64});
+    if (magic.multiplier >= 0) {
+      code.emit("sarq", {immediate(32 + magic.shift), q64});
+    } else {
+      code.emit("sarq", {immediate(32), q64});
+      code.emit("addl", {n, q});
+      if (magic.shift > 0) {
+        code.emit("sarl", {immediate(magic.shift), q});
+      }
+    }
+    // Plus one when n is negative: its sign bit goes through the carry
+    code.emit("btl", {immediate(31), n});
+    code.emit("adcl", {immediate(0), q});
+    if (remainder) {
+      code.emit("imull", {immediate(absolute), q, q});
+    }
+  }
+  if (remainder && absolute != 1) {
+    // n - (n / d) * d, with q holding the product
+    code.emit("negl", {q});
+    code.emit("addl", {n, q});
+  } else if (!remainder && d < 0) {
+    code.emit("negl", {q});
   }
+  cfg->gen_asm_store(code, cfg->scratchRegister, getSymbolParam(2));
+}
 
-  if (sourceRegister != destRegister) {
-    os << "movl %" << registers32[sourceRegister] << ", %"
-       << registers32[destRegister] << "\n";
+void IRInstr::handleRet(MachineCode &code, CFG *cfg) {
+  if (outType != Type::VOID) {
+    cfg->gen_asm_load(code, getSymbolParam(0), RAX);
   }
-  if (destRegister == cfg->scratchRegister) {
-    os << instr << " %" << registers32[destRegister] << ", -" << symbol->offset
-       << "(%rbp)" << std::endl;
+  cfg->gen_asm_epilogue(code);
+}
+
+void IRInstr::handleVar_assign(MachineCode &code, CFG *cfg) {
+  SymbolId dest = getSymbolParam(0);
+  SymbolId source = getSymbolParam(1);
+  int destRegister = cfg->findRegister(dest);
+
+  cfg->gen_asm_load(code, source, destRegister);
+  if (cfg->getSymbol(dest).type == Type::CHAR) {
+    // Assigning to a char truncates the value
+    code.emit("movsbl", {reg8(destRegister), reg32(destRegister)});
+  } else if (cfg->isWide(dest) && !cfg->isWide(source)) {
+    code.emit("movslq", {reg32(destRegister), reg64(destRegister)});
   }
+  cfg->gen_asm_store(code, destRegister, dest);
 }
 
-void IRInstr::handleLdconst(std::ostream &os, CFG *cfg) {
-  auto symbol = std::get<std::shared_ptr<Symbol>>(params[1]);
+void IRInstr::handleLdconst(MachineCode &code, CFG *cfg) {
+  SymbolId dest = getSymbolParam(1);
   auto val = std::get<std::string>(params[0]);
-  int destRegister = cfg->findRegister(symbol);
-  std::string instr = (symbol->type == Type::CHAR ? "movb" : "movl");
-  const std::string *registers =
-      (symbol->type == Type::CHAR ? registers8 : registers32);
+  int destRegister = cfg->findRegister(dest);
+  bool wide = cfg->isWide(dest);
 
-  os << "movl $" << val << ", %" << registers32[destRegister] << std::endl;
-  if (destRegister == cfg->scratchRegister) {
-    os << "movl %" << registers32[destRegister] << ", -"
-       << std::get<std::shared_ptr<Symbol>>(params[1])->offset << "(%rbp)"
-       << std::endl;
+  if (destRegister != cfg->scratchRegister) {
+    code.emit(moveOfWidth(wide), {"$" + val, regOfWidth(destRegister, wide)});
+  } else {
+    code.emit(moveOfWidth(wide), {"$" + val, cfg->stack_slot(dest)});
   }
 }
 
-void IRInstr::handleLdvar(std::ostream &os, CFG *cfg) {
-  // auto symbol = std::get<std::shared_ptr<Symbol>>(params[0]);
-  // std::string instr = (symbol->type == Type::CHAR ? "movsbl" : "movl");
+void IRInstr::handleLdvar(MachineCode &code, CFG *cfg) {
+  // const Symbol &symbol = cfg->getSymbol(getSymbolParam(0));
+  // std::string instr = (symbol.type == Type::CHAR ? "movsbl" : "movl");
 
-  /**os << instr << " -" << symbol->offset << "(%rbp), %"
+  /**os << instr << " -" << symbol.offset << "(%rbp), %"
      << "rax" << std::endl;*/
 }
 
-void IRInstr::handleBinaryOp(const std::string &op, std::ostream &os,
+void IRInstr::handleBinaryOp(const std::string &op, MachineCode &code,
                              CFG *cfg) {
+  SymbolId first = getSymbolParam(0);
+  SymbolId second = getSymbolParam(1);
+  int firstRegister = cfg->findRegister(first);
+  int secondRegister = cfg->findRegister(second);
+  int destRegister = cfg->findRegister(getSymbolParam(2));
+
+  // The result is computed in the destination register, unless loading the
+  // first operand into it would overwrite the second one. A commutative
+  // operation then starts from the second operand instead.
+  int work = destRegister;
+  if (destRegister == secondRegister && destRegister != firstRegister) {
+    if (isCommutative()) {
+      std::swap(first, second);
+    } else {
+      work = cfg->scratchRegister;
+    }
+  }
+  // Only the difference of two pointers has 64-bit operands
+  bool wide = cfg->isWide(first);
+  std::string source = cfg->gen_asm_source(second);
+  cfg->gen_asm_load(code, first, work);
+  code.emit(wide ? op.substr(0, op.size() - 1) + "q" : op,
+            {source, regOfWidth(work, wide)});
+  cfg->gen_asm_store(code, work, getSymbolParam(2));
+}
 
-  int firstRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[0]));
-  int secondRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[1]));
-  int destRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[2]));
-  if (firstRegister == cfg->scratchRegister) {
-    os << "movl -" << std::get<std::shared_ptr<Symbol>>(params[0])->offset
-       << "(%rbp), %" << registers32[firstRegister] << std::endl;
-  }
-  if (firstRegister == cfg->scratchRegister &&
-      secondRegister == cfg->scratchRegister &&
-      destRegister == cfg->scratchRegister) {
-    os << op << " -" << std::get<std::shared_ptr<Symbol>>(params[1])->offset
-       << "(%rbp), %" << registers32[destRegister] << std::endl;
-  } else if (destRegister != secondRegister) {
-    if (destRegister != firstRegister) {
-      os << "movl %" << registers32[firstRegister] << ", %"
-         << registers32[destRegister] << "\n";
-    }
-    if (secondRegister == cfg->scratchRegister) {
-      os << "movl -" << std::get<std::shared_ptr<Symbol>>(params[1])->offset
-         << "(%rbp), %" << registers32[secondRegister] << std::endl;
-    }
-    os << op << " %" << registers32[secondRegister] << ", %"
-       << registers32[destRegister] << std::endl;
-  } else {
-    if (secondRegister != cfg->scratchRegister) {
-      if (firstRegister != cfg->scratchRegister) {
-        os << "movl %" << registers32[secondRegister] << ", %"
-           << registers32[cfg->scratchRegister] << "\n";
-        os << "movl %" << registers32[firstRegister] << ", %"
-           << registers32[destRegister] << "\n";
-        os << op << " %" << registers32[cfg->scratchRegister] << ", %"
-           << registers32[destRegister] << std::endl;
-      } else {
-        os << "xchg %" << registers32[secondRegister] << ", %"
-           << registers32[firstRegister] << std::endl;
-        os << op << " %" << registers32[firstRegister] << ", %"
-           << registers32[destRegister] << std::endl;
+void IRInstr::handleCmp(MachineCode &code, CFG *cfg) {
+  int firstRegister = cfg->findRegister(getSymbolParam(0));
+  bool wide = cfg->isWide(getSymbolParam(0));
+
+  std::string second = cfg->gen_asm_source(getSymbolParam(1));
+  cfg->gen_asm_load(code, getSymbolParam(0), firstRegister);
+  code.emit(wide ? "cmpq" : "cmpl", {second, regOfWidth(firstRegister, wide)});
+}
+
+void IRInstr::handleCmpOp(const std::string &op, MachineCode &code, CFG *cfg) {
+  int destRegister = cfg->findRegister(getSymbolParam(2));
+
+  handleCmp(code, cfg);
+  code.emit(op, {reg8(cfg->scratchRegister)});
+  code.emit("movzbl", {reg8(cfg->scratchRegister), reg32(destRegister)});
+  cfg->gen_asm_store(code, destRegister, getSymbolParam(2));
+}
+
+int CFG::findRegister(SymbolId symbol) {
+  if (symbol < registerAssignment.size() && registerAssignment[symbol] >= 0 &&
+      (splitInfo.splitSlot.empty() ||
+       currentSlot < splitInfo.splitSlot[symbol])) {
+    return registerAssignment[symbol];
+  }
+  return scratchRegister;
+}
+
+std::string CFG::stack_slot(SymbolId symbol) {
+  return frame_slot(getSymbol(symbol).offset);
+}
+
+std::string CFG::frame_slot(int offset, const std::string &index) {
+  if (framePointer) {
+    return std::to_string(-offset) + "(%rbp" + index + ")";
+  }
+  return std::to_string(frameSize - 8 - offset + stackAdjustment) + "(%rsp" +
+         index + ")";
+}
+
+void CFG::gen_asm_load(MachineCode &code, SymbolId symbol, int reg) {
+  int symbolRegister = findRegister(symbol);
+  bool wide = isWide(symbol);
+  if (symbolRegister == scratchRegister) {
+    code.emit(moveOfWidth(wide), {stack_slot(symbol), regOfWidth(reg, wide)});
+  } else if (symbolRegister != reg) {
+    code.emit(moveOfWidth(wide),
+              {regOfWidth(symbolRegister, wide), regOfWidth(reg, wide)});
+  }
+}
+
+void CFG::gen_asm_store(MachineCode &code, int reg, SymbolId symbol) {
+  int symbolRegister = findRegister(symbol);
+  bool wide = isWide(symbol);
+  if (symbolRegister == scratchRegister) {
+    code.emit(moveOfWidth(wide), {regOfWidth(reg, wide), stack_slot(symbol)});
+  } else if (symbolRegister != reg) {
+    code.emit(moveOfWidth(wide),
+              {regOfWidth(reg, wide), regOfWidth(symbolRegister, wide)});
+  }
+}
+
+std::string CFG::gen_asm_source(SymbolId symbol) {
+  int symbolRegister = findRegister(symbol);
+  if (symbolRegister != scratchRegister) {
+    return regOfWidth(symbolRegister, isWide(symbol));
+  }
+  return stack_slot(symbol);
+}
+
+void CFG::gen_asm_parallel_move(MachineCode &code,
+                                std::vector<std::pair<int, int>> moves,
+                                RegisterSet wide) {
+  moves.erase(std::remove_if(moves.begin(), moves.end(),
+                             [](const std::pair<int, int> &move) {
+                               return move.first == move.second;
+                             }),
+              moves.end());
+  while (!moves.empty()) {
+    // A move can be done once no other one reads its destination
+    auto ready = std::find_if(
+        moves.begin(), moves.end(), [&](const std::pair<int, int> &move) {
+          return std::none_of(moves.begin(), moves.end(),
+                              [&](const std::pair<int, int> &other) {
+                                return other.first == move.second;
+                              });
+        });
+    if (ready == moves.end()) {
+      // Only cycles are left: the destination of a move is saved in the
+      // scratch register, and read from there
+      int saved = moves.front().second;
+      bool savedWide = wide & registerBit(saved);
+      code.emit(moveOfWidth(savedWide), {regOfWidth(saved, savedWide),
+                                         regOfWidth(scratchRegister,
+                                                    savedWide)});
+      if (savedWide) {
+        wide |= registerBit(scratchRegister);
       }
-    } else {
-      os << "movl -" << std::get<std::shared_ptr<Symbol>>(params[1])->offset
-         << "(%rbp), %" << registers32[secondRegister] << std::endl;
-      if (destRegister != firstRegister) {
-        os << "movl %" << registers32[firstRegister] << ", %"
-           << registers32[destRegister] << "\n";
+      for (auto &move : moves) {
+        if (move.first == saved) {
+          move.first = scratchRegister;
+        }
       }
-      os << op << " %" << registers32[secondRegister] << ", %"
-         << registers32[destRegister] << std::endl;
-    }
-  }
-}
-
-void IRInstr::handleCmpOp(const std::string &op, std::ostream &os, CFG *cfg) {
-  int firstRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[0]));
-  int secondRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[1]));
-  int destRegister =
-      cfg->findRegister(std::get<std::shared_ptr<Symbol>>(params[2]));
-  if (firstRegister == cfg->scratchRegister &&
-      secondRegister == cfg->scratchRegister) {
-    os << "movl -" << std::get<std::shared_ptr<Symbol>>(params[0])->offset
-       << "(%rbp), %" << registers32[firstRegister] << std::endl;
-    os << "cmp -" << std::get<std::shared_ptr<Symbol>>(params[1])->offset
-       << "(%rbp)"
-       << ", %" << registers32[firstRegister] << std::endl;
-    os << "movzbl %" << registers8[cfg->scratchRegister] << ", %"
-       << registers32[destRegister] << std::endl;
-  } else {
-    if (firstRegister == cfg->scratchRegister) {
-      os << "movl -" << std::get<std::shared_ptr<Symbol>>(params[0])->offset
-         << "(%rbp), %" << registers32[firstRegister] << std::endl;
-    } else if (secondRegister == cfg->scratchRegister) {
-      os << "movl -" << std::get<std::shared_ptr<Symbol>>(params[1])->offset
-         << "(%rbp), %" << registers32[secondRegister] << std::endl;
+      continue;
     }
-    os << "cmp %" << registers32[secondRegister] << ", %"
-       << registers32[firstRegister] << std::endl;
-    os << op << " %" << registers8[cfg->scratchRegister] << std::endl;
-    os << "movzbl %" << registers8[cfg->scratchRegister] << ", %"
-       << registers32[destRegister] << std::endl;
+    bool readyWide = wide & registerBit(ready->first);
+    code.emit(moveOfWidth(readyWide), {regOfWidth(ready->first, readyWide),
+                                       regOfWidth(ready->second, readyWide)});
+    moves.erase(ready);
+  }
+}
+
+int CFG::getFirstSlot(BasicBlock *bb) {
+  auto it = splitInfo.firstSlot.find(bb);
+  return it != splitInfo.firstSlot.end() ? it->second : 0;
+}
+
+void CFG::gen_asm_split_stores(MachineCode &code, int slot) {
+  auto it = splitInfo.stores.find(slot);
+  if (it == splitInfo.stores.end()) {
+    return;
+  }
+  for (SymbolId symbol : it->second) {
+    bool wide = isWide(symbol);
+    code.emit(moveOfWidth(wide), {regOfWidth(registerAssignment[symbol], wide),
+                                  stack_slot(symbol)});
   }
+}
 
-  if (destRegister == cfg->scratchRegister) {
-    os << "movl %" << registers32[destRegister] << ", -"
-       << std::get<std::shared_ptr<Symbol>>(params[2])->offset << "(%rbp)";
+bool CFG::gen_asm_edge_moves(MachineCode &code, BasicBlock *from,
+                             BasicBlock *to) {
+  auto it = splitInfo.edgeMoves.find({from, to});
+  if (it == splitInfo.edgeMoves.end()) {
+    return false;
   }
+  for (const SplitMove &move : it->second) {
+    bool wide = isWide(move.symbol);
+    std::string reg = regOfWidth(registerAssignment[move.symbol], wide);
+    if (move.load) {
+      code.emit(moveOfWidth(wide), {stack_slot(move.symbol), reg});
+    } else {
+      code.emit(moveOfWidth(wide), {reg, stack_slot(move.symbol)});
+    }
+  }
+  return true;
 }
 
-int CFG::findRegister(std::shared_ptr<Symbol> &param) {
-  auto paramLocation = registerAssignment.find(param);
-  if (paramLocation != registerAssignment.end()) {
-    return paramLocation->second;
+std::string CFG::branch_target(BasicBlock *from, BasicBlock *to) {
+  if (splitInfo.edgeMoves.count({from, to})) {
+    return edge_stub_label(from, to);
   }
-  return scratchRegister;
+  return to->label;
+}
+
+std::string CFG::edge_stub_label(BasicBlock *from, BasicBlock *to) {
+  std::string label = ".L" + name + "_edge" + std::to_string(edgeStubCount++);
+  edgeStubs.label(label);
+  gen_asm_edge_moves(edgeStubs, from, to);
+  edgeStubs.emit("jmp", {to->label});
+  return label;
 }
 
-void IRInstr::handleUnaryOp(const std::string &op, std::ostream &os, CFG *cfg) {
-  auto symbol = std::get<std::shared_ptr<Symbol>>(params[0]);
-  int varRegister = cfg->findRegister(symbol);
+void IRInstr::handleUnaryOp(const std::string &op, MachineCode &code, CFG *cfg) {
+  SymbolId source = getSymbolParam(0);
 
   if (op == "inc" || op == "dec") {
-    if (varRegister == cfg->scratchRegister) {
-      os << "movl -" << symbol->offset << "(%rbp), %"
-         << registers32[varRegister] << std::endl;
-    }
-    os << op << " %" << registers32[varRegister] << "\n";
-    if (varRegister == cfg->scratchRegister) {
-      os << "movl %" << registers32[varRegister] << ", -" << symbol->offset
-         << "(%rbp)" << std::endl;
+    SymbolId dest = getSymbolParam(1);
+    int destRegister = cfg->findRegister(dest);
+    if (cfg->getSymbol(dest).type == Type::CHAR) {
+      // A char wraps around
+      cfg->gen_asm_load(code, source, destRegister);
+      code.emit(op + "l", {reg32(destRegister)});
+      code.emit("movsbl", {reg8(destRegister), reg32(destRegister)});
+      cfg->gen_asm_store(code, destRegister, dest);
+    } else if (destRegister == cfg->scratchRegister && source == dest) {
+      code.emit(op + "l", {cfg->stack_slot(dest)});
+    } else {
+      cfg->gen_asm_load(code, source, destRegister);
+      code.emit(op + "l", {reg32(destRegister)});
+      cfg->gen_asm_store(code, destRegister, dest);
     }
+    return;
   }
+
+  SymbolId dest = getSymbolParam(1);
+  int destRegister = cfg->findRegister(dest);
   if (op == "neg" || op == "notl") {
-    if (varRegister == cfg->scratchRegister) {
-      os << "movl -" << symbol->offset << "(%rbp), %"
-         << registers32[varRegister] << std::endl;
-    } else {
-      os << "movl %" << registers32[varRegister] << ", %"
-         << registers32[cfg->scratchRegister] << std::endl;
-    }
-    os << op << " %" << registers32[cfg->scratchRegister] << "\n";
-    auto destSymbol = std::get<std::shared_ptr<Symbol>>(params[1]);
-    int destRegister = cfg->findRegister(destSymbol);
-    if (destRegister == cfg->scratchRegister) {
-      os << "movl " << registers32[cfg->scratchRegister] << ", -"
-         << destSymbol->offset << "(%rbp)" << std::endl;
-    } else {
-      os << "movl %" << registers32[cfg->scratchRegister] << ", %"
-         << registers32[destRegister] << std::endl;
-    }
+    cfg->gen_asm_load(code, source, destRegister);
+    code.emit(op, {reg32(destRegister)});
   } else if (op == "lnot") {
-    os << "cmpl $0, %" << registers32[varRegister] << std::endl;
-    int varRegister = cfg->findRegister(symbol);
-    if (varRegister == cfg->scratchRegister) {
-      os << "movl %" << registers32[varRegister] << ", -" << symbol->offset
-         << "(%rbp)"
-         << "\n";
-    }
-    auto destSymbol = std::get<std::shared_ptr<Symbol>>(params[1]);
-    int destRegister = cfg->findRegister(destSymbol);
-    if (destRegister == cfg->scratchRegister) {
-      os << "movl -" << symbol->offset << "(%rbp), %"
-         << registers32[destRegister] << std::endl;
+    code.emit(cfg->isWide(source) ? "cmpq" : "cmpl",
+              {immediate(0), cfg->gen_asm_source(source)});
+    code.emit("sete", {reg8(cfg->scratchRegister)});
+    code.emit("movzbl", {reg8(cfg->scratchRegister), reg32(destRegister)});
+  }
+  cfg->gen_asm_store(code, destRegister, dest);
+}
+
+void IRInstr::handleAddr(MachineCode &code, CFG *cfg) {
+  SymbolId dest = getSymbolParam(1);
+  int destRegister = cfg->findRegister(dest);
+  std::string object;
+  if (auto symbol = std::get_if<SymbolId>(&params[0])) {
+    object = cfg->stack_slot(*symbol);
+  } else {
+    object = assemblyName(std::get<std::string>(params[0])) + "(%rip)";
+  }
+  code.emit("leaq", {object, reg64(destRegister)});
+  cfg->gen_asm_store(code, destRegister, dest);
+}
+
+void IRInstr::handleLea(MachineCode &code, CFG *cfg) {
+  SymbolId dest = getSymbolParam(3);
+  int destRegister = cfg->findRegister(dest);
+  int scale = std::stoi(std::get<std::string>(params[2]));
+  std::string address = elementOperand(code, cfg, scale, cfg->scratchRegister,
+                                       destRegister);
+  code.emit("leaq", {address, reg64(destRegister)});
+  cfg->gen_asm_store(code, destRegister, dest);
+}
+
+void IRInstr::handleLoad(MachineCode &code, CFG *cfg) {
+  SymbolId dest = getSymbolParam(2);
+  int destRegister = cfg->findRegister(dest);
+  std::string source = elementOperand(code, cfg, getSize(outType),
+                                      cfg->scratchRegister, destRegister);
+  if (outType == Type::CHAR) {
+    code.emit("movsbl", {source, reg32(destRegister)});
+  } else {
+    bool wide = outType.isPointer();
+    code.emit(moveOfWidth(wide), {source, regOfWidth(destRegister, wide)});
+  }
+  cfg->gen_asm_store(code, destRegister, dest);
+}
+
+void IRInstr::handleStore(MachineCode &code, CFG *cfg) {
+  SymbolId value = getSymbolParam(2);
+  int valueRegister = cfg->findRegister(value);
+  std::string dest = elementOperand(code, cfg, getSize(outType),
+                                    CFG::addressRegister, CFG::addressRegister);
+  cfg->gen_asm_load(code, value, valueRegister);
+  if (outType == Type::CHAR) {
+    code.emit("movb", {reg8(valueRegister), dest});
+  } else {
+    bool wide = outType.isPointer();
+    code.emit(moveOfWidth(wide), {regOfWidth(valueRegister, wide), dest});
+  }
+}
+
+std::string IRInstr::elementOperand(MachineCode &code, CFG *cfg, int scale,
+                                    int indexRegister, int baseRegister) {
+  long displacement = 0;
+  std::string index;
+  if (auto constant = std::get_if<std::string>(&params[1])) {
+    displacement = std::stol(*constant) * scale;
+  } else {
+    code.emit("movslq", {cfg->gen_asm_source(getSymbolParam(1)),
+                         reg64(indexRegister)});
+    index = "," + reg64(indexRegister) + "," + std::to_string(scale);
+  }
+
+  // A local array is addressed within the frame, a global from rip
+  if (auto global = std::get_if<std::string>(&params[0])) {
+    std::string name = assemblyName(*global);
+    if (displacement > 0) {
+      name += "+";
     }
-    os << "sete %" << registers8[destRegister] << std::endl;
-    os << "movzbl %" << registers8[destRegister] << ", %"
-       << registers32[destRegister] << std::endl;
-    if (destRegister == cfg->scratchRegister) {
-      os << "movl %" << registers32[destRegister] << ", -" << symbol->offset
-         << "(%rbp)" << std::endl;
+    return name + (displacement ? std::to_string(displacement) : "") +
+           "(%rip)";
+  }
+  SymbolId base = getSymbolParam(0);
+  if (getObject() != invalidSymbol) {
+    return cfg->frame_slot(cfg->getSymbol(base).offset - displacement, index);
+  }
+
+  std::string prefix = displacement ? std::to_string(displacement) : "";
+  int pointerRegister = cfg->findRegister(base);
+  if (pointerRegister == cfg->scratchRegister) {
+    if (!index.empty() && baseRegister == indexRegister) {
+      int shift = exactLog2(scale);
+      if (shift > 0) {
+        code.emit("salq", {immediate(shift), reg64(indexRegister)});
+      }
+      code.emit("addq", {cfg->stack_slot(base), reg64(indexRegister)});
+      return prefix + "(" + reg64(indexRegister) + ")";
     }
+    code.emit("movq", {cfg->stack_slot(base), reg64(baseRegister)});
+    pointerRegister = baseRegister;
   }
+  return prefix + "(" + reg64(pointerRegister) + index + ")";
 }
 
-void IRInstr::handleCall(std::ostream &os, CFG *cfg) {
+void IRInstr::handleCall(MachineCode &code, CFG *cfg) {
   std::string funcName = std::get<std::string>(params[0]);
   CFG *function = cfg->get_visitor()->getFunction(funcName);
   int paramNum = function->get_parameters_type().size();
 
-  int val = (cfg->nextFreeSymbolIndex + 16 - 1) / 16 * 16;
-  if (val) {
-    os << "subq $" << val << ", %rsp" << std::endl;
+  // Only the caller-saved registers holding a value still needed after the
+  // call are saved, in their frame slots
+  std::vector<std::pair<int, bool>> saved; /**< register, wide */
+  auto live = cfg->liveAcrossCall.find(this);
+  if (live != cfg->liveAcrossCall.end()) {
+    for (SymbolId symbol : live->second) {
+      int reg = cfg->findRegister(symbol);
+      bool wide = cfg->isWide(symbol);
+      if (reg != cfg->scratchRegister &&
+          (callerSavedRegisters & registerBit(reg))) {
+        code.emit(moveOfWidth(wide), {regOfWidth(reg, wide),
+                                      cfg->frame_slot(cfg->getSaveSlot(reg))});
+        saved.emplace_back(reg, wide);
+      }
+    }
+  }
+
+  // The arguments passed on the stack are padded to keep rsp 16-byte aligned
+  int stackArguments = std::max(0, paramNum - 6);
+  int stackSize = 8 * (stackArguments + stackArguments % 2);
+  if (stackArguments % 2) {
+    code.emit("subq", {immediate(8), "%rsp"});
+    cfg->adjustStackPointer(8);
   }
-  for (int i = 0; i < 8; i++) {
-    os << "pushq %" << registers64[i] << std::endl;
+  for (int i = paramNum - 1; i >= 6; i--) {
+    cfg->gen_asm_load(code, getSymbolParam(i + 1), cfg->scratchRegister);
+    code.emit("pushq", {reg64(cfg->scratchRegister)});
+    cfg->adjustStackPointer(8);
   }
 
-  bool exchange = false;
-  if (paramNum >= 6) {
-    auto symbol8 = std::get<std::shared_ptr<Symbol>>(params[5]);
-    auto symbol9 = std::get<std::shared_ptr<Symbol>>(params[6]);
-    if (cfg->findRegister(symbol8) == 1 && cfg->findRegister(symbol9) == 0) {
-      os << "xchg %r8d, %r9d" << std::endl;
-      exchange = true;
+  // The arguments in registers are moved all at once, then the ones in
+  // memory are loaded
+  std::vector<std::pair<int, int>> moves;
+  RegisterSet wide = 0;
+  for (int i = 0; i < std::min(paramNum, 6); i++) {
+    int reg = cfg->findRegister(getSymbolParam(i + 1));
+    if (reg != cfg->scratchRegister) {
+      moves.emplace_back(reg, argumentRegisters[i]);
+      if (cfg->isWide(getSymbolParam(i + 1))) {
+        wide |= registerBit(reg);
+      }
     }
   }
-  for (int i = paramNum - 1; i >= 0; i--) {
-    if ((i == 4 || i == 5) && exchange) {
-      continue;
-    }
-    auto symbol = std::get<std::shared_ptr<Symbol>>(params[i + 1]);
-    int paramRegister = cfg->findRegister(symbol);
-    if (paramRegister == cfg->scratchRegister) {
-      os << "movl -" << symbol->offset << "(%rbp), %"
-         << registers32[paramRegister] << std::endl;
-    }
-    if (i < 6) {
-      os << "movl %" << registers32[paramRegister] << ", %" << paramRegisters[i]
-         << std::endl;
-    } else {
-      os << "pushq %" << registers64[paramRegister] << std::endl;
+  cfg->gen_asm_parallel_move(code, moves, wide);
+  for (int i = 0; i < std::min(paramNum, 6); i++) {
+    if (cfg->findRegister(getSymbolParam(i + 1)) == cfg->scratchRegister) {
+      cfg->gen_asm_load(code, getSymbolParam(i + 1), argumentRegisters[i]);
     }
   }
 
-  auto returnVar = std::get<std::shared_ptr<Symbol>>(*params.rbegin());
-
-  os << "call " << funcName << std::endl;
-  int paramRegister = cfg->findRegister(returnVar);
-
-  for (int i = 0; i < 8; i++) {
-    os << "popq %" << registers64[7 - i] << std::endl;
+  if (op == tailcall) {
+    // The callee returns straight to the caller of the function
+    cfg->gen_asm_frame_exit(code);
+    code.emit("jmp", {funcName});
+    return;
   }
+  code.emit("call", {funcName});
 
-  for (int i = 7; i <= paramNum; i++) {
-    os << "popq %" << registers64[cfg->scratchRegister] << std::endl;
-  }
-  if (val) {
-    os << "addq $" << val << ", %rsp" << std::endl;
+  if (stackSize) {
+    code.emit("addq", {immediate(stackSize), "%rsp"});
+    cfg->adjustStackPointer(-stackSize);
   }
-
   if (outType != Type::VOID) {
-    os << "movl %eax, %" << registers32[paramRegister] << std::endl;
-    os << "movl %" << registers32[paramRegister] << ", -" << returnVar->offset
-       << "(%rbp)" << std::endl;
+    cfg->gen_asm_store(code, RAX, getSymbolParam(params.size() - 1));
   }
-
-  if (outType != Type::VOID && paramRegister != cfg->scratchRegister) {
-    os << "movl -" << returnVar->offset << "(%rbp)"
-       << ", %" << registers32[paramRegister] << std::endl;
+  for (auto [reg, wide] : saved) {
+    code.emit(moveOfWidth(wide), {cfg->frame_slot(cfg->getSaveSlot(reg)),
+                                  regOfWidth(reg, wide)});
   }
 }
 
-void IRInstr::handleParam(std::ostream &os, CFG *cfg) {
-  cfg->push_parameter(std::get<std::shared_ptr<Symbol>>(params[0]));
+void IRInstr::handleParam(MachineCode &code, CFG *cfg) {
+  cfg->push_parameter(getSymbolParam(0));
 }
 
 BasicBlock::BasicBlock(CFG *cfg, std::string entry_label)
     : cfg(cfg), label(std::move(entry_label)), exit_true(nullptr),
-      exit_false(nullptr), visited(false) {}
+      exit_false(nullptr), falseCondition("e") {}
 
-void BasicBlock::gen_asm(std::ostream &o) {
-  if (visited) {
-    return;
-  }
-  visited = true;
+void BasicBlock::gen_asm(MachineCode &code, BasicBlock *next) {
   if (!label.empty()) {
-    std::cout << label << ":\n";
+    code.label(label);
   }
+  int slot = cfg->getFirstSlot(this);
   for (auto &instruction : instrs) {
-    instruction.genAsm(o, cfg);
+    cfg->setCurrentSlot(slot);
+    cfg->gen_asm_split_stores(code, slot);
+    instruction.genAsm(code, cfg);
+    slot++;
   }
-  if (exit_false != nullptr) {
-    o << "je " << exit_false->label << "\n";
-  }
-  if (exit_true != nullptr && !exit_true->label.empty()) {
-    o << "jmp " << exit_true->label << "\n";
+  cfg->setCurrentSlot(slot);
+  cfg->gen_asm_split_stores(code, slot);
+  if (exit_true == nullptr) {
+    return;
   }
-  if (exit_true != nullptr) {
-    exit_true->gen_asm(o);
+  if (exit_false != nullptr && exit_false != exit_true) {
+    if (exit_false == next) {
+      // The condition is inverted, so that the false edge falls through
+      code.emit("j" + invertedCondition(falseCondition),
+                {cfg->branch_target(this, exit_true)});
+      cfg->gen_asm_edge_moves(code, this, exit_false);
+      return;
+    }
+    code.emit("j" + falseCondition, {cfg->branch_target(this, exit_false)});
   }
-  if (exit_false != nullptr) {
-    exit_false->gen_asm(o);
+  cfg->gen_asm_edge_moves(code, this, exit_true);
+  if (exit_true != next) {
+    code.emit("jmp", {exit_true->label});
   }
 }
 
-std::shared_ptr<Symbol> BasicBlock::add_IRInstr(IRInstr::Operation op, Type t,
-                                                std::vector<Parameter> params) {
+SymbolId BasicBlock::add_IRInstr(IRInstr::Operation op, Type t,
+                                 std::vector<Parameter> params) {
   switch (op) {
   case IRInstr::add:
   case IRInstr::sub:
@@ -732,8 +1172,11 @@ std::shared_ptr<Symbol> BasicBlock::add_IRInstr(IRInstr::Operation op, Type t,
   case IRInstr::neg:
   case IRInstr::not_:
   case IRInstr::ldconst:
-  case IRInstr::lnot: {
-    std::shared_ptr<Symbol> symbol = cfg->create_new_tempvar(t);
+  case IRInstr::lnot:
+  case IRInstr::addr:
+  case IRInstr::lea:
+  case IRInstr::load: {
+    SymbolId symbol = cfg->create_new_tempvar(t);
     params.push_back(symbol);
     instrs.emplace_back(this, op, t, params);
     return symbol;
@@ -741,7 +1184,7 @@ std::shared_ptr<Symbol> BasicBlock::add_IRInstr(IRInstr::Operation op, Type t,
   }
   case IRInstr::call: {
     if (t != Type::VOID) {
-      std::shared_ptr<Symbol> symbol = cfg->create_new_tempvar(t);
+      SymbolId symbol = cfg->create_new_tempvar(t);
       params.push_back(symbol);
       instrs.emplace_back(this, op, t, params);
       return symbol;
@@ -752,33 +1195,60 @@ std::shared_ptr<Symbol> BasicBlock::add_IRInstr(IRInstr::Operation op, Type t,
   }
   case IRInstr::ret:
   case IRInstr::param:
-  case IRInstr::var_assign: {
+  case IRInstr::var_assign:
+  case IRInstr::store: {
     instrs.emplace_back(this, op, t, params);
     break;
   }
   case IRInstr::inc:
   case IRInstr::dec:
+    // The variable is updated in place, until SSA renames the result
+    params.push_back(params[0]);
     instrs.emplace_back(this, op, t, params);
-    return std::get<std::shared_ptr<Symbol>>(params[0]);
+    return std::get<SymbolId>(params[0]);
     break;
 
   case IRInstr::param_decl:
     instrs.emplace_back(this, op, t, params);
-    return std::get<std::shared_ptr<Symbol>>(params[0]);
+    return std::get<SymbolId>(params[0]);
   case IRInstr::ldvar:
-    return std::get<std::shared_ptr<Symbol>>(params[0]);
+    return std::get<SymbolId>(params[0]);
+    break;
+  // Made by the passes, with their destination if any: added as they are
+  case IRInstr::cmp:
+  case IRInstr::phi:
+  case IRInstr::mulconst:
+  case IRInstr::divconst:
+  case IRInstr::modconst:
+  case IRInstr::tailcall:
+    instrs.emplace_back(this, op, t, params);
     break;
   case IRInstr::nothing:
     break;
   }
 
-  return nullptr;
+  return invalidSymbol;
 }
 
-CFG::CFG(Type type, const std::string &name, int argCount,
-         CodeGenVisitor *visitor)
-    : nextFreeSymbolIndex(1 + 4 * std::max(0, argCount - 6)), name(name),
-      returnType(type), visitor(visitor) {
+void BasicBlock::eraseParams(const std::vector<SymbolId> &arguments,
+                             size_t end) {
+  for (auto argument = arguments.rbegin(); argument != arguments.rend();
+       argument++) {
+    for (size_t i = end; i-- > 0;) {
+      if (instrs[i].getOperation() == IRInstr::param &&
+          instrs[i].getSymbolParam(0) == *argument) {
+        instrs.erase(instrs.begin() + i);
+        end = i;
+        break;
+      }
+    }
+  }
+}
+
+CFG::CFG(Type type, const std::string &name, CodeGenVisitor *visitor)
+    : nextBBnumber(0), name(name), returnType(type), framePointer(true),
+      frameSize(0), stackAdjustment(0), saveSlot(registerCount, 0),
+      currentSlot(0), edgeStubCount(0), visitor(visitor) {
   add_bb(new BasicBlock(this, ""));
   push_table();
 }
@@ -797,101 +1267,280 @@ void CFG::add_bb(BasicBlock *bb) {
   current_bb = bb;
 }
 
+std::string CFG::new_BB_name() {
+  return ".L" + name + "_bb" + std::to_string(nextBBnumber++);
+}
+
 std::string CFG::IR_reg_to_asm(std::string reg) {
   // TODO
   return "";
 }
 
-void CFG::gen_asm_prologue(std::ostream &o) {
+void CFG::gen_asm_prologue(MachineCode &code) {
 #ifdef __APPLE__
-  o << ".globl _" << name << "\n";
-  o << "_" << name << " : \n";
+  code.directive(".globl _" + name);
+  code.label("_" + name);
 #else
-  o << ".globl " << name << "\n";
-  o << name << " : \n";
+  code.directive(".globl " + name);
+  code.label(name);
 #endif
-  o << "pushq %rbp\n";
-  o << "movq %rsp, %rbp\n";
-
-  bool isSwapped = false;
-  if (parameterTypes.size() >= 6) {
-    int parameterRegister1 = findRegister(parameterTypes[4].symbol);
-    int parameterRegister2 = findRegister(parameterTypes[4].symbol);
-    if (parameterRegister1 == 5 && parameterRegister2 == 4) {
-      o << "xchg %r8d, %r9d" << std::endl;
-    }
+  if (framePointer) {
+    code.emit("pushq", {"%rbp"});
+    code.emit("movq", {"%rsp", "%rbp"});
+  }
+  if (frameSize) {
+    code.emit("subq", {immediate(frameSize), "%rsp"});
+  }
+  for (int reg : calleeSavedUsed) {
+    code.emit("movq", {reg64(reg), frame_slot(saveSlot[reg])});
   }
 
-  for (int i = 4; !isSwapped && i < std::min((int)parameterTypes.size(), 6);
-       i++) {
-    auto parameter = parameterTypes[i];
-    int parameterRegister = findRegister(parameter.symbol);
-    o << "movl %" << paramRegisters[i] << ", %"
-      << registers32[parameterRegister] << std::endl;
-    if (parameterRegister == scratchRegister) {
-      o << "movl %" << registers32[parameterRegister] << ", -"
-        << parameter.symbol->offset << "(%rbp)" << std::endl;
+  // The parameters received in registers are stored to their stack slot or
+  // moved all at once to their own register, then the ones passed on the
+  // stack are loaded. A parameter that is never read may share its register
+  // with another one, and is left where it is.
+  std::vector<bool> read(symbols.size(), false);
+  for (BasicBlock *bb : bbs) {
+    for (const IRInstr &instr : bb->instrs) {
+      for (SymbolId symbol : instr.getUsedVariables()) {
+        read[symbol] = true;
+      }
     }
   }
-  for (int i = 0; i < parameterTypes.size(); i++) {
-    if (i == 4 || i == 5) {
+  int parameterCount = parameterTypes.size();
+  std::vector<std::pair<int, int>> moves;
+  RegisterSet wide = 0;
+  for (int i = 0; i < std::min(parameterCount, 6); i++) {
+    int reg = findRegister(parameterTypes[i].symbol);
+    if (!read[parameterTypes[i].symbol]) {
       continue;
-    }
-    auto parameter = parameterTypes[i];
-    int parameterRegister = findRegister(parameter.symbol);
-    if (i < 6) {
-      o << "movl %" << paramRegisters[i] << ", %"
-        << registers32[parameterRegister] << std::endl;
+    } else if (reg == scratchRegister) {
+      gen_asm_store(code, argumentRegisters[i], parameterTypes[i].symbol);
     } else {
-      o << "movl " << 8 * (i - 4) << "(%rbp)"
-        << ", %" << registers32[parameterRegister] << std::endl;
+      moves.emplace_back(argumentRegisters[i], reg);
+      if (isWide(parameterTypes[i].symbol)) {
+        wide |= registerBit(argumentRegisters[i]);
+      }
     }
-    if (parameterRegister == scratchRegister) {
-      o << "movl %" << registers32[parameterRegister] << ", -"
-        << parameter.symbol->offset << "(%rbp)" << std::endl;
+  }
+  gen_asm_parallel_move(code, moves, wide);
+  for (int i = 6; i < parameterCount; i++) {
+    int reg = findRegister(parameterTypes[i].symbol);
+    bool wideParameter = isWide(parameterTypes[i].symbol);
+    if (!read[parameterTypes[i].symbol]) {
+      continue;
     }
+    code.emit(moveOfWidth(wideParameter),
+              {frame_slot(-8 * (i - 4)), regOfWidth(reg, wideParameter)});
+    gen_asm_store(code, reg, parameterTypes[i].symbol);
   }
 }
 
 void CFG::gen_asm(std::ostream &o) {
+  optimize();
+  fuseCompareBranches();
+  int tailCalls = selectTailCalls();
+  Statistics::add("tail calls: sibling calls", tailCalls);
   computeRegisterAllocation();
-  gen_asm_prologue(o);
-  bbs[0]->gen_asm(o);
-  gen_asm_epilogue(o);
+  computeFrameLayout();
+  currentSlot = 0;
+  stackAdjustment = 0;
+  std::vector<BasicBlock *> order;
+  {
+    TimeReport::Scope timer("block layout");
+    order = BlockLayout(this).run();
+  }
+  int fallThroughs = 0;
+  for (size_t i = 0; i < order.size(); i++) {
+    BasicBlock *bb = order[i];
+    // Any block may now be jumped to
+    if (bb->label.empty()) {
+      bb->label = new_BB_name();
+    }
+    if (i + 1 < order.size() && (bb->exit_true == order[i + 1] ||
+                                 bb->exit_false == order[i + 1])) {
+      fallThroughs++;
+    }
+  }
+  Statistics::add("block layout: fall-through edges", fallThroughs);
+
+  MachineCode code;
+  gen_asm_prologue(code);
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i]->gen_asm(code, i + 1 < order.size() ? order[i + 1] : nullptr);
+  }
+  code.append(edgeStubs);
+  if (Options::peephole()) {
+    TimeReport::Scope timer("peephole");
+    Statistics::add("peephole: instructions rewritten", Peephole(&code).run());
+  }
+  code.print(o);
 }
 
-void CFG::gen_asm_epilogue(std::ostream &o) {
-  // TODO
+void CFG::gen_asm_epilogue(MachineCode &code) {
+  gen_asm_frame_exit(code);
+  code.emit("ret");
+}
+
+void CFG::gen_asm_frame_exit(MachineCode &code) {
+  for (int reg : calleeSavedUsed) {
+    code.emit("movq", {frame_slot(saveSlot[reg]), reg64(reg)});
+  }
+  if (framePointer) {
+    code.emit("leave");
+  } else if (frameSize) {
+    code.emit("addq", {immediate(frameSize), "%rsp"});
+  }
+}
+
+void CFG::computeFrameLayout() {
+  std::vector<bool> referenced(symbols.size(), false);
+  bool leaf = true;
+  for (BasicBlock *bb : bbs) {
+    for (const IRInstr &instr : bb->instrs) {
+      for (SymbolId symbol : instr.getUsedVariables()) {
+        referenced[symbol] = true;
+      }
+      for (SymbolId symbol : instr.getDeclaredVariable()) {
+        referenced[symbol] = true;
+      }
+      if (instr.getObject() != invalidSymbol) {
+        referenced[instr.getObject()] = true;
+      }
+      if (instr.getOperation() == IRInstr::call) {
+        leaf = false;
+      }
+    }
+  }
+
+  std::vector<bool> used(registerCount, false);
+  std::vector<bool> savedAtCalls(registerCount, false);
+  wideSave.assign(registerCount, false);
+  for (SymbolId symbol = 0; symbol < symbols.size(); symbol++) {
+    if (referenced[symbol] && registerAssignment[symbol] >= 0) {
+      used[registerAssignment[symbol]] = true;
+    }
+  }
+  for (auto &call : liveAcrossCall) {
+    for (SymbolId symbol : call.second) {
+      int reg = registerAssignment[symbol];
+      if (reg >= 0 && (callerSavedRegisters & registerBit(reg))) {
+        savedAtCalls[reg] = true;
+        wideSave[reg] = wideSave[reg] || isWide(symbol);
+      }
+    }
+  }
+
+  // Only the symbols living in memory at some point get a stack slot: the
+  // spilled ones, the ones split by the linear scan, and the local arrays
+  std::vector<bool> inMemory(symbols.size(), false);
+  for (SymbolId symbol = 0; symbol < symbols.size(); symbol++) {
+    bool split = !splitInfo.splitSlot.empty() &&
+                 splitInfo.splitSlot[symbol] != INT_MAX;
+    inMemory[symbol] =
+        referenced[symbol] && (registerAssignment[symbol] < 0 || split);
+  }
+  int offset;
+  {
+    TimeReport::Scope timer("stack slot coloring");
+    StackSlotColoring coloring(this, inMemory);
+    Statistics::add("stack slot coloring: slots shared", coloring.run());
+    offset = coloring.getAreaSize();
+  }
+
+  // The save slots go below the stack slots of the symbols
+  offset = (offset + 7) / 8 * 8;
+  calleeSavedUsed.clear();
+  saveSlot.assign(registerCount, 0);
+  for (int reg = 0; reg < allocatableRegisterCount(); reg++) {
+    if (used[reg] && (calleeSavedRegisters & registerBit(reg))) {
+      offset += 8;
+      saveSlot[reg] = offset;
+      calleeSavedUsed.push_back(reg);
+    }
+  }
+  for (int reg = 0; reg < allocatableRegisterCount(); reg++) {
+    if (savedAtCalls[reg]) {
+      int size = wideSave[reg] ? 8 : 4;
+      offset = (offset + size + size - 1) / size * size;
+      saveSlot[reg] = offset;
+    }
+  }
+
+  // The deepest slot is 8 + offset bytes below the return address. Without a
+  // frame pointer, rsp stays 16-byte aligned at the calls.
+  const int redZoneSize = 128;
+  if (leaf && offset + 8 <= redZoneSize) {
+    framePointer = false;
+    frameSize = 0;
+  } else if (Options::omitFramePointer()) {
+    framePointer = false;
+    frameSize = (offset + 15) / 16 * 16 + 8;
+  } else {
+    framePointer = true;
+    frameSize = (offset + 15) / 16 * 16;
+  }
+}
+
+int CFG::allocatableRegisterCount() {
+  return Options::omitFramePointer() ? R11 : RBP;
 }
 
 void CFG::pop_table() {
   for (auto it = symbolTables.front().begin(); it != symbolTables.front().end();
        it++) {
-    if (!it->second->used) {
+    const Symbol &symbol = symbols[it->second];
+    if (!symbol.used) {
       VisitorErrorListener::addError("Variable " + it->first +
                                          " not used (declared in line " +
-                                         std::to_string(it->second->line) + ")",
+                                         std::to_string(symbol.line) + ")",
                                      ErrorType::Warning);
     }
   }
   symbolTables.pop_front();
 }
 
+SymbolId CFG::new_symbol(Type t, const std::string &lexeme, int line) {
+  SymbolId id = symbols.size();
+  // Its stack slot, if it needs one, is placed by computeFrameLayout
+  symbols.emplace_back(t, lexeme, line);
+  return id;
+}
+
 bool CFG::add_symbol(std::string id, Type t, int line) {
   if (symbolTables.front().count(id)) {
     return false;
   }
-  std::shared_ptr<Symbol> newSymbol = std::make_shared<Symbol>(t, id, line);
-  unsigned int sz = getSize(t);
-  // This expression handles stack alignment
-  newSymbol->offset = (nextFreeSymbolIndex + 2 * (sz - 1)) / sz * sz;
-  nextFreeSymbolIndex += sz;
-  symbolTables.front()[id] = newSymbol;
+  symbolTables.front()[id] = new_symbol(t, id, line);
 
   return true;
 }
 
-std::shared_ptr<Symbol> CFG::get_symbol(const std::string &name) {
+bool CFG::isCopy(const IRInstr &instr) const {
+  if (instr.getOperation() != IRInstr::var_assign) {
+    return false;
+  }
+  SymbolId dest = instr.getSymbolParam(0);
+  SymbolId source = instr.getSymbolParam(1);
+  return isWide(dest) == isWide(source) &&
+         (symbols[dest].type != Type::CHAR ||
+          symbols[source].type == Type::CHAR);
+}
+
+bool CFG::addressesFrame() const {
+  for (BasicBlock *bb : bbs) {
+    for (const IRInstr &instr : bb->instrs) {
+      IRInstr::Operation op = instr.getOperation();
+      if ((op == IRInstr::addr || op == IRInstr::lea) &&
+          instr.getObject() != invalidSymbol) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+SymbolId CFG::get_symbol(const std::string &name) {
   auto it = symbolTables.begin();
   while (it != symbolTables.end()) {
     auto symbol = it->find(name);
@@ -900,29 +1549,33 @@ std::shared_ptr<Symbol> CFG::get_symbol(const std::string &name) {
     }
     it++;
   }
-  return nullptr;
+  return invalidSymbol;
 }
 
-std::shared_ptr<Symbol> CFG::create_new_tempvar(Type t) {
-  unsigned int sz = getSize(t);
-  unsigned int offset = (nextFreeSymbolIndex + 2 * (sz - 1)) / sz * sz;
-  std::string tempVarName = "!T" + std::to_string(offset);
-  if (add_symbol(tempVarName, t, 0)) {
-    std::shared_ptr<Symbol> symbol = get_symbol(tempVarName);
-    symbol->used = true;
-    return symbol;
-  }
-  return nullptr;
+SymbolId CFG::create_new_tempvar(Type t) {
+  // Temporaries are not visible from the source, so they are not added to
+  // the scoped tables
+  SymbolId symbol = new_symbol(t, "", 0);
+  symbols[symbol].lexeme = "!T" + std::to_string(symbol);
+  symbols[symbol].used = true;
+  return symbol;
+}
+
+SymbolId CFG::new_version(SymbolId symbol) {
+  SymbolId version = new_symbol(symbols[symbol].type, "", symbols[symbol].line);
+  symbols[version].lexeme =
+      symbols[symbol].lexeme + "." + std::to_string(version);
+  symbols[version].used = true;
+  return version;
 }
 
-std::shared_ptr<Symbol> CFG::add_parameter(const std::string &name, Type type,
-                                           int line) {
+SymbolId CFG::add_parameter(const std::string &name, Type type, int line) {
   bool new_symbol = add_symbol(name, type, line);
   if (!new_symbol) {
     VisitorErrorListener::addError(
         "A parameter with name " + name + " has already been declared", line);
   }
-  auto symbol = get_symbol(name);
+  SymbolId symbol = get_symbol(name);
   parameterTypes.emplace_back(type, symbol);
   return symbol;
 }
@@ -936,159 +1589,139 @@ Type CFG::get_var_type(std::string name) {
   return Type::INT;
 }
 
-LivenessInfo CFG::computeLiveInfo() {
-  LivenessInfo liveInfo;
-  bool stable = false;
-  while (!stable) {
-    stable = true;
-    std::set<BasicBlock *> visitedBB;
-    std::stack<BasicBlock *> visitOrder;
-    visitOrder.push(bbs[0]);
-    while (!visitOrder.empty()) {
-      BasicBlock *currentBB = visitOrder.top();
-      visitOrder.pop();
-      visitedBB.insert(currentBB);
-      int instructionIndex = 0;
-      for (auto &instr : currentBB->instrs) {
-        std::set<std::shared_ptr<Symbol>> oldIn;
-        std::set<std::shared_ptr<Symbol>> oldOut;
-        auto inPtr = liveInfo.liveIn.find(&instr);
-        auto outPtr = liveInfo.liveOut.find(&instr);
-        if (inPtr != liveInfo.liveIn.end()) {
-          oldIn = inPtr->second;
-        }
-        if (outPtr != liveInfo.liveOut.end()) {
-          oldOut = outPtr->second;
-        }
-        std::set<std::shared_ptr<Symbol>> inUnion = oldOut;
-        liveInfo.liveIn[&instr] = instr.getUsedVariables();
-        for (auto &toRemove : instr.getDeclaredVariable()) {
-          inUnion.erase(toRemove);
-        }
-        for (auto &toAdd : inUnion) {
-          liveInfo.liveIn[&instr].insert(toAdd);
-        }
-        liveInfo.liveOut[&instr].clear();
-        std::vector<IRInstr *> nextInstrs;
-        if (instructionIndex + 1 < currentBB->instrs.size()) {
-          nextInstrs.push_back(&currentBB->instrs[instructionIndex + 1]);
-        } else {
-          // Perform a bfs on the next possible instruction
-          std::set<BasicBlock *> bfsBB;
-          std::queue<BasicBlock *> visitOrder;
-          if (currentBB->exit_true != nullptr) {
-            visitOrder.push(currentBB->exit_true);
-          }
-          if (currentBB->exit_false != nullptr) {
-            visitOrder.push(currentBB->exit_false);
-          }
-          while (!visitOrder.empty()) {
-            BasicBlock *currentVisitedBB = visitOrder.front();
-            visitOrder.pop();
-            bfsBB.insert(currentVisitedBB);
-            if (currentVisitedBB->instrs.size() > 0) {
-              nextInstrs.push_back(&currentVisitedBB->instrs[0]);
-            } else {
-              if (currentVisitedBB->exit_true != nullptr) {
-                visitOrder.push(currentVisitedBB->exit_true);
-              }
-              if (currentVisitedBB->exit_false != nullptr) {
-                visitOrder.push(currentVisitedBB->exit_false);
-              }
-            }
-          }
-        }
-        for (auto &nextInstruction : nextInstrs) {
-          for (auto var : liveInfo.liveIn[nextInstruction]) {
-            liveInfo.liveOut[&instr].insert(var);
-          }
-        }
-        if (stable && (liveInfo.liveIn[&instr] != oldIn ||
-                       liveInfo.liveOut[&instr] != oldOut)) {
-          stable = false;
-        }
-        instructionIndex++;
+void CFG::computeRegisterConstraints(const Liveness &liveness) {
+  liveAcrossCall.clear();
+  crossesCall.assign(getSymbolCount(), false);
+  forbiddenRegisters.assign(getSymbolCount(), 0);
+  liveness.forEachInstruction([&](IRInstr &instr, const BitVector &live) {
+    IRInstr::Operation op = instr.getOperation();
+    if (op == IRInstr::store) {
+      for (SymbolId symbol : instr.getUsedVariables()) {
+        forbiddenRegisters[symbol] |= registerBit(addressRegister);
       }
-      if (currentBB->exit_true != nullptr &&
-          visitedBB.find(currentBB->exit_true) == visitedBB.end()) {
-        visitOrder.push(currentBB->exit_true);
+      live.forEach([&](size_t symbol) {
+        forbiddenRegisters[symbol] |= registerBit(addressRegister);
+      });
+      return;
+    }
+    if (op != IRInstr::call && op != IRInstr::div && op != IRInstr::mod) {
+      return;
+    }
+    // The result of the instruction is written once it is done
+    std::vector<SymbolId> result = instr.getDeclaredVariable();
+    live.forEach([&](size_t symbol) {
+      if (std::find(result.begin(), result.end(), symbol) != result.end()) {
+        return;
       }
-      if (currentBB->exit_false != nullptr &&
-          visitedBB.find(currentBB->exit_false) == visitedBB.end()) {
-        visitOrder.push(currentBB->exit_false);
+      if (op == IRInstr::call) {
+        liveAcrossCall[&instr].push_back(symbol);
+        crossesCall[symbol] = true;
+      } else {
+        forbiddenRegisters[symbol] |= divisionRegisters;
       }
-    }
-  }
-  return liveInfo;
+    });
+  });
+}
+
+const std::vector<int> &CFG::registerPreference(SymbolId symbol) const {
+  // eax and edx come last among the caller-saved registers, since divisions
+  // and returns need them
+  static const std::vector<int> callerSavedFirst = {
+      R8, R9, R10, RSI, RDI, RCX, RDX, RAX, RBX, R12, R13, R14, R15, RBP};
+  static const std::vector<int> calleeSavedFirst = {
+      RBX, R12, R13, R14, R15, RBP, R8, R9, R10, RSI, RDI, RCX, RDX, RAX};
+  return crossesCall[symbol] ? calleeSavedFirst : callerSavedFirst;
+}
+
+Liveness CFG::computeLiveInfo() {
+  TimeReport::Scope timer("liveness");
+  return Liveness(this);
 }
 
-int computeNeighbors(std::vector<std::shared_ptr<Symbol>> &neighbors,
-                     std::set<std::shared_ptr<Symbol>> &usedNodes) {
-  int neighborCount = 0;
-  for (auto x : neighbors) {
-    if (std::find(usedNodes.begin(), usedNodes.end(), x) == usedNodes.end()) {
-      neighborCount++;
+std::vector<double> CFG::computeSpillCosts(const Liveness &liveness) {
+  TimeReport::Scope timer("register coloring");
+  LoopInfo loops(liveness.getReversePostOrder());
+  std::vector<double> cost(getSymbolCount(), 0);
+  for (BasicBlock *bb : liveness.getReversePostOrder()) {
+    double weight = 1;
+    for (int d = std::min(loops.depth(bb), 8); d > 0; d--) {
+      weight *= 10;
+    }
+    for (auto &instr : bb->instrs) {
+      for (SymbolId symbol : instr.getUsedVariables()) {
+        cost[symbol] += weight;
+      }
+      for (SymbolId symbol : instr.getDeclaredVariable()) {
+        cost[symbol] += weight;
+      }
     }
   }
-  return neighborCount;
+  return cost;
 }
 
-spillInformation CFG::findColorOrder(
-    std::map<std::shared_ptr<Symbol>, std::vector<std::shared_ptr<Symbol>>>
-        &interferenceGraph,
-    int registerCount) {
-  int n = interferenceGraph.size();
+spillInformation CFG::findColorOrder(InterferenceGraph &interferenceGraph,
+                                     const std::vector<double> &spillCost,
+                                     int registerCount) {
+  TimeReport::Scope timer("register coloring");
   spillInformation spillInfo;
-  std::set<std::shared_ptr<Symbol>> usedNodes;
-  int unselectedNodes = 0;
-  while (unselectedNodes < n) {
-    bool foundNode = false;
-    for (auto node = interferenceGraph.begin(); node != interferenceGraph.end();
-         node++) {
-      if (usedNodes.find(node->first) == usedNodes.end() &&
-          computeNeighbors(node->second, usedNodes) < registerCount) {
-        spillInfo.colorOrder.push(node->first);
-        usedNodes.insert(node->first);
-        foundNode = true;
-        break;
-      }
-    }
-    if (!foundNode) {
-      // Just spill the first variable
-      for (auto node = interferenceGraph.begin();
-           node != interferenceGraph.end(); node++) {
-        if (std::find(usedNodes.begin(), usedNodes.end(), node->first) ==
-            usedNodes.end()) {
-          usedNodes.insert(node->first);
-          spillInfo.spilledVariables.insert(node->first);
-          break;
-        }
-      }
+  DegreeBuckets buckets(interferenceGraph, spillCost);
+  while (!buckets.empty()) {
+    SymbolId node = buckets.findNodeBelow(registerCount);
+    if (node != invalidSymbol) {
+      spillInfo.colorOrder.push(node);
+    } else {
+      // Every node left has a significant degree: the candidate is the one
+      // whose memory accesses cost the least per interference removed. It is
+      // colored optimistically, and only spilled if its neighbors end up
+      // using every register.
+      node = buckets.cheapestRemaining();
+      spillInfo.spilledVariables.push_back(node);
+      spillInfo.colorOrder.push(node);
     }
-    unselectedNodes++;
+    buckets.remove(node);
   }
   return spillInfo;
 }
 
-std::map<std::shared_ptr<Symbol>, int> CFG::assignRegisters(
-    spillInformation &spillInfo,
-    std::map<std::shared_ptr<Symbol>, std::vector<std::shared_ptr<Symbol>>>
-        &interferenceGraph,
-    int registerCount) {
-  int n = interferenceGraph.size();
-  std::map<std::shared_ptr<Symbol>, int> color;
+std::vector<int> CFG::assignRegisters(spillInformation &spillInfo,
+                                      InterferenceGraph &interferenceGraph,
+                                      const std::vector<RegisterMove> &moves,
+                                      int registerCount) {
+  TimeReport::Scope timer("register coloring");
+  std::vector<std::vector<SymbolId>> partners(
+      interferenceGraph.getSymbolCount());
+  for (const RegisterMove &move : moves) {
+    partners[move.a].push_back(move.b);
+    partners[move.b].push_back(move.a);
+  }
+
+  std::vector<int> color(interferenceGraph.getSymbolCount(), -1);
+  std::vector<bool> colorUsed(registerCount);
   while (!spillInfo.colorOrder.empty()) {
-    auto currentNode = spillInfo.colorOrder.top();
+    SymbolId currentNode = spillInfo.colorOrder.top();
     spillInfo.colorOrder.pop();
-    for (int curColor = 0; curColor < registerCount; curColor++) {
-      bool colorAvailable = true;
-      for (auto x : interferenceGraph[currentNode]) {
-        if (color.find(x) != color.end() && color[x] == curColor) {
-          colorAvailable = false;
-          break;
-        }
+    colorUsed.assign(registerCount, false);
+    for (SymbolId x : interferenceGraph.neighbors(currentNode)) {
+      if (color[x] >= 0) {
+        colorUsed[color[x]] = true;
+      }
+    }
+    auto isFree = [&](int curColor) {
+      return curColor >= 0 && curColor < registerCount &&
+             !colorUsed[curColor] && canUseRegister(currentNode, curColor);
+    };
+    // The moves left are saved when both ends get the same color
+    for (SymbolId partner : partners[currentNode]) {
+      if (isFree(color[partner])) {
+        color[currentNode] = color[partner];
+        break;
       }
-      if (colorAvailable) {
+    }
+    if (color[currentNode] >= 0) {
+      continue;
+    }
+    for (int curColor : registerPreference(currentNode)) {
+      if (isFree(curColor)) {
         color[currentNode] = curColor;
         break;
       }
@@ -1097,37 +1730,403 @@ std::map<std::shared_ptr<Symbol>, int> CFG::assignRegisters(
   return color;
 }
 
-std::map<std::shared_ptr<Symbol>, std::vector<std::shared_ptr<Symbol>>>
-CFG::buildInterferenceGraph(LivenessInfo &liveInfo) {
-  std::map<std::shared_ptr<Symbol>, std::vector<std::shared_ptr<Symbol>>>
-      interferenceGraph;
-  for (auto inPtr : liveInfo.liveIn) {
-    auto declaredVar = inPtr.first->getDeclaredVariable();
-    if (!declaredVar.empty()) {
-      auto definedVariable = *declaredVar.begin();
-      if (interferenceGraph.find(definedVariable) == interferenceGraph.end()) {
-        interferenceGraph[definedVariable] =
-            std::vector<std::shared_ptr<Symbol>>();
+InterferenceGraph CFG::buildInterferenceGraph(const Liveness &liveness) {
+  TimeReport::Scope timer("interference graph");
+  InterferenceGraph interferenceGraph(getSymbolCount());
+  // A symbol interferes with everything live after its definition, except
+  // with the source of a copy: both hold the same value
+  liveness.forEachInstruction([&](IRInstr &instr, const BitVector &liveOut) {
+    SymbolId copied = isCopy(instr) ? instr.getSymbolParam(1) : invalidSymbol;
+    for (SymbolId definedVariable : instr.getDeclaredVariable()) {
+      interferenceGraph.addNode(definedVariable);
+      liveOut.forEach([&](size_t outVar) {
+        if (outVar != copied) {
+          interferenceGraph.addEdge(definedVariable, outVar);
+        }
+      });
+    }
+  });
+  return interferenceGraph;
+}
+
+std::vector<RegisterMove> CFG::findMoves(const Liveness &liveness) {
+  TimeReport::Scope timer("register coalescing");
+  LoopInfo loops(liveness.getReversePostOrder());
+  std::vector<RegisterMove> moves;
+  for (BasicBlock *bb : liveness.getReversePostOrder()) {
+    double weight = 1;
+    for (int d = std::min(loops.depth(bb), 8); d > 0; d--) {
+      weight *= 10;
+    }
+    for (const IRInstr &instr : bb->instrs) {
+      switch (instr.getOperation()) {
+      case IRInstr::var_assign:
+        moves.push_back(
+            {instr.getSymbolParam(0), instr.getSymbolParam(1), weight});
+        break;
+      case IRInstr::add:
+      case IRInstr::sub:
+      case IRInstr::mul:
+      case IRInstr::b_and:
+      case IRInstr::b_or:
+      case IRInstr::b_xor:
+        moves.push_back(
+            {instr.getSymbolParam(2), instr.getSymbolParam(0), weight});
+        if (instr.isCommutative()) {
+          moves.push_back(
+              {instr.getSymbolParam(2), instr.getSymbolParam(1), weight});
+        }
+        break;
+      case IRInstr::neg:
+      case IRInstr::not_:
+      case IRInstr::inc:
+      case IRInstr::dec:
+        moves.push_back(
+            {instr.getSymbolParam(1), instr.getSymbolParam(0), weight});
+        break;
+      default:
+        break;
+      }
+    }
+  }
+  std::stable_sort(moves.begin(), moves.end(),
+                   [](const RegisterMove &x, const RegisterMove &y) {
+                     return x.weight > y.weight;
+                   });
+  return moves;
+}
+
+std::vector<SymbolId> CFG::coalesce(InterferenceGraph &interferenceGraph,
+                                    std::vector<RegisterMove> &moves,
+                                    std::vector<double> &spillCost,
+                                    int registerCount) {
+  TimeReport::Scope timer("register coalescing");
+  std::vector<SymbolId> alias(getSymbolCount());
+  for (SymbolId symbol = 0; symbol < alias.size(); symbol++) {
+    alias[symbol] = symbol;
+  }
+  auto find = [&](SymbolId symbol) {
+    while (alias[symbol] != symbol) {
+      symbol = alias[symbol] = alias[alias[symbol]];
+    }
+    return symbol;
+  };
+  const InterferenceGraph &graph = interferenceGraph;
+  size_t k = registerCount;
+
+  // Briggs: the merged node has fewer than k neighbors of significant degree
+  auto briggs = [&](SymbolId a, SymbolId b) {
+    size_t significant = 0;
+    for (SymbolId t : graph.neighbors(a)) {
+      size_t degree = graph.degree(t) - (graph.interferes(t, b) ? 1 : 0);
+      significant += degree >= k;
+    }
+    for (SymbolId t : graph.neighbors(b)) {
+      significant += !graph.interferes(t, a) && graph.degree(t) >= k;
+    }
+    return significant < k;
+  };
+  // George: every neighbor of b already interferes with a, or is
+  // insignificant
+  auto george = [&](SymbolId a, SymbolId b) {
+    for (SymbolId t : graph.neighbors(b)) {
+      if (!graph.interferes(t, a) && graph.degree(t) >= k) {
+        return false;
       }
-      for (auto &outVar : liveInfo.liveOut[inPtr.first]) {
-        if (outVar != definedVariable &&
-            std::find(interferenceGraph[definedVariable].begin(),
-                      interferenceGraph[definedVariable].end(),
-                      outVar) == interferenceGraph[definedVariable].end()) {
-          interferenceGraph[definedVariable].push_back(outVar);
-          interferenceGraph[outVar].push_back(definedVariable);
+    }
+    return true;
+  };
+
+  std::vector<RegisterMove> remaining;
+  int merged = 0;
+  for (const RegisterMove &move : moves) {
+    SymbolId a = find(move.a);
+    SymbolId b = find(move.b);
+    if (a == b || !graph.contains(a) || !graph.contains(b)) {
+      continue;
+    }
+    if (graph.interferes(a, b)) {
+      continue;
+    }
+    if (george(b, a)) {
+      std::swap(a, b);
+    } else if (!george(a, b) && !briggs(a, b)) {
+      remaining.push_back({a, b, move.weight});
+      continue;
+    }
+    interferenceGraph.merge(a, b);
+    alias[b] = a;
+    spillCost[a] += spillCost[b];
+    forbiddenRegisters[a] |= forbiddenRegisters[b];
+    crossesCall[a] = crossesCall[a] || crossesCall[b];
+    merged++;
+  }
+  Statistics::add("register coalescing: nodes merged", merged);
+
+  // The moves left may have been merged since, or made to interfere
+  moves.clear();
+  for (const RegisterMove &move : remaining) {
+    SymbolId a = find(move.a);
+    SymbolId b = find(move.b);
+    if (a != b && !graph.interferes(a, b)) {
+      moves.push_back({a, b, move.weight});
+    }
+  }
+  for (SymbolId symbol = 0; symbol < alias.size(); symbol++) {
+    alias[symbol] = find(symbol);
+  }
+  return alias;
+}
+
+void CFG::optimize() {
+  auto eliminateDeadCode = [this]() {
+    TimeReport::Scope timer("dead code elimination");
+    int removed = DeadCodeElimination(this).run();
+    Statistics::add("dead code elimination: instructions", removed);
+  };
+
+  auto simplifyControlFlow = [this]() {
+    TimeReport::Scope timer("cfg simplification");
+    CFGSimplification simplification(this);
+    Statistics::add("cfg simplification: blocks removed",
+                    simplification.run());
+    Statistics::add("cfg simplification: branches threaded",
+                    simplification.getThreadedCount());
+  };
+
+  eliminateDeadCode();
+  simplifyControlFlow();
+  {
+    TimeReport::Scope timer("tail recursion");
+    int calls = TailRecursion(this).run();
+    Statistics::add("tail calls: self-recursive calls", calls);
+  }
+  if (Options::unrollLoops()) {
+    bool unrolled;
+    {
+      TimeReport::Scope timer("loop unrolling");
+      LoopUnrolling unrolling(this);
+      int full = unrolling.run();
+      Statistics::add("loop unrolling: loops fully unrolled", full);
+      Statistics::add("loop unrolling: loops partially unrolled",
+                      unrolling.getPartialCount());
+      unrolled = full + unrolling.getPartialCount() > 0;
+    }
+    // The copies of the body are chained through empty blocks, and the
+    // header of a loop fully unrolled is left unreachable
+    if (unrolled) {
+      simplifyControlFlow();
+    }
+  }
+  {
+    TimeReport::Scope timer("ssa construction");
+    SSAConstruction(this).run();
+  }
+  {
+    TimeReport::Scope timer("constant propagation");
+    ConstantPropagation(this).run();
+  }
+  {
+    TimeReport::Scope timer("value numbering");
+    int replaced = ValueNumbering(this).run();
+    Statistics::add("value numbering: redundant instructions", replaced);
+  }
+  {
+    TimeReport::Scope timer("copy propagation");
+    int removed = CopyPropagation(this).run();
+    Statistics::add("copy propagation: copies", removed);
+  }
+  {
+    TimeReport::Scope timer("loop invariant code motion");
+    int hoisted = LoopInvariantCodeMotion(this).run();
+    Statistics::add("loop invariant code motion: instructions", hoisted);
+  }
+  {
+    TimeReport::Scope timer("induction variables");
+    InductionVariables inductionVariables(this);
+    int reduced = inductionVariables.run();
+    Statistics::add("induction variables: multiplications", reduced);
+    Statistics::add("induction variables: removed",
+                    inductionVariables.getRemovedCount());
+  }
+  {
+    TimeReport::Scope timer("ssa destruction");
+    SSADestruction(this).run();
+  }
+  simplifyControlFlow();
+  {
+    TimeReport::Scope timer("instruction selection");
+    int selected = selectConstantOperands();
+    Statistics::add("instruction selection: constant operands", selected);
+  }
+  eliminateDeadCode();
+}
+
+int CFG::selectConstantOperands() {
+  // Symbols whose only definition loads a constant that fits an int, or the
+  // address of a global
+  std::vector<int> defCount(symbols.size(), 0);
+  std::unordered_map<SymbolId, int> constant;
+  std::unordered_map<SymbolId, std::string> global;
+  for (BasicBlock *bb : bbs) {
+    for (const IRInstr &instr : bb->instrs) {
+      for (SymbolId symbol : instr.getDeclaredVariable()) {
+        defCount[symbol]++;
+      }
+      if (instr.getOperation() == IRInstr::addr &&
+          std::holds_alternative<std::string>(instr.getParams()[0])) {
+        global[instr.getSymbolParam(1)] =
+            std::get<std::string>(instr.getParams()[0]);
+      }
+      if (instr.getOperation() != IRInstr::ldconst) {
+        continue;
+      }
+      const std::string &literal = std::get<std::string>(instr.getParams()[0]);
+      char *end;
+      long long value = std::strtoll(literal.c_str(), &end, 10);
+      if (*end == '\0' && value >= INT_MIN && value <= INT_MAX) {
+        constant[instr.getSymbolParam(1)] = value;
+      }
+    }
+  }
+  auto isConstant = [&](SymbolId symbol) {
+    return defCount[symbol] == 1 && constant.count(symbol);
+  };
+
+  int selected = 0;
+  for (BasicBlock *bb : bbs) {
+    for (IRInstr &instr : bb->instrs) {
+      IRInstr::Operation op = instr.getOperation();
+      if (op == IRInstr::lea || op == IRInstr::load || op == IRInstr::store) {
+        std::vector<Parameter> params = instr.getParams();
+        long long scale = op == IRInstr::lea
+                              ? std::stoi(std::get<std::string>(params[2]))
+                              : getSize(instr.getType());
+        auto index = std::get_if<SymbolId>(&params[1]);
+        if (index != nullptr && isConstant(*index) &&
+            std::llabs(constant[*index] * scale) < (1 << 30)) {
+          params[1] = std::to_string(constant[*index]);
         }
+        auto pointer = std::get_if<SymbolId>(&params[0]);
+        if (std::holds_alternative<std::string>(params[1]) &&
+            pointer != nullptr && defCount[*pointer] == 1 &&
+            global.count(*pointer)) {
+          params[0] = global[*pointer];
+        }
+        if (params != instr.getParams()) {
+          instr = IRInstr(bb, op, instr.getType(), params);
+          selected++;
+        }
+        continue;
+      }
+      if (op != IRInstr::mul && op != IRInstr::div && op != IRInstr::mod) {
+        continue;
       }
+      SymbolId a = instr.getSymbolParam(0);
+      SymbolId b = instr.getSymbolParam(1);
+      if (op == IRInstr::mul && isConstant(a) && !isConstant(b)) {
+        std::swap(a, b);
+      }
+      // A division by zero is left to happen at run time
+      if (!isConstant(b) || (op != IRInstr::mul && constant[b] == 0)) {
+        continue;
+      }
+      IRInstr::Operation selectedOp = op == IRInstr::mul   ? IRInstr::mulconst
+                                      : op == IRInstr::div ? IRInstr::divconst
+                                                           : IRInstr::modconst;
+      SymbolId dest = instr.getSymbolParam(2);
+      instr = IRInstr(bb, selectedOp, symbols[dest].type,
+                      {a, std::to_string(constant[b]), dest});
+      selected++;
     }
   }
-  return interferenceGraph;
+  return selected;
 }
 
-void CFG::computeRegisterAllocation() {
-  LivenessInfo liveInfo = computeLiveInfo();
-  std::map<std::shared_ptr<Symbol>, std::vector<std::shared_ptr<Symbol>>>
-      interferenceGraph = buildInterferenceGraph(liveInfo);
-  spillInformation spillInfo = findColorOrder(interferenceGraph, 7);
+void CFG::fuseCompareBranches() {
+  std::vector<int> useCount(symbols.size(), 0);
+  for (BasicBlock *bb : bbs) {
+    for (const IRInstr &instr : bb->instrs) {
+      for (SymbolId symbol : instr.getUsedVariables()) {
+        useCount[symbol]++;
+      }
+    }
+  }
 
-  registerAssignment = assignRegisters(spillInfo, interferenceGraph, 7);
+  for (BasicBlock *bb : bbs) {
+    size_t size = bb->instrs.size();
+    if (size < 2 || bb->exit_false == nullptr ||
+        bb->instrs[size - 1].getOperation() != IRInstr::cmpNZ) {
+      continue;
+    }
+    IRInstr &compare = bb->instrs[size - 2];
+    const char *condition = negatedCondition(compare.getOperation());
+    SymbolId result = bb->instrs[size - 1].getSymbolParam(0);
+    if (condition == nullptr || compare.getSymbolParam(2) != result ||
+        useCount[result] != 1) {
+      continue;
+    }
+    // The flags survive up to the jump: the split and edge moves are movs
+    bb->falseCondition = condition;
+    compare = IRInstr(bb, IRInstr::cmp, Type::INT,
+                      {compare.getSymbolParam(0), compare.getSymbolParam(1)});
+    bb->instrs.pop_back();
+  }
+}
+
+int CFG::selectTailCalls() {
+  int selected = 0;
+  for (BasicBlock *bb : bbs) {
+    size_t size = bb->instrs.size();
+    if (size < 2 || bb->instrs[size - 1].getOperation() != IRInstr::ret ||
+        bb->instrs[size - 2].getOperation() != IRInstr::call) {
+      continue;
+    }
+    const IRInstr &ret = bb->instrs[size - 1];
+    IRInstr &call = bb->instrs[size - 2];
+    std::vector<SymbolId> result = call.getDeclaredVariable();
+    if (result != ret.getUsedVariables()) {
+      continue;
+    }
+    // The arguments must all go in registers: the ones on the stack would
+    // overwrite the arguments of the function itself. The callee may also
+    // be given the address of a local array, freed with the frame.
+    std::vector<Parameter> params = call.getParams();
+    CFG *callee = visitor->getFunction(std::get<std::string>(params[0]));
+    if (callee->get_return_type() != returnType || addressesFrame() ||
+        callee->get_parameters_type().size() > 6) {
+      continue;
+    }
+    if (!result.empty()) {
+      params.pop_back();
+    }
+    call = IRInstr(bb, IRInstr::tailcall, Type::VOID, params);
+    bb->instrs.pop_back();
+    selected++;
+  }
+  return selected;
+}
+
+void CFG::computeRegisterAllocation() {
+  Liveness liveness = computeLiveInfo();
+  computeRegisterConstraints(liveness);
+  if (Options::getRegisterAllocator() == RegisterAllocator::LinearScan) {
+    TimeReport::Scope timer("linear scan");
+    LinearScan(this, liveness, allocatableRegisterCount()).run();
+    return;
+  }
+  InterferenceGraph interferenceGraph = buildInterferenceGraph(liveness);
+  std::vector<double> spillCost = computeSpillCosts(liveness);
+  std::vector<RegisterMove> moves = findMoves(liveness);
+  std::vector<SymbolId> alias =
+      coalesce(interferenceGraph, moves, spillCost, allocatableRegisterCount());
+  spillInformation spillInfo =
+      findColorOrder(interferenceGraph, spillCost, allocatableRegisterCount());
+
+  std::vector<int> color = assignRegisters(spillInfo, interferenceGraph, moves,
+                                           allocatableRegisterCount());
+  registerAssignment.assign(getSymbolCount(), -1);
+  for (SymbolId symbol = 0; symbol < alias.size(); symbol++) {
+    registerAssignment[symbol] = color[alias[symbol]];
+  }
 }
@@ -4,30 +4,26 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <sstream>
 #include <stack>
 #include <string>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
+#include "MachineCode.h"
+#include "Registers.h"
 #include "Symbol.h"
 #include "Type.h"
 
 class BasicBlock;
 class CFG;
 class CodeGenVisitor;
+class InterferenceGraph;
+class Liveness;
 
-typedef std::map<std::string, std::shared_ptr<Symbol>> SymbolTable;
-typedef std::variant<std::shared_ptr<Symbol>, std::string> Parameter;
-
-const std::string registers8[] = {"r8b",  "r9b",  "r10b", "r11b",
-                                  "r12b", "r13b", "r14b", "r15b"};
-const std::string registers32[] = {"r8d",  "r9d",  "r10d", "r11d",
-                                   "r12d", "r13d", "r14d", "r15d"};
-const std::string registers64[] = {"r8",  "r9",  "r10", "r11",
-                                   "r12", "r13", "r14", "r15"};
-const std::string paramRegisters[] = {"edi", "esi", "edx", "ecx", "r8d", "r9d"};
-
-std::ostream &operator<<(std::ostream &os, const Parameter &param);
+typedef std::map<std::string, SymbolId> SymbolTable;
+typedef std::variant<SymbolId, std::string> Parameter;
 
 class IRInstr {
 
@@ -42,10 +38,14 @@ public:
     mul,
     div,
     mod,
+    mulconst, /**< {a, constant, dest}, see CFG::selectConstantOperands */
+    divconst,
+    modconst,
     b_and,
     b_or,
     b_xor,
     cmpNZ,
+    cmp,
     ret,
     leq,
     lt,
@@ -58,23 +58,60 @@ public:
     lnot,
     inc,
     dec,
+    addr,  /**< {object, dest}: address of a local array, given as its symbol,
+              or of a global, given as its name */
+    lea,   /**< {pointer, index, scale, dest}: pointer + index * scale */
+    load,  /**< {pointer, index, dest}: element index of the type of the
+              instruction from pointer */
+    store, /**< {pointer, index, value}: value to element index */
     nothing,
     call,
+    tailcall, /**< {name, args...}: call ending the function, see
+                 CFG::selectTailCalls */
     param,
-    param_decl
+    param_decl,
+    phi
   } Operation;
 
   /**  constructor */
   IRInstr(BasicBlock *bb_, Operation op, Type t,
           const std::vector<Parameter> &params);
 
-  void genAsm(std::ostream &os, CFG *cfg);
+  void genAsm(MachineCode &code, CFG *cfg);
 
   friend std::ostream &operator<<(std::ostream &os, IRInstr &instruction);
 
+  inline Operation getOperation() const { return op; }
+  inline Type getType() const { return outType; }
+  inline const std::vector<Parameter> &getParams() const { return params; }
+  inline SymbolId getSymbolParam(int i) const {
+    return std::get<SymbolId>(params[i]);
+  }
+  inline void setSymbolParam(int i, SymbolId symbol) { params[i] = symbol; }
+  inline void setBlock(BasicBlock *bb) { block = bb; }
+
   // Helper functions for register allocation
-  std::set<std::shared_ptr<Symbol>> getUsedVariables();
-  std::set<std::shared_ptr<Symbol>> getDeclaredVariable();
+  std::vector<SymbolId> getUsedVariables() const;
+  std::vector<SymbolId> getDeclaredVariable() const;
+  // Indices in params of the symbols read, and of the symbol defined (-1 if
+  // none)
+  std::vector<int> getUseIndices() const;
+  int getDefIndex() const;
+  // Whether the instruction does more than define its declared variable
+  bool hasSideEffects() const;
+  // Whether the two operands of the binary operation can be swapped
+  bool isCommutative() const;
+  // The local array addressed by addr, lea, load or store, or invalidSymbol.
+  // The pointer operand of the last three may be such an array, addressed
+  // within the frame: it is not a symbol read. Their index is a symbol or a
+  // constant, and after instruction selection their pointer may also be the
+  // name of a global, given a constant index (see
+  // CFG::selectConstantOperands).
+  SymbolId getObject() const;
+
+  /** phi only: the predecessor each source comes from, source i being
+   * params[i + 1] */
+  std::vector<BasicBlock *> phiBlocks;
 
 private:
   Type outType;
@@ -83,29 +120,49 @@ private:
   BasicBlock *block;
 
   // Functions to generate the assembly
-  void handleCmpNZ(std::ostream &os, CFG *cfg);
-  void handleDiv(std::ostream &os, CFG *cfg);
-  void handleMod(std::ostream &os, CFG *cfg);
-  void handleRet(std::ostream &os, CFG *cfg);
-  void handleVar_assign(std::ostream &os, CFG *cfg);
-  void handleLdconst(std::ostream &os, CFG *cfg);
-  void handleLdvar(std::ostream &os, CFG *cfg);
-  void handleUnaryOp(const std::string &op, std::ostream &os, CFG *cfg);
-
-  void handleCall(std::ostream &os, CFG *cfg);
-  void handleParam(std::ostream &os, CFG *cfg);
-
-  void handleBinaryOp(const std::string &op, std::ostream &os, CFG *cfg);
-  void handleCmpOp(const std::string &op, std::ostream &os, CFG *cfg);
+  void handleCmpNZ(MachineCode &code, CFG *cfg);
+  void handleCmp(MachineCode &code, CFG *cfg);
+  void handleDivision(MachineCode &code, CFG *cfg); /**< up to idivl */
+  void handleDiv(MachineCode &code, CFG *cfg);
+  void handleMod(MachineCode &code, CFG *cfg);
+  void handleMulConst(MachineCode &code, CFG *cfg);
+  // Quotient or remainder, without idivl
+  void handleDivConst(bool remainder, MachineCode &code, CFG *cfg);
+  void handleRet(MachineCode &code, CFG *cfg);
+  void handleVar_assign(MachineCode &code, CFG *cfg);
+  void handleLdconst(MachineCode &code, CFG *cfg);
+  void handleLdvar(MachineCode &code, CFG *cfg);
+  void handleUnaryOp(const std::string &op, MachineCode &code, CFG *cfg);
+  void handleAddr(MachineCode &code, CFG *cfg);
+  void handleLea(MachineCode &code, CFG *cfg);
+  void handleLoad(MachineCode &code, CFG *cfg);
+  void handleStore(MachineCode &code, CFG *cfg);
+  // Operand addressing element index of the pointer operand, scale bytes
+  // each: an index symbol is sign-extended into indexRegister, and a pointer
+  // living in memory loaded into baseRegister, or added to the scaled index
+  // when both are the same register
+  std::string elementOperand(MachineCode &code, CFG *cfg, int scale,
+                             int indexRegister, int baseRegister);
+
+  // Call, or jump to the function for a tailcall
+  void handleCall(MachineCode &code, CFG *cfg);
+  void handleParam(MachineCode &code, CFG *cfg);
+
+  void handleBinaryOp(const std::string &op, MachineCode &code, CFG *cfg);
+  void handleCmpOp(const std::string &op, MachineCode &code, CFG *cfg);
 };
 
 class BasicBlock {
 public:
   BasicBlock(CFG *cfg, std::string entry_label);
-  void gen_asm(std::ostream &o); /**< x86 assembly code
-                             generation for this basic block (very simple) */
-  std::shared_ptr<Symbol> add_IRInstr(IRInstr::Operation op, Type t,
-                                      std::vector<Parameter> params);
+  // Emits the block followed by next in the layout (see BlockLayout), which
+  // its branches fall through to when they can
+  void gen_asm(MachineCode &code, BasicBlock *next);
+  SymbolId add_IRInstr(IRInstr::Operation op, Type t,
+                       std::vector<Parameter> params);
+  // Erases the param instructions of a call taken out of the block: for each
+  // argument, the last one passing it before index end
+  void eraseParams(const std::vector<SymbolId> &arguments, size_t end);
 
   // No encapsulation whatsoever here. Feel free to do better.
   /**< pointer to the next basic block, true branch. If
@@ -116,10 +173,6 @@ public:
    * null_ptr, the basic block ends with an unconditional jump  */
   BasicBlock *exit_false;
 
-  // This is true if the assembly code relative to this block has already been
-  // written
-  bool visited;
-
   std::string label; /**< label of the BB, also will be the label in the
                    generated      code */
   CFG *cfg;          /** < the CFG where this block belongs */
@@ -127,31 +180,51 @@ public:
   std::string test_var_name;   /** < when generating IR code for an if(expr) or
                              while(expr) etc,     store here the name of the
                              variable     that holds the value of expr */
+  std::string falseCondition;  /** < condition code of the jump to exit_false:
+                             "e" after a cmpNZ, the negated comparison after a
+                             cmp (see CFG::fuseCompareBranches) */
 };
 
 struct FunctionParameter {
   Type type;
-  std::shared_ptr<Symbol> symbol;
+  SymbolId symbol;
+
+  FunctionParameter(Type type, SymbolId symbol) : type(type), symbol(symbol){};
+};
+
+// Moves required by the symbols split by the linear-scan allocator (see
+// LinearScan). A split symbol lives in its register before its split slot,
+// and in its stack slot from there on.
+struct SplitMove {
+  SymbolId symbol;
+  bool load; /**< stack slot to register, otherwise register to stack slot */
+};
 
-  FunctionParameter(Type type, std::shared_ptr<Symbol> symbol)
-      : type(type), symbol(symbol){};
+struct SplitInfo {
+  std::vector<int> splitSlot; /**< by SymbolId, empty if nothing is split */
+  std::unordered_map<BasicBlock *, int> firstSlot;
+  std::unordered_map<int, std::vector<SymbolId>> stores; /**< before a slot */
+  std::map<std::pair<BasicBlock *, BasicBlock *>, std::vector<SplitMove>>
+      edgeMoves;
 };
 
-struct LivenessInfo {
-  std::map<IRInstr *, std::set<std::shared_ptr<Symbol>>> liveIn;
-  std::map<IRInstr *, std::set<std::shared_ptr<Symbol>>> liveOut;
+// Two symbols that save a move when given the same register, weighted by
+// how often the move runs (see computeSpillCosts)
+struct RegisterMove {
+  SymbolId a;
+  SymbolId b;
+  double weight;
 };
 
 struct spillInformation {
-  std::stack<std::shared_ptr<Symbol>> colorOrder;
-  std::set<std::shared_ptr<Symbol>> spilledVariables;
+  std::stack<SymbolId> colorOrder;
+  std::vector<SymbolId> spilledVariables; /**< spill candidates */
 };
 
 class CFG {
 public:
   ~CFG();
-  CFG(Type type, const std::string &name, int argCount,
-      CodeGenVisitor *visitor);
+  CFG(Type type, const std::string &name, CodeGenVisitor *visitor);
 
   void add_bb(BasicBlock *bb);
   inline std::vector<BasicBlock *> &getBlocks() { return bbs; };
@@ -159,24 +232,51 @@ public:
   std::string IR_reg_to_asm(
       std::string reg); /**< helper method: inputs a IR reg or input variable,
                       returns e.g. "-24(%rbp)" for the proper value of 24 */
-  void gen_asm_prologue(std::ostream &o);
+  void gen_asm_prologue(MachineCode &code);
   void gen_asm(std::ostream &o);
-  void gen_asm_epilogue(std::ostream &o);
-
-  std::shared_ptr<Symbol> create_new_tempvar(Type t);
+  void gen_asm_epilogue(MachineCode &code);
+  // Restores the callee-saved registers and frees the frame, leaving the
+  // return address on top of the stack
+  void gen_asm_frame_exit(MachineCode &code);
+
+  SymbolId create_new_tempvar(Type t);
+  // New SSA version of a symbol, with its type and a stack slot of its own
+  SymbolId new_version(SymbolId symbol);
   int get_var_index(std::string name);
   Type get_var_type(std::string name);
 
   // basic block management
   std::string new_BB_name();
   BasicBlock *current_bb;
-  static const int scratchRegister = 7;
+  static const int scratchRegister = R11;
+  // Holds the address of a store whose operands live in memory, the value
+  // going through the scratch register: no symbol live across a store or
+  // read by it gets it (see computeRegisterConstraints)
+  static const int addressRegister = R10;
+  // The registers before it in Registers.h are allocatable: rbp only when the
+  // frame pointer is omitted
+  static int allocatableRegisterCount();
 
   inline void push_table() { symbolTables.push_front(SymbolTable()); }
   void pop_table();
 
   bool add_symbol(std::string id, Type t, int line);
-  std::shared_ptr<Symbol> get_symbol(const std::string &name);
+  // Looks the name up in the visible scopes, returns invalidSymbol if absent
+  SymbolId get_symbol(const std::string &name);
+
+  inline Symbol &getSymbol(SymbolId id) { return symbols[id]; }
+  inline size_t getSymbolCount() const { return symbols.size(); }
+  // Whether the symbol holds a 64-bit value, a pointer
+  inline bool isWide(SymbolId id) const {
+    return id != invalidSymbol && symbols[id].type.isPointer();
+  }
+  // Whether the instruction is a var_assign that does not change the value:
+  // assigning a wider value to a char truncates it, and an int becomes a
+  // pointer sign-extended
+  bool isCopy(const IRInstr &instr) const;
+  // Whether the function takes the address of one of its local arrays: its
+  // frame must then stay as long as the function runs
+  bool addressesFrame() const;
 
   std::string &get_name() { return name; }
   Type get_return_type() { return returnType; }
@@ -184,26 +284,78 @@ public:
     return parameterTypes;
   }
 
-  std::shared_ptr<Symbol> add_parameter(const std::string &name, Type type,
-                                        int line);
-  std::map<std::shared_ptr<Symbol>, int> registerAssignment;
-
-  inline void push_parameter(std::shared_ptr<Symbol> symbol) {
-    parameterStack.push(symbol);
+  SymbolId add_parameter(const std::string &name, Type type, int line);
+  // Register of each symbol, indexed by SymbolId. Symbols that are not
+  // assigned a register live in their stack slot (see findRegister).
+  std::vector<int> registerAssignment;
+  SplitInfo splitInfo;
+
+  // Symbols live across each call instruction, and whether each symbol is
+  // live across some call (by SymbolId). Only the caller-saved registers of
+  // these symbols are saved around the call.
+  std::unordered_map<const IRInstr *, std::vector<SymbolId>> liveAcrossCall;
+  std::vector<bool> crossesCall;
+  // Registers each symbol must not be given (by SymbolId): edx and eax for
+  // the symbols live across a division, addressRegister for the ones live
+  // across a store or read by it
+  std::vector<RegisterSet> forbiddenRegisters;
+  // Allocatable registers in the order a symbol should try them: symbols
+  // live across a call prefer the callee-saved ones
+  const std::vector<int> &registerPreference(SymbolId symbol) const;
+  inline bool canUseRegister(SymbolId symbol, int reg) const {
+    return !(forbiddenRegisters[symbol] & registerBit(reg));
   }
-
-  inline std::shared_ptr<Symbol> pop_parameter() {
-    std::shared_ptr<Symbol> symbol = parameterStack.top();
+  // Frame slot saving the register (see frame_slot)
+  inline int getSaveSlot(int reg) const { return saveSlot[reg]; }
+  // Operand addressing the frame, offset bytes below its top: where rbp
+  // points when the function keeps a frame pointer, 8 bytes below the return
+  // address, otherwise reached from rsp. index is added to the address, as
+  // ",%reg,scale".
+  std::string frame_slot(int offset, const std::string &index = "");
+  // Records a change of rsp within the body of the function: the arguments
+  // a call pushes, so that the rsp-relative slots stay right
+  inline void adjustStackPointer(int bytes) { stackAdjustment += bytes; }
+
+  inline void push_parameter(SymbolId symbol) { parameterStack.push(symbol); }
+
+  inline SymbolId pop_parameter() {
+    SymbolId symbol = parameterStack.top();
     parameterStack.pop();
     return symbol;
   }
 
   inline CodeGenVisitor *get_visitor() { return visitor; }
 
-  int findRegister(std::shared_ptr<Symbol> &param);
-
-  unsigned int
-      nextFreeSymbolIndex; /**< to allocate new symbols in the symbol table */
+  int findRegister(SymbolId symbol);
+
+  // Moves between a symbol and a register, from wherever the symbol lives at
+  // the current slot
+  void gen_asm_load(MachineCode &code, SymbolId symbol, int reg);
+  void gen_asm_store(MachineCode &code, int reg, SymbolId symbol);
+  // Operand reading the symbol, as a 32-bit value unless it is a pointer:
+  // its register or its stack slot
+  std::string gen_asm_source(SymbolId symbol);
+  // Emits register to register moves that happen simultaneously, as
+  // (source, destination) pairs, breaking cycles with the scratch register.
+  // The sources in wide hold 64-bit values.
+  void gen_asm_parallel_move(MachineCode &code,
+                             std::vector<std::pair<int, int>> moves,
+                             RegisterSet wide = 0);
+  // Stack slot of the symbol, e.g. "-24(%rbp)" (see frame_slot)
+  std::string stack_slot(SymbolId symbol);
+
+  // Split moves, emitted by the basic blocks (see SplitInfo)
+  int getFirstSlot(BasicBlock *bb);
+  inline void setCurrentSlot(int slot) { currentSlot = slot; }
+  void gen_asm_split_stores(MachineCode &code, int slot);
+  // Emits the moves of the edge from -> to, or returns false if there are
+  // none
+  bool gen_asm_edge_moves(MachineCode &code, BasicBlock *from, BasicBlock *to);
+  // Label a branch from -> to jumps to: the edge stub if the edge has moves
+  std::string branch_target(BasicBlock *from, BasicBlock *to);
+  // Label of a stub doing the moves of the edge from -> to and jumping to
+  // it. The stubs are emitted after the function.
+  std::string edge_stub_label(BasicBlock *from, BasicBlock *to);
 
 protected:
   int nextBBnumber; /**< just for naming */
@@ -212,30 +364,93 @@ protected:
   Type returnType;
   std::vector<FunctionParameter> parameterTypes;
 
-  std::stack<std::shared_ptr<Symbol>> parameterStack;
+  std::stack<SymbolId> parameterStack;
 
   std::vector<BasicBlock *> bbs; /**< all the basic blocks of this CFG*/
 
+  // Set by computeFrameLayout: a function without a frame pointer subtracts
+  // frameSize from rsp itself, nothing for a leaf function whose slots fit
+  // in the red zone (the 128 bytes below rsp that signal handlers leave
+  // alone)
+  bool framePointer;
+  int frameSize;       /**< allocated by the prologue */
+  int stackAdjustment; /**< see adjustStackPointer */
+  std::vector<int> saveSlot; /**< by register, 0 if it is never saved */
+  std::vector<bool> wideSave; /**< by register, saves a pointer at calls */
+  std::vector<int> calleeSavedUsed;
+
+  int currentSlot; /**< of the instruction being emitted */
+  MachineCode edgeStubs;
+  int edgeStubCount;
+
+  /** Every symbol of the function (variables, parameters and temporaries),
+   * addressed by SymbolId. The scoped tables only map names to ids. */
+  std::vector<Symbol> symbols;
   std::list<SymbolTable> symbolTables;
 
+  SymbolId new_symbol(Type t, const std::string &lexeme, int line);
+
   CodeGenVisitor *visitor;
 
+  // Runs the IR optimizations
+  void optimize();
+
+  // Instruction selection: a block ending with a comparison whose only use
+  // is its cmpNZ branches on the flags of a single cmp instead
+  void fuseCompareBranches();
+
+  // Instruction selection: a multiplication, division or remainder by a
+  // symbol only ever holding a constant uses the constant itself (mulconst,
+  // divconst, modconst), emitted as shifts, lea or a multiplication by a
+  // magic number. So does an element index, which becomes a displacement, a
+  // global then being addressed from rip. Returns the number of
+  // instructions rewritten.
+  int selectConstantOperands();
+
+  // Instruction selection: a call whose result is returned right away, to a
+  // function returning the same type and taking its arguments in registers,
+  // becomes a tailcall jumping to the function once the frame is freed.
+  // Returns the number of calls rewritten.
+  int selectTailCalls();
+
   void computeRegisterAllocation();
 
-  LivenessInfo computeLiveInfo();
+  // Fills liveAcrossCall, crossesCall and forbiddenRegisters
+  void computeRegisterConstraints(const Liveness &liveness);
+
+  // Places the stack slots of the symbols living in memory and the register
+  // save slots, and chooses how the frame is addressed
+  void computeFrameLayout();
+
+  Liveness computeLiveInfo();
+
+  // Estimated cost of keeping each symbol in memory: its uses and
+  // definitions, each weighted by 10^(loop depth of the instruction)
+  std::vector<double> computeSpillCosts(const Liveness &liveness);
+
+  spillInformation findColorOrder(InterferenceGraph &interferenceGraph,
+                                  const std::vector<double> &spillCost,
+                                  int registerCount);
 
-  spillInformation findColorOrder(
-      std::map<std::shared_ptr<Symbol>, std::vector<std::shared_ptr<Symbol>>>
-          &interferenceGraph,
-      int registerCount);
+  InterferenceGraph buildInterferenceGraph(const Liveness &liveness);
 
-  std::map<std::shared_ptr<Symbol>, std::vector<std::shared_ptr<Symbol>>>
+  // The copies, and the operations reading their first operand into the
+  // register of their result, by decreasing weight
+  std::vector<RegisterMove> findMoves(const Liveness &liveness);
 
-  buildInterferenceGraph(LivenessInfo &liveInfo);
+  // Conservative coalescing (Briggs and George): merges the two symbols of
+  // a move when the merged node is still sure to get a register. Returns the
+  // node each symbol is merged into, and leaves in moves the ones that
+  // remain between two nodes.
+  std::vector<SymbolId> coalesce(InterferenceGraph &interferenceGraph,
+                                 std::vector<RegisterMove> &moves,
+                                 std::vector<double> &spillCost,
+                                 int registerCount);
 
-  std::map<std::shared_ptr<Symbol>, int> assignRegisters(
-      spillInformation &spillInfo,
-      std::map<std::shared_ptr<Symbol>, std::vector<std::shared_ptr<Symbol>>>
-          &interferenceGraph,
-      int registerCount);
+  // Colors the nodes in order, each preferring the colors of the nodes it
+  // has moves with
+  std::vector<int> assignRegisters(spillInformation &spillInfo,
+                                   InterferenceGraph &interferenceGraph,
+                                   const std::vector<RegisterMove> &moves,
+                                   int registerCount);
 };
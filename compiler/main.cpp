@@ -8,21 +8,43 @@
 #include "generated/ifccParser.h"
 
 #include "CodeGenVisitor.h"
+#include "Inliner.h"
+#include "Options.h"
+#include "Statistics.h"
+#include "TimeReport.h"
 
 using namespace antlr4;
 using namespace std;
 
 int main(int argn, const char **argv) {
   stringstream in;
-  if (argn == 2) {
-    ifstream lecture(argv[1]);
+  const char *fileName = nullptr;
+  for (int i = 1; i < argn; i++) {
+    string arg = argv[i];
+    if (arg == "-ftime-report") {
+      TimeReport::enable();
+    } else if (arg == "-fstats") {
+      Statistics::enable();
+    } else if (arg[0] != '-' && fileName == nullptr) {
+      fileName = argv[i];
+    } else if (!Options::parse(arg)) {
+      cerr << "error: unknown argument: " << arg << endl;
+      exit(1);
+    }
+  }
+  if (fileName != nullptr) {
+    ifstream lecture(fileName);
     if (!lecture.good()) {
-      cerr << "error: cannot read file: " << argv[1] << endl;
+      cerr << "error: cannot read file: " << fileName << endl;
       exit(1);
     }
     in << lecture.rdbuf();
   } else {
-    cerr << "usage: ifcc path/to/file.c" << endl;
+    cerr << "usage: ifcc [-ftime-report] [-fstats] "
+            "[-fregalloc=graph|linear] [-fno-inline] [-finline-limit=N] "
+            "[-fomit-frame-pointer|-fno-omit-frame-pointer] "
+            "[-fno-peephole] [-fno-unroll-loops] [-funroll-factor=N] "
+            "path/to/file.c" << endl;
     exit(1);
   }
 
@@ -46,6 +68,11 @@ int main(int argn, const char **argv) {
   v.visit(tree);
 
   auto cfgList = v.getCfgList();
+  {
+    TimeReport::Scope timer("inlining");
+    int inlined = Inliner(cfgList).run();
+    Statistics::add("inlining: calls inlined", inlined);
+  }
   for (auto cfg : cfgList) {
     if (cfg->get_name() == "putchar" || cfg->get_name() == "getchar") {
       continue;
@@ -59,5 +86,12 @@ int main(int argn, const char **argv) {
     }
   }
 
+  if (TimeReport::isEnabled()) {
+    TimeReport::print(std::cerr);
+  }
+  if (Statistics::isEnabled()) {
+    Statistics::print(std::cerr);
+  }
+
   return 0;
 }
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+
+# This script measures how the compile time of IFCC scales with the size of
+# the function being compiled.
+#
+# It generates synthetic C functions of increasing size (straight-line
+# arithmetic, conditionals and small loops, with many temporaries), compiles
+# each of them with `ifcc -ftime-report` and prints the time spent in each
+# compilation phase. When the size doubles, a phase that scales linearly
+# should take about twice as long.
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def parse_args() -> argparse.Namespace:
+    argparser = argparse.ArgumentParser(
+        description="Compile synthetic functions of increasing size with IFCC and report the time of each phase."
+    )
+
+    default_ifcc_path = os.path.abspath(os.path.join(os.path.dirname(os.path.realpath(__file__)), '../compiler/ifcc'))
+    argparser.add_argument('--ifcc_path', metavar='PATH', default=default_ifcc_path,
+                           help=f'Path to the ifcc executable. Default is {default_ifcc_path}')
+    argparser.add_argument('--sizes', metavar='N', type=int, nargs='+', default=[400, 800, 1600, 3200],
+                           help='Number of statements of each generated function')
+    argparser.add_argument('--phases', metavar='PHASE', nargs='+',
+                           default=['liveness', 'interference graph', 'register coloring'],
+                           help='Phases of -ftime-report to display (default: liveness, '
+                                'interference graph and register coloring)')
+    argparser.add_argument('--pressure', action='store_true',
+                           help='Generate groups of values read with getchar() and live at the same time, so '
+                                'that the number of spills grows with the size')
+    argparser.add_argument('--ifcc_args', metavar='ARGS', default='',
+                           help='Extra arguments passed to ifcc')
+    argparser.add_argument('--keep', action='store_true', help='Keep the generated C files')
+    return argparser.parse_args()
+
+
+def generate_function(statements: int) -> str:
+    """return the source of a program whose main() has about `statements` statements"""
+    variables = 16
+    lines = ['int main() {']
+    for v in range(variables):
+        lines.append(f'  int v{v} = {v + 1};')
+    lines.append('  int acc = 0;')
+    for k in range(statements):
+        a, b, c = k % variables, (k * 7 + 3) % variables, (k * 5 + 1) % variables
+        kind = k % 10
+        if kind == 9:
+            lines.append(f'  int i{k} = 0;')
+            lines.append(f'  while (i{k} < 2) {{')
+            lines.append(f'    acc = acc + i{k} * v{a};')
+            lines.append(f'    i{k} = i{k} + 1;')
+            lines.append('  }')
+        elif kind == 4:
+            lines.append(f'  if (v{a} > v{b}) {{')
+            lines.append(f'    acc = acc + v{c} - v{a};')
+            lines.append('  } else {')
+            lines.append(f'    acc = acc - v{b};')
+            lines.append('  }')
+        else:
+            lines.append(f'  v{a} = (v{b} * 3 + v{c} - {k % 100}) % 1000;')
+    lines.append('  return acc % 256;')
+    lines.append('}')
+    return '\n'.join(lines) + '\n'
+
+
+def generate_pressure(statements: int) -> str:
+    """return the source of a program whose main() has about `statements` statements, in groups of variables
+    unknown at compile time and live at the same time: each group needs more registers than there are, while the
+    interference graph stays sparse"""
+    group_size = 24
+    lines = ['int main() {', '  int acc = 0;']
+    for group in range(max(1, statements // (2 * group_size))):
+        names = [f'g{group}_{v}' for v in range(group_size)]
+        for v, name in enumerate(names):
+            lines.append(f'  int {name} = getchar() + {v};')
+        for v, name in enumerate(names):
+            lines.append(f'  acc = acc * 3 + {name} * {names[(v + 5) % group_size]};')
+    lines.append('  return acc % 256;')
+    lines.append('}')
+    return '\n'.join(lines) + '\n'
+
+
+def run_ifcc(ifcc_path: str, extra_args: str, source_path: str):
+    """compile one file and return (wall time, {phase: seconds})"""
+    start = time.perf_counter()
+    result = subprocess.run(f'{ifcc_path} -ftime-report {extra_args} {source_path}', shell=True,
+                            stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    elapsed = time.perf_counter() - start
+    if result.returncode != 0:
+        print(f'error: ifcc failed on {source_path}', file=sys.stderr)
+        sys.exit(1)
+    phases = {}
+    for line in result.stderr.decode(errors='replace').splitlines():
+        # time-report: <phase name>  <seconds> s
+        match = re.match(r'time-report:\s*(.*?)\s+([0-9.]+) s$', line)
+        if match:
+            phases[match.group(1)] = float(match.group(2))
+    return elapsed, phases
+
+
+if __name__ == "__main__":
+    args = parse_args()
+    ifcc_path = os.path.abspath(args.ifcc_path)
+    if not os.path.isfile(ifcc_path):
+        print(f'error: ifcc executable not found at {ifcc_path}', file=sys.stderr)
+        sys.exit(1)
+
+    workdir = tempfile.mkdtemp(prefix='ifcc-bench-')
+    header = f'{"statements":>10} {"total (s)":>10}' + ''.join(f' {p + " (s)":>22} {"x":>5}' for p in args.phases)
+    print(header)
+    previous = {}
+    for size in args.sizes:
+        source_path = os.path.join(workdir, f'bench_{size}.c')
+        with open(source_path, 'w') as f:
+            f.write(generate_pressure(size) if args.pressure else generate_function(size))
+        elapsed, phases = run_ifcc(ifcc_path, args.ifcc_args, source_path)
+        row = f'{size:>10} {elapsed:>10.3f}'
+        for phase in args.phases:
+            seconds = phases.get(phase, 0.0)
+            growth = f'{seconds / previous[phase]:.1f}' if previous.get(phase) else '-'
+            row += f' {seconds:>22.4f} {growth:>5}'
+            previous[phase] = seconds
+        print(row)
+
+    if args.keep:
+        print(f'generated files kept in {workdir}')
+    else:
+        for name in os.listdir(workdir):
+            os.remove(os.path.join(workdir, name))
+        os.rmdir(workdir)
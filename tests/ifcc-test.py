@@ -71,6 +71,8 @@ def parse_args() -> argparse.Namespace:
 
     argparser.add_argument('--ifcc_path', metavar='PATH', default=default_ifcc_path,
                            help=f'Path to the ifcc executable. Default is {default_ifcc_path}')
+    argparser.add_argument('--ifcc_args', metavar='ARGS', default='',
+                           help='Extra arguments passed to ifcc, e.g. "-fregalloc=linear"')
     argparser.add_argument('-d', '--debug', action="count", default=0,
                            help='Increase quantity of debugging messages (only useful to debug the test script itself)')
     argparser.add_argument('-v', '--verbose', action="count", default=0,
@@ -174,7 +176,7 @@ def run_test_case(jobname: str, orig_cwd: str, ifcc_path: str, verbose: int) ->
             dumpfile("gcc-execute.txt")
 
     ## IFCC compiler
-    ifccstatus = command(f"{ifcc_path}  input.c >> asm-ifcc.s", "ifcc-compile.txt")
+    ifccstatus = command(f"{ifcc_path} {args.ifcc_args} input.c >> asm-ifcc.s", "ifcc-compile.txt")
 
     if gccstatus != 0 and ifccstatus != 0:
         ## ifcc correctly rejects invalid program -> test-case ok
@@ -0,0 +1,19 @@
+int f(int a, int b, char c) {
+  int x;
+  int y;
+  char d;
+  char e;
+  x = a * b + b * a;
+  y = (a ^ b) - (b ^ a) + (a == b) + (b == a);
+  if (x > 10) {
+    y = y + a * b;
+  }
+  d = c + 100;
+  e = c + 100;
+  x = x + (c + 100);
+  return x + y + d + e;
+}
+
+int main() {
+  return f(3, 4, 50) + f(2, 2, 1);
+}
@@ -0,0 +1,46 @@
+void print(int x) {
+  int d = 1;
+  if (x < 0) {
+    putchar(45);
+    x = -x;
+  }
+  while (x / d >= 10) {
+    d = d * 10;
+  }
+  while (d > 0) {
+    putchar(48 + x / d % 10);
+    d = d / 10;
+  }
+  putchar(10);
+}
+
+int check(int unused, int n) {
+  int ten = 10;
+  print(n / 1024);
+  print(n % 1024);
+  print(n / -8);
+  print(n % -8);
+  print(n / ten);
+  print(n % ten);
+  print(n / 7);
+  print(n % 7);
+  print(n / -1000000007);
+  print(n % 641);
+  print(n * 40);
+  print(9 * n);
+  print(n * -3);
+  print(n * 1000);
+  return n % 3;
+}
+
+int main() {
+  int total = 0;
+  total = total + check(1, 0);
+  total = total + check(2, 123456789);
+  total = total + check(3, -123456789);
+  total = total + check(4, 2147483647);
+  total = total + check(5, -2147483647);
+  total = total + check(6, -5);
+  total = total + check(7, 4099);
+  return total + 10;
+}
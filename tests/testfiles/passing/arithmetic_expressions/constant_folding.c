@@ -0,0 +1,24 @@
+int main() {
+  int a;
+  int b;
+  int i;
+  char c;
+  a = 3 * 4 + 1;
+  b = (a - 20) / 3 + a % 5;
+  c = 100;
+  c = c + 50;
+  if (a > 10) {
+    b = b + 1;
+  } else {
+    b = b - 1;
+  }
+  while (0) {
+    a = 0;
+  }
+  i = 0;
+  while (i < 3) {
+    a = a + i;
+    i = i + 1;
+  }
+  return a + b * 7 + c;
+}
@@ -0,0 +1,7 @@
+int main() {
+  int a = -17;
+  int b = 5;
+  int q = a / b;
+  int r = a % b;
+  return q * 10 + r + 100;
+}
@@ -0,0 +1,174 @@
+int counter = 5;
+char letter = 'a';
+int squares[8];
+char text[16];
+int *cursor;
+
+int sum(int *p, int n) {
+  int s = 0;
+  int i = 0;
+  while (i < n) {
+    s = s + p[i];
+    ++i;
+  }
+  return s;
+}
+
+void swap(int *a, int *b) {
+  int t = *a;
+  *a = *b;
+  *b = t;
+}
+
+int *largest(int *p, int n) {
+  int *best = p;
+  int *end = p + n;
+  while (p < end) {
+    if (*p > *best) {
+      best = p;
+    }
+    ++p;
+  }
+  return best;
+}
+
+int length(char *s) {
+  char *start = s;
+  while (*s) {
+    ++s;
+  }
+  return s - start;
+}
+
+void reverse(char *s) {
+  char *end = s + length(s) - 1;
+  while (s < end) {
+    char c = *s;
+    *s = *end;
+    *end = c;
+    ++s;
+    --end;
+  }
+}
+
+void print(char *s) {
+  while (*s) {
+    putchar(*s);
+    ++s;
+  }
+  putchar(10);
+}
+
+void bump(int *p) { *p = *p + 1; }
+
+int addressedParameter(int x) {
+  bump(&x);
+  bump(&x);
+  return x;
+}
+
+int many(int *a, int *b, int *c, int *d, int *e, int *f, int *g, int *h) {
+  return *a + *b * 2 + *c * 3 + *d * 4 + *e * 5 + *f * 6 + *g * 7 + *h * 8;
+}
+
+int pressure(int *p) {
+  int a = p[0];
+  int b = p[1];
+  int c = p[2];
+  int d = p[3];
+  int e = p[4];
+  int f = p[5];
+  int g = p[6];
+  int h = p[7];
+  int i = 0;
+  while (i < 8) {
+    p[i] = a + b * i + c - d * i + e + f * i - g + h * i;
+    a = b;
+    b = c;
+    c = d + i;
+    ++i;
+  }
+  return a + b + c + d + e + f + g + h;
+}
+
+int storeAcross(int *out, int x, int y) {
+  int a = x + 1;
+  int b = x - y;
+  int c = y * 3;
+  int d = x * y;
+  int e = x - 7;
+  int f = y + 9;
+  int g = x * 5 % 11;
+  int h = y - x;
+  int i = x + y;
+  int j = x * 2 - y;
+  int k = y * y;
+  int l = x + 13;
+  out[0] = a / (y + 1);
+  out[1] = b % (y + 2);
+  int r = length(text);
+  out[y % 3 + 2] = c - d + r;
+  *(out + 5) = e / f;
+  return a + b + c + d + e + f + g + h + i + j + k + l + r + out[0] + out[1] +
+         out[2] + out[5];
+}
+
+int main() {
+  int local[6];
+  int i = 0;
+  while (i < 6) {
+    local[i] = (i * 7) % 5 - 2;
+    ++i;
+  }
+  i = 0;
+  while (i < 8) {
+    squares[i] = i * i;
+    ++i;
+  }
+  int total = sum(local, 6) + sum(squares, 8) + *largest(local, 6);
+  total = total + (largest(squares, 8) - squares);
+
+  int x = 3;
+  int y = 40;
+  swap(&x, &y);
+  total = total + x - y;
+  int *px = &x;
+  int **ppx = &px;
+  **ppx = 12;
+  total = total + x + *px;
+
+  cursor = &squares[2];
+  cursor[1] = -9;
+  *(cursor + 2) = counter;
+  total = total + squares[3] + squares[4] + (cursor == squares + 2);
+  ++counter;
+  --cursor;
+  total = total + counter + *cursor + (cursor != 0) + !cursor;
+
+  char word[8];
+  word[0] = 'p';
+  word[1] = 'o';
+  word[2] = 'i';
+  word[3] = 'n';
+  word[4] = 't';
+  word[5] = 0;
+  reverse(word);
+  print(word);
+  text[0] = letter;
+  text[1] = letter + 1;
+  text[2] = -56;
+  text[3] = 0;
+  total = total + length(text) + text[2] + (text[2] < 0);
+  char *t = text;
+  t[0] = 'A';
+  t[2] = 'c';
+  print(text);
+
+  total = total + addressedParameter(10);
+  total = total + many(&local[0], &local[1], &local[2], &local[3], &local[4],
+                       &local[5], &x, &squares[7]);
+  total = total + pressure(squares) + sum(squares, 8);
+  int results[6];
+  total = total + storeAcross(results, y - 50, 3) + results[2];
+  return total % 256;
+}
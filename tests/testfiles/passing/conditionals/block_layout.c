@@ -0,0 +1,167 @@
+int bucket(int x) {
+  if (x < 1) {
+    return 0;
+  }
+  if (x < 4) {
+    return 1;
+  }
+  if (x < 7) {
+    return 2;
+  }
+  if (x < 10) {
+    return 3;
+  }
+  if (x < 13) {
+    return 4;
+  }
+  if (x < 16) {
+    return 5;
+  }
+  if (x < 19) {
+    return 6;
+  }
+  if (x < 22) {
+    return 7;
+  }
+  if (x < 25) {
+    return 8;
+  }
+  if (x < 28) {
+    return 9;
+  }
+  if (x < 31) {
+    return 10;
+  }
+  if (x < 34) {
+    return 11;
+  }
+  if (x < 37) {
+    return 12;
+  }
+  if (x < 40) {
+    return 13;
+  }
+  if (x < 43) {
+    return 14;
+  }
+  if (x < 46) {
+    return 15;
+  }
+  if (x < 49) {
+    return 16;
+  }
+  if (x < 52) {
+    return 17;
+  }
+  if (x < 55) {
+    return 18;
+  }
+  if (x < 58) {
+    return 19;
+  }
+  if (x < 61) {
+    return 20;
+  }
+  if (x < 64) {
+    return 21;
+  }
+  if (x < 67) {
+    return 22;
+  }
+  if (x < 70) {
+    return 23;
+  }
+  if (x < 73) {
+    return 24;
+  }
+  if (x < 76) {
+    return 25;
+  }
+  if (x < 79) {
+    return 26;
+  }
+  if (x < 82) {
+    return 27;
+  }
+  if (x < 85) {
+    return 28;
+  }
+  if (x < 88) {
+    return 29;
+  }
+  if (x < 91) {
+    return 30;
+  }
+  if (x < 94) {
+    return 31;
+  }
+  if (x < 97) {
+    return 32;
+  }
+  if (x < 100) {
+    return 33;
+  }
+  if (x < 103) {
+    return 34;
+  }
+  if (x < 106) {
+    return 35;
+  }
+  if (x < 109) {
+    return 36;
+  }
+  if (x < 112) {
+    return 37;
+  }
+  if (x < 115) {
+    return 38;
+  }
+  if (x < 118) {
+    return 39;
+  }
+  return 99;
+}
+
+int sign(int x) {
+  int result = 0;
+  if (x < 0) {
+    result = -1;
+  } else {
+    if (x == 0) {
+      result = 0;
+    } else {
+      if (x < 100) {
+        result = 1;
+      } else {
+        result = 2;
+      }
+    }
+  }
+  return result;
+}
+
+int count_down(int n) {
+  int steps = 0;
+  while (n > 0) {
+    if (n % 3 == 0) {
+      n = n - 2;
+    } else {
+      n = n - 1;
+    }
+    ++steps;
+  }
+  return steps;
+}
+
+int main() {
+  int i = 0;
+  int sum = 0;
+  while (i < 130) {
+    sum = sum + bucket(i) + sign(i - 5) + sign(i * 10);
+    i = i + 7;
+  }
+  sum = sum + count_down(50);
+  putchar(48 + sum % 10);
+  putchar(10);
+  return sum % 256;
+}
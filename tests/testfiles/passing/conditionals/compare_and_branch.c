@@ -0,0 +1,27 @@
+int main() {
+  int i;
+  int n;
+  int c;
+  n = 0;
+  i = 0;
+  while (i <= 12) {
+    if (i > 9) {
+      n = n + 1;
+    }
+    if (i >= 3) {
+      n = n + 2;
+    }
+    if (i == 5) {
+      n = n + 4;
+    }
+    if (i != 7) {
+      n = n + 8;
+    }
+    c = i < 4;
+    if (c) {
+      n = n + c;
+    }
+    i = i + 1;
+  }
+  return n;
+}
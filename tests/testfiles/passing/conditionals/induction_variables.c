@@ -0,0 +1,62 @@
+int scaled(int n, int k) {
+  int s = 0;
+  int i = 0;
+  while (i < n) {
+    s = s + i * 8 + k * i;
+    i = i + 1;
+  }
+  return s + i;
+}
+
+int countdown(int n) {
+  int s = 0;
+  int i = n;
+  while (i > 0) {
+    i = i - 3;
+    s = s ^ (i * 7);
+  }
+  return s;
+}
+
+int nested(int n) {
+  int s = 0;
+  int i = 0;
+  while (i < n) {
+    int j = 0;
+    while (j < i) {
+      s = s + (j * 3 + i * 5) % 11;
+      ++j;
+    }
+    ++i;
+  }
+  return s;
+}
+
+int wrapping() {
+  int s = 0;
+  int i = 0;
+  while (i < 4) {
+    s = s + (i * 1000000007) % 97;
+    i = i + 1;
+  }
+  return s;
+}
+
+int offsets(int n) {
+  int s = 0;
+  int i = 0;
+  int offset = 5;
+  while (i < n) {
+    s = s + offset * 12;
+    offset = offset - 2;
+    i = i + 1;
+  }
+  return s;
+}
+
+int main() {
+  int result =
+      scaled(10, 3) + countdown(20) + nested(9) + wrapping() + offsets(7);
+  putchar(48 + result % 10);
+  return result % 256;
+}
@@ -0,0 +1,35 @@
+int check(int flag, int x) {
+  int result = 1;
+  if (flag) {
+    if (flag) {
+      result = x + 1;
+    } else {
+      result = x - 1;
+    }
+  }
+  if (x > 3) {
+    if (x > 5) {
+      if (x > 7) {
+        result = result * 2;
+      }
+    }
+  } else {
+    if (flag) {
+      result = result + 10;
+    }
+  }
+  return result;
+}
+
+int main() {
+  int total = 0;
+  int i = 0;
+  while (i < 10) {
+    total = total + check(i % 2, i);
+    ++i;
+  }
+  total = total + check(0, 0) + check(1, 9);
+  putchar(48 + total % 10);
+  putchar(10);
+  return total % 256;
+}
@@ -0,0 +1,31 @@
+int main() {
+  int a;
+  int b;
+  int t;
+  int i;
+  int j;
+  int s;
+  char c;
+  a = 1;
+  b = 2;
+  s = 0;
+  c = 120;
+  i = 0;
+  while (i < 7) {
+    t = a;
+    a = b;
+    b = t;
+    j = i;
+    while (j > 0) {
+      if (j % 2 == 0) {
+        s = s + a;
+      } else {
+        s = s - b;
+        c = c + 3;
+      }
+      j = j - 1;
+    }
+    i = i + 1;
+  }
+  return a * 100 + b * 10 + s + c;
+}
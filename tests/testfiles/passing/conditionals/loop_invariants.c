@@ -0,0 +1,22 @@
+int sum(int n, int k, int d) {
+  int s = 0;
+  int i = 0;
+  char c;
+  while (i < n * 4 - 1) {
+    int j = 0;
+    while (j < 3) {
+      c = k * 50;
+      s = s + (k * 7 + n) + c;
+      j = j + 1;
+    }
+    if (d != 0) {
+      s = s + k / d;
+    }
+    i = i + 1;
+  }
+  return s;
+}
+
+int main() {
+  return (sum(3, 2, 1) + sum(0, 5, 0) + sum(2, 3, 0)) % 256;
+}
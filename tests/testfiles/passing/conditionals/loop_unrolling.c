@@ -0,0 +1,105 @@
+int sumTo(int n) {
+  int s = 0;
+  int i = 0;
+  while (i < n) {
+    s = s + i * 3;
+    ++i;
+  }
+  return s;
+}
+
+int countDown(int n) {
+  int s = 1;
+  int i = 100;
+  while (i >= n) {
+    s = s * 3 ^ i;
+    i = i - 7;
+  }
+  return s;
+}
+
+int checksum(int from, int to) {
+  char c = 0;
+  int i = from;
+  while (i <= to) {
+    if (i % 3) {
+      c = c + i;
+    } else {
+      c = c ^ i;
+    }
+    i = 2 + i;
+  }
+  return c;
+}
+
+int firstMultiple(int n, int k) {
+  int i = 1;
+  while (i < n) {
+    if (i % k == 0) {
+      return i;
+    }
+    ++i;
+  }
+  return 0;
+}
+
+int constantLoops() {
+  int s = 0;
+  int i = 0;
+  while (i < 10) {
+    s = s + i;
+    i = i + 2;
+  }
+  int j = 5;
+  while (3 < j) {
+    s = s * 2 + j;
+    --j;
+  }
+  int k = 20;
+  while (k < 10) {
+    s = s + 1000;
+    ++k;
+  }
+  int big = 0;
+  while (big < 1000) {
+    s = s + big % 7;
+    ++big;
+  }
+  return s;
+}
+
+int nested(int n) {
+  int s = 0;
+  int i = 0;
+  while (i < n) {
+    int j = 0;
+    while (j < 3) {
+      s = s + i * j;
+      ++j;
+    }
+    ++i;
+  }
+  return s;
+}
+
+void print(int x) {
+  putchar(48 + x % 10);
+  putchar(10);
+}
+
+int main() {
+  int total = 0;
+  int n = -2;
+  while (n < 12) {
+    total = total + sumTo(n) + countDown(n * 9) + checksum(n, n * 5);
+    total = total + firstMultiple(n * 4, 5) + nested(n);
+    ++n;
+  }
+  total = total + constantLoops();
+  total = total + sumTo(-2147483647) + sumTo(-2147483647 - 1);
+  total = total + countDown(2147483647) + countDown(2147483647 - 20);
+  total = total + checksum(2147483640, 2147483645);
+  total = total + checksum(-2147483647 - 1, -2147483647 + 20);
+  print(total);
+  return total % 256;
+}
@@ -0,0 +1,40 @@
+int classify(int x) {
+  int result = 0;
+  if (x) {
+    if (x > 10) {
+      result = 3;
+    } else {
+      result = 2;
+    }
+  } else {
+    result = 1;
+  }
+  if (!x) {
+    result = result + 10;
+  }
+  return result;
+}
+
+int swap_sum(int a, int b) {
+  int i = 0;
+  while (i < 5) {
+    int t = a;
+    a = b;
+    b = t + i;
+    ++i;
+  }
+  return a * 100 + b;
+}
+
+int main() {
+  char c = 60;
+  int count = 0;
+  while (c) {
+    c = c - 20;
+    ++count;
+  }
+  int total = classify(0) + classify(5) * 2 + classify(42) * 3 + count;
+  putchar(48 + total % 10);
+  putchar(10);
+  return (total + swap_sum(3, 4)) % 256;
+}
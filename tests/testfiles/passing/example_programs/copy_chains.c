@@ -0,0 +1,25 @@
+int rotate(int n) {
+  int a = 1;
+  int b = 2;
+  int c = 3;
+  int t;
+  char small;
+  int i = 0;
+  while (i < n) {
+    t = a;
+    a = b;
+    b = c;
+    c = t + a;
+    i = i + 1;
+  }
+  small = c * 37;
+  t = small;
+  return a - b + c + t;
+}
+
+int main() {
+  int x = 5;
+  int y = x;
+  int z = y;
+  return rotate(z) + rotate(y + 20);
+}
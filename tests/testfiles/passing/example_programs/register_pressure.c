@@ -0,0 +1,31 @@
+int main() {
+  int a = 1;
+  int b = 2;
+  int c = 3;
+  int d = 4;
+  int e = 5;
+  int f = 6;
+  int g = 7;
+  int h = 8;
+  int j = 9;
+  char k = 'A';
+  char l = 'z';
+  int i = 0;
+  int acc = 0;
+  while (i < 6) {
+    acc = acc + a * b - c + d % j - e / (f + 1) + g * h - k + l;
+    a = a + 1;
+    b = b + a;
+    c = c * 2 - b;
+    d = d + c % 7;
+    e = e - d;
+    f = f + e % 3;
+    g = g ^ f;
+    h = h + g % 5;
+    j = j + 2;
+    k = k + 1;
+    l = l - 3;
+    i = i + 1;
+  }
+  return (acc + a + b + c + d + e + f + g + h + j + k + l) % 256;
+}
@@ -0,0 +1,34 @@
+int depth(int n) {
+  if (n <= 0) {
+    return 0;
+  }
+  return 1 + depth(n - 1);
+}
+
+int mix(int a, int b, int c) { return a * 3 - b + c; }
+
+int work(int n) {
+  int acrossAll = n * 3;
+  int acrossLoop = n + 17;
+  int beforeOnly = n * n;
+  int first = depth(beforeOnly % 10);
+  int acc = 0;
+  int i = 0;
+  while (i < n) {
+    int local = i * 7 % 5;
+    acc = acc + mix(i, local, acrossAll) + depth(i % 4);
+    putchar('a' + local);
+    acc = acc + acrossLoop - local;
+    ++i;
+  }
+  putchar(10);
+  int after = depth(n);
+  return acc + first + acrossAll + acrossLoop + after;
+}
+
+int main() {
+  int a = work(3);
+  int b = work(7);
+  int c = depth(a % 5) + work(b % 9);
+  return (a + b * 2 + c) % 256;
+}
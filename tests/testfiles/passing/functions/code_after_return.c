@@ -0,0 +1,18 @@
+int f(int a) {
+  int b;
+  b = a * 3;
+  if (a > 2) {
+    return b;
+    b = b + 1;
+    putchar(b);
+  }
+  return a;
+  a = a + b;
+}
+
+int main() {
+  int unused;
+  unused = f(4) * 2;
+  return f(5) + f(1);
+  putchar(65);
+}
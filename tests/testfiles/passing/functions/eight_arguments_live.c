@@ -0,0 +1,10 @@
+int sum(int a, int b, int c, int d, int e, int f, int g, int h) {
+  return a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * f + 7 * g + 8 * h;
+}
+
+int main() {
+  int x = 3;
+  int y = 4;
+  int r = sum(x, y, x + y, x * y, 1, 2, 3, y - x);
+  return r + x * y;
+}
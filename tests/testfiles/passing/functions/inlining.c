@@ -0,0 +1,39 @@
+int square(int x) { return x * x; }
+
+int clamp(int x, int low, int high) {
+  if (x < low) {
+    return low;
+  }
+  if (x > high) {
+    return high;
+  }
+  return x;
+}
+
+void show(int digit) { putchar(48 + digit % 10); }
+
+int countdown(int n) {
+  if (n == 0) {
+    return 0;
+  }
+  return 1 + countdown(n - 1);
+}
+
+int sumSquares(int n) {
+  int s = 0;
+  int i = 0;
+  while (i < n) {
+    s = s + clamp(square(i), 2, 40);
+    i = i + 1;
+  }
+  return s;
+}
+
+int main() {
+  int a = sumSquares(9);
+  show(a);
+  show(clamp(square(3), square(2), 7 + 1));
+  show(countdown(5));
+  putchar(10);
+  return a + countdown(7);
+}
@@ -0,0 +1,36 @@
+int pressure(int a, int b) {
+  int v1 = a + 1;
+  int v2 = b + 2;
+  int v3 = a * 3;
+  int v4 = b * 4;
+  int v5 = a - 5;
+  int v6 = b - 6;
+  int v7 = a ^ 7;
+  int v8 = b ^ 8;
+  int v9 = a + b;
+  int v10 = a - b;
+  int v11 = a * b;
+  int v12 = a | b;
+  int v13 = a & b;
+  int v14 = a + 14;
+  int v15 = b + 15;
+  int v16 = a * 16;
+  return v1 - v2 + v3 - v4 + v5 - v6 + v7 - v8 + v9 - v10 + v11 - v12 + v13 -
+         v14 + v15 - v16 + v1 * v16 - v2 * v15 + v3 * v14 - v4 * v13;
+}
+
+int eight(int a, int b, int c, int d, int e, int f, int g, int h) {
+  return a - b + c - d + e - f + g * h;
+}
+
+int caller(int x) {
+  int kept = x * 3;
+  int result = eight(x, 2, 3, 4, 5, 6, pressure(x, kept), 8);
+  return result + kept;
+}
+
+int main() {
+  int total = pressure(3, 4) + caller(5);
+  putchar(48 + total % 10);
+  return total % 256;
+}
@@ -0,0 +1,38 @@
+int echo(int x) {
+  putchar('0' + (x % 10 + 10) % 10);
+  return x + 1;
+}
+
+int crunch(int x, int y, int z) {
+  int a = x + 1;
+  int b = x - y;
+  int c = y * 3;
+  int d = z + 5;
+  int e = x * z;
+  int f = y - z;
+  int g = x + y + z;
+  int h = x - 9;
+  int i = y + 11;
+  int j = z * 2 - x;
+  int k = x * 7 % 13;
+  int l = y - 20;
+  int q = e / (y + 1);
+  int m = b % (z * z + 3);
+  int called = echo(q + m);
+  a = q * 2 + called;
+  b = m - a / (d + 1);
+  c = c + e % (i + 40);
+  int w = (a + b + c + d) / (f * f + 1);
+  return a + b + c + d + e + f + g + h + i + j + k + l + q + m + w;
+}
+
+int main() {
+  int total = 0;
+  int n = -4;
+  while (n < 6) {
+    total = total + crunch(n * 37, n + 5, 2 - n);
+    ++n;
+  }
+  putchar(10);
+  return (total % 256 + 256) % 256;
+}
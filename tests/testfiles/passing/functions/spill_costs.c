@@ -0,0 +1,53 @@
+void printNumber(int n) {
+  if (n < 0) {
+    putchar('-');
+    n = -n;
+  }
+  if (n >= 10) {
+    printNumber(n / 10);
+  }
+  putchar('0' + n % 10);
+}
+
+int kernel(int n, int seed) {
+  int a = seed + 1;
+  int b = seed * 2;
+  int c = seed - 3;
+  int d = seed + 4;
+  int e = seed * 5 % 7;
+  int f = seed + 6;
+  int g = seed - 7;
+  int h = seed + 8;
+  int p = seed * 9 % 11;
+  int q = seed + 10;
+  int r = seed - 11;
+  int s = seed + 12;
+  int t = seed * 13 % 17;
+  int u = seed + 14;
+  int total = 0;
+  int i = 0;
+  while (i < n) {
+    int j = 0;
+    while (j < n) {
+      total = (total + i * j + a * (j % 3) - b + c) % 10007;
+      ++j;
+    }
+    a = (a + b) % 101;
+    b = (b + c) % 103;
+    ++i;
+  }
+  return total + a + b + c + d + e + f + g + h + p + q + r + s + t + u;
+}
+
+int main() {
+  int result = 0;
+  int k = 0;
+  while (k < 6) {
+    int value = kernel(k * 3 + 2, k * 7 - 5);
+    printNumber(value);
+    putchar(10);
+    result = result + value;
+    ++k;
+  }
+  return result % 256;
+}
@@ -0,0 +1,79 @@
+int seed(int n) {
+  if (n == 0) {
+    return 7;
+  }
+  return seed(n - 1) + 3;
+}
+
+int phases(int a, int b) {
+  int p1 = a + 1;
+  int p2 = b + 2;
+  int p3 = a * 3;
+  int p4 = b * 4;
+  int p5 = a - 5;
+  int p6 = b - 6;
+  int p7 = a ^ 7;
+  int p8 = b ^ 8;
+  int p9 = a + b;
+  int p10 = a - b;
+  int p11 = a * b;
+  int p12 = a | b;
+  int p13 = a & b;
+  int p14 = a + 14;
+  int p15 = b + 15;
+  int p16 = a * 16;
+  int first = p1 - p2 + p3 - p4 + p5 - p6 + p7 - p8 + p9 - p10 + p11 - p12 +
+              p13 - p14 + p15 - p16 + p1 * p16 - p2 * p15 + p3 * p14;
+
+  char c1 = first + 1;
+  char c2 = first * 2;
+  char c3 = first - 3;
+  char c4 = first ^ 4;
+  int q1 = first + a;
+  int q2 = first - b;
+  int q3 = first * 3;
+  int q4 = first ^ a;
+  int q5 = first | b;
+  int q6 = first & a;
+  int q7 = first + 7;
+  int q8 = first - 8;
+  int q9 = first * a;
+  int q10 = first * b;
+  int q11 = first + a * b;
+  int q12 = first - a * 3;
+  int second = q1 + q2 - q3 + q4 - q5 + q6 - q7 + q8 - q9 + q10 - q11 + q12 +
+               c1 - c2 + c3 - c4 + q1 * q12 - q2 * q11 + c1 * c4;
+
+  int i = 0;
+  int sum = 0;
+  while (i < 10) {
+    int r1 = second + i;
+    int r2 = second - i;
+    int r3 = i * 3;
+    int r4 = r1 ^ r2;
+    int r5 = r1 | i;
+    int r6 = r2 & i;
+    int r7 = r1 + r3;
+    int r8 = r2 - r3;
+    int r9 = r4 * 9;
+    int r10 = r5 + r6;
+    int r11 = r7 - r8;
+    int r12 = r9 + r10;
+    int r13 = r1 * r2;
+    int r14 = r3 + r4;
+    int r15 = r5 - r6;
+    sum = sum + r1 - r2 + r3 - r4 + r5 - r6 + r7 - r8 + r9 - r10 + r11 - r12 +
+          r13 - r14 + r15 + r1 * r15 - r2 * r14 + r3 * r13;
+    ++i;
+  }
+  return first + second + sum;
+}
+
+int main() {
+  int a = seed(2);
+  int b = seed(5);
+  int total = phases(a, b) + phases(b, a) + phases(-a, b);
+  putchar(65 + (total % 26 + 26) % 26);
+  putchar(10);
+  return total % 256;
+}
@@ -0,0 +1,44 @@
+int get_n(int n) {
+  if (n == 0) {
+    return 0;
+  }
+  return 1 + get_n(n - 1);
+}
+
+int fact(int n) {
+  if (n < 2) {
+    return 1;
+  }
+  return n * fact(n - 1);
+}
+
+int gcd(int a, int b) {
+  if (b == 0) {
+    return a;
+  }
+  return gcd(b, a % b);
+}
+
+int sumTo(int n, int acc) {
+  if (n == 0) {
+    return acc;
+  }
+  return sumTo(n - 1, acc + n);
+}
+
+void stars(int n) {
+  if (n == 0) {
+    return;
+  }
+  putchar(42);
+  stars(n - 1);
+}
+
+int twice(int x) { return gcd(x * 6, 4 * x); }
+
+int main() {
+  stars(3);
+  putchar(10);
+  return (get_n(10000) + fact(5) + gcd(84, 36) + sumTo(20000, 0) +
+          twice(7)) % 256;
+}
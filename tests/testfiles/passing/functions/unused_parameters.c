@@ -0,0 +1,7 @@
+int f(int a, int b, int c, int d, int e, int g) {
+  return e * 10 + a - g;
+}
+
+int main() {
+  return f(1, 2, 3, 4, 5, 6);
+}
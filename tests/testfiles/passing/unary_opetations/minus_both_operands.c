@@ -0,0 +1,6 @@
+int main() {
+    int a = 5;
+    int b = 7;
+    int c = -a + -b;
+    return c + 40;
+}